@@ -0,0 +1,187 @@
+#include "autoexposure.h"
+#include "colorconverter.h"
+
+AutoExposure::AutoExposure() :
+    step( 0 ),
+    lowLevel( 1000 ),
+    highLevel( 58000 ),
+    stepDownMargin( 2 ),
+    holdCount( 2 ),
+    outOfBandCount( 0 ),
+    switchCount( 0 )
+{
+    // Build ladder of settings ordered by sensitivity
+    QVector<Setting> all;
+
+    for ( int g = ColorSensorAccess::Low; g <= ColorSensorAccess::High; g++ ) {
+        for ( int t = ColorSensorAccess::T00; t <= ColorSensorAccess::T11; t++ ) {
+            Setting setting;
+
+            setting.gain = (ColorSensorAccess::Gain)g;
+            setting.intTime = (ColorSensorAccess::IntegrationTime)t;
+            setting.sensitivity = 1.0 / ColorConverter::exposureScale( setting.gain, setting.intTime, false, 1 );
+            setting.integrationTime = ColorConverter::integrationTime( setting.intTime, false, 1 );
+
+            all.append( setting );
+        }
+    }
+
+    for ( int i = 0; i < all.size(); i++ ) {
+        // Drop setting if other one is as sensitive and faster (Low / T11 vs High / T10)
+        bool dominated = false;
+
+        for ( int j = 0; j < all.size(); j++ ) {
+            if ( j != i && all[j].sensitivity >= all[i].sensitivity && all[j].integrationTime < all[i].integrationTime ) {
+                dominated = true;
+                break;
+            }
+        }
+
+        if ( dominated ) {
+            continue;
+        }
+
+        int pos = 0;
+
+        while ( pos < steps.size() && steps[pos].sensitivity < all[i].sensitivity ) {
+            pos++;
+        }
+
+        steps.insert( pos, all[i] );
+    }
+
+    step = steps.size() - 1;
+}
+
+bool AutoExposure::update(const ColorSensorAccess::ColorData &data)
+{
+    // Evaluate headroom of sample, returns true if other setting should be used for next read
+    int peak = qMax( qMax( data.blue, data.green ), qMax( data.red, data.infraRed ) );
+    double sensitivity = 1.0 / ColorConverter::exposureScale( data );
+    bool over  = peak > highLevel;
+    bool under = peak < lowLevel;
+
+    // Shortest setting whose predicted peak lands in band with margin, saturated peak is lower bound
+    int target = steps.size() - 1;
+
+    for ( int i = 0; i < steps.size(); i++ ) {
+        double predicted = peak * steps[i].sensitivity / sensitivity;
+
+        if ( predicted >= lowLevel * stepDownMargin && predicted <= highLevel ) {
+            target = i;
+            break;
+        }
+    }
+
+    if ( over && steps[target].sensitivity >= sensitivity ) {
+        // Saturated beyond prediction, at least one step down
+        target = 0;
+
+        while ( target + 1 < steps.size() && steps[target + 1].sensitivity < sensitivity ) {
+            target++;
+        }
+    }
+
+    // Move only when out of band or when faster setting has enough headroom
+    bool faster = steps[target].sensitivity < sensitivity;
+
+    if ( !( over || under || faster ) || steps[target].sensitivity == sensitivity ) {
+        outOfBandCount = 0;
+
+        return false;
+    }
+
+    // Hysteresis in time, saturation is handled at once
+    outOfBandCount++;
+
+    if ( !over && outOfBandCount < holdCount ) {
+        return false;
+    }
+
+    outOfBandCount = 0;
+    step = target;
+    switchCount++;
+
+    return true;
+}
+
+int AutoExposure::getLowLevel() const
+{
+    return lowLevel;
+}
+
+void AutoExposure::setLowLevel(int value)
+{
+    lowLevel = value;
+}
+
+int AutoExposure::getHighLevel() const
+{
+    return highLevel;
+}
+
+void AutoExposure::setHighLevel(int value)
+{
+    highLevel = value;
+}
+
+double AutoExposure::getStepDownMargin() const
+{
+    return stepDownMargin;
+}
+
+void AutoExposure::setStepDownMargin(double value)
+{
+    stepDownMargin = qMax( 1.0, value );
+}
+
+int AutoExposure::getHoldCount() const
+{
+    return holdCount;
+}
+
+void AutoExposure::setHoldCount(int value)
+{
+    holdCount = qMax( 1, value );
+}
+
+int AutoExposure::getStepCount() const
+{
+    return steps.size();
+}
+
+AutoExposure::Setting AutoExposure::getSetting(int step) const
+{
+    return steps[qBound( 0, step, steps.size() - 1 )];
+}
+
+int AutoExposure::findStep(ColorSensorAccess::Gain gain, ColorSensorAccess::IntegrationTime intTime) const
+{
+    // Step nearest in sensitivity
+    double sensitivity = 1.0 / ColorConverter::exposureScale( gain, intTime, false, 1 );
+    int nearest = 0;
+
+    for ( int i = 0; i < steps.size(); i++ ) {
+        if ( qAbs( steps[i].sensitivity - sensitivity ) < qAbs( steps[nearest].sensitivity - sensitivity ) ) {
+            nearest = i;
+        }
+    }
+
+    return nearest;
+}
+
+int AutoExposure::getStep() const
+{
+    return step;
+}
+
+void AutoExposure::setStep(int value)
+{
+    step = qBound( 0, value, steps.size() - 1 );
+    outOfBandCount = 0;
+}
+
+int AutoExposure::getSwitchCount() const
+{
+    return switchCount;
+}
@@ -0,0 +1,53 @@
+#ifndef AUTOEXPOSURE_H
+#define AUTOEXPOSURE_H
+
+#include <QVector>
+
+#include "colorsensoraccess.h"
+
+class AutoExposure
+{
+public:
+    struct Setting {
+        ColorSensorAccess::Gain gain;
+        ColorSensorAccess::IntegrationTime intTime;
+        double sensitivity;     // Relative to High gain / T11
+        double integrationTime; // [ms]
+    };
+
+public:
+    AutoExposure();
+
+    int getLowLevel() const;
+    void setLowLevel(int value);
+    int getHighLevel() const;
+    void setHighLevel(int value);
+    double getStepDownMargin() const;
+    void setStepDownMargin(double value);
+    int getHoldCount() const;
+    void setHoldCount(int value);
+
+    int getStepCount() const;
+    Setting getSetting( int step ) const;
+    int findStep( ColorSensorAccess::Gain gain, ColorSensorAccess::IntegrationTime intTime ) const;
+    int getStep() const;
+    void setStep(int value);
+    int getSwitchCount() const;
+
+    bool update( const ColorSensorAccess::ColorData &data );
+
+private:
+    QVector<Setting> steps;
+    int step;
+
+    // Target band of largest channel [counts]
+    int lowLevel;
+    int highLevel;
+    double stepDownMargin;
+
+    int holdCount;
+    int outOfBandCount;
+    int switchCount;
+};
+
+#endif // AUTOEXPOSURE_H
@@ -0,0 +1,284 @@
+#include "blockcodec.h"
+
+#include <string.h>
+#include <math.h>
+
+#include <QVarLengthArray>
+
+void BlockCodec::encodeColumn(const qint64 *values, int count, QByteArray &out)
+{
+    // Mode, width, first value, [first delta], packed residuals
+    if ( count <= 0 ) {
+        return;
+    }
+
+    // Pick order with narrower residuals, differences wrap so any int64 is lossless
+    quint64 orDelta = 0, orDelta2 = 0;
+
+    for ( int i = 1; i < count; i++ ) {
+        quint64 d = (quint64)values[i] - (quint64)values[i - 1];
+
+        orDelta |= zigZag( d );
+
+        if ( i >= 2 ) {
+            quint64 prev = (quint64)values[i - 1] - (quint64)values[i - 2];
+
+            orDelta2 |= zigZag( d - prev );
+        }
+    }
+
+    int width1 = bitWidth( orDelta );
+    int width2 = bitWidth( orDelta2 );
+    bool second = count > 2 && (qint64)( count - 2 ) * width2 + 64 < (qint64)( count - 1 ) * width1;
+    int width = second ? width2 : width1;
+
+    out.append( (char)( second ? DeltaOfDelta : Delta ) );
+    out.append( (char)width );
+    putVarint( out, zigZag( values[0] ) );
+
+    if ( second ) {
+        putVarint( out, zigZag( (quint64)values[1] - (quint64)values[0] ) );
+    }
+
+    // LSB first bit stream
+    quint64 mask = width == 64 ? ~0ULL : ( 1ULL << width ) - 1;
+    quint64 acc = 0;
+    int fill = 0;
+    uchar buffer[8];
+
+    for ( int i = second ? 2 : 1; i < count && width > 0; i++ ) {
+        quint64 d = (quint64)values[i] - (quint64)values[i - 1];
+
+        if ( second ) {
+            d -= (quint64)values[i - 1] - (quint64)values[i - 2];
+        }
+
+        quint64 v = zigZag( d ) & mask;
+
+        acc |= v << fill;
+
+        if ( fill + width >= 64 ) {
+            for ( int b = 0; b < 8; b++ ) {
+                buffer[b] = acc >> ( b * 8 );
+            }
+
+            out.append( (const char *)buffer, 8 );
+
+            acc = fill > 0 ? v >> ( 64 - fill ) : 0;
+            fill = fill + width - 64;
+        } else {
+            fill += width;
+        }
+    }
+
+    for ( int b = 0; b * 8 < fill; b++ ) {
+        out.append( (char)( acc >> ( b * 8 ) ) );
+    }
+}
+
+bool BlockCodec::decodeColumn(const uchar *&in, const uchar *end, qint64 *values, int count)
+{
+    if ( count <= 0 ) {
+        return true;
+    }
+
+    if ( end - in < 1 || in[0] > DeltaOfDelta ) {
+        return false;
+    }
+
+    int mode = *in++;
+
+    return decodeIntegers( in, end, mode, values, count );
+}
+
+bool BlockCodec::decodeIntegers(const uchar *&in, const uchar *end, int mode, qint64 *values, int count)
+{
+    quint64 first, firstDelta = 0;
+
+    if ( end - in < 1 || in[0] > 64 ) {
+        return false;
+    }
+
+    int width = *in++;
+
+    if ( !getVarint( in, end, first ) ) {
+        return false;
+    }
+
+    if ( mode == DeltaOfDelta && !getVarint( in, end, firstDelta ) ) {
+        return false;
+    }
+
+    int start = mode == DeltaOfDelta ? qMin( 2, count ) : 1;
+    qint64 packedBytes = ( (qint64)( count - start ) * width + 7 ) / 8;
+
+    if ( end - in < packedBytes ) {
+        return false;
+    }
+
+    values[0] = unZigZag( first );
+
+    if ( count > 1 && mode == DeltaOfDelta ) {
+        values[1] = (quint64)values[0] + (quint64)unZigZag( firstDelta );
+    }
+
+    // Refill 64 bits at a time, zero padded past the end of the column
+    const uchar *p = in;
+    const uchar *packedEnd = in + packedBytes;
+    quint64 mask = width == 64 ? ~0ULL : ( 1ULL << width ) - 1;
+    quint64 acc = 0;
+    int avail = 0;
+    quint64 delta = count > 1 ? (quint64)values[1] - (quint64)values[0] : 0;
+
+    for ( int i = start; i < count; i++ ) {
+        quint64 v = 0;
+
+        if ( width > 0 ) {
+            if ( avail >= width ) {
+                v = acc & mask;
+                acc = width == 64 ? 0 : acc >> width;
+                avail -= width;
+            } else {
+                quint64 next = 0;
+                int n = qMin( (qint64)8, (qint64)( packedEnd - p ) );
+
+                for ( int b = 0; b < n; b++ ) {
+                    next |= (quint64)p[b] << ( b * 8 );
+                }
+
+                p += n;
+
+                int used = width - avail;
+
+                v = ( avail > 0 ? acc | ( next << avail ) : next ) & mask;
+                acc = used == 64 ? 0 : next >> used;
+                avail = 64 - used;
+            }
+        }
+
+        if ( mode == DeltaOfDelta ) {
+            delta += (quint64)unZigZag( v );
+        } else {
+            delta = (quint64)unZigZag( v );
+        }
+
+        values[i] = (quint64)values[i - 1] + delta;
+    }
+
+    in = packedEnd;
+
+    return true;
+}
+
+void BlockCodec::encodeDoubleColumn(const double *values, int count, QByteArray &out)
+{
+    // Sensor counts and indexes are integers, anything else is stored as is
+    QVarLengthArray<qint64, 256> integers( count );
+
+    for ( int i = 0; i < count; i++ ) {
+        double v = values[i];
+
+        if ( !( fabs( v ) <= 9007199254740992.0 ) || v != floor( v ) || ( v == 0 && signbit( v ) ) ) {
+            out.append( (char)RawDouble );
+
+            for ( int k = 0; k < count; k++ ) {
+                quint64 bits;
+
+                memcpy( &bits, &values[k], 8 );
+
+                for ( int b = 0; b < 8; b++ ) {
+                    out.append( (char)( bits >> ( b * 8 ) ) );
+                }
+            }
+
+            return;
+        }
+
+        integers[i] = (qint64)v;
+    }
+
+    encodeColumn( integers.constData(), count, out );
+}
+
+bool BlockCodec::decodeDoubleColumn(const uchar *&in, const uchar *end, double *values, int count)
+{
+    if ( count <= 0 ) {
+        return true;
+    }
+
+    if ( end - in < 1 || in[0] > RawDouble ) {
+        return false;
+    }
+
+    int mode = *in++;
+
+    if ( mode == RawDouble ) {
+        if ( end - in < (qint64)count * 8 ) {
+            return false;
+        }
+
+        for ( int i = 0; i < count; i++, in += 8 ) {
+            quint64 bits = 0;
+
+            for ( int b = 0; b < 8; b++ ) {
+                bits |= (quint64)in[b] << ( b * 8 );
+            }
+
+            memcpy( &values[i], &bits, 8 );
+        }
+
+        return true;
+    }
+
+    QVarLengthArray<qint64, 256> integers( count );
+
+    if ( !decodeIntegers( in, end, mode, integers.data(), count ) ) {
+        return false;
+    }
+
+    for ( int i = 0; i < count; i++ ) {
+        values[i] = integers[i];
+    }
+
+    return true;
+}
+
+void BlockCodec::putVarint(QByteArray &out, quint64 value)
+{
+    // 7 bits per byte, high bit continues
+    while ( value >= 0x80 ) {
+        out.append( (char)( ( value & 0x7F ) | 0x80 ) );
+        value >>= 7;
+    }
+
+    out.append( (char)value );
+}
+
+bool BlockCodec::getVarint(const uchar *&in, const uchar *end, quint64 &value)
+{
+    value = 0;
+
+    for ( int shift = 0; shift < 64 && in < end; shift += 7 ) {
+        uchar b = *in++;
+
+        value |= (quint64)( b & 0x7F ) << shift;
+
+        if ( !( b & 0x80 ) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int BlockCodec::bitWidth(quint64 value)
+{
+    int width = 0;
+
+    while ( value ) {
+        width++;
+        value >>= 1;
+    }
+
+    return width;
+}
@@ -0,0 +1,42 @@
+#ifndef BLOCKCODEC_H
+#define BLOCKCODEC_H
+
+#include <QByteArray>
+
+#include <stdint.h>
+
+// Lossless column codec for blocks of slowly changing samples
+// Column is delta or delta of delta coded, zig-zag mapped and bit-packed at the widest residual
+class BlockCodec
+{
+public:
+    enum ColumnMode {
+        Delta = 0,
+        DeltaOfDelta,
+        RawDouble,          // Non integer values, 8 bytes each
+    };
+
+public:
+    static void encodeColumn( const qint64 *values, int count, QByteArray &out );
+    static bool decodeColumn( const uchar *&in, const uchar *end, qint64 *values, int count );
+
+    static void encodeDoubleColumn( const double *values, int count, QByteArray &out );
+    static bool decodeDoubleColumn( const uchar *&in, const uchar *end, double *values, int count );
+
+    static void putVarint( QByteArray &out, quint64 value );
+    static bool getVarint( const uchar *&in, const uchar *end, quint64 &value );
+
+    static inline quint64 zigZag( qint64 value ) {
+        return ( (quint64)value << 1 ) ^ (quint64)( value >> 63 );
+    }
+
+    static inline qint64 unZigZag( quint64 value ) {
+        return (qint64)( value >> 1 ) ^ -(qint64)( value & 1 );
+    }
+
+private:
+    static int bitWidth( quint64 value );
+    static bool decodeIntegers( const uchar *&in, const uchar *end, int mode, qint64 *values, int count );
+};
+
+#endif // BLOCKCODEC_H
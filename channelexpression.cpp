@@ -0,0 +1,460 @@
+#include "channelexpression.h"
+
+#include <cmath>
+#include <string.h>
+
+ChannelExpression::ChannelExpression() :
+    stackDepth( 0 ),
+    position( 0 ),
+    depth( 0 ),
+    nesting( 0 )
+{
+}
+
+bool ChannelExpression::compile(const QString &text, const QStringList &inputNames)
+{
+    // Name defaults to expression itself
+    int equal = text.indexOf( '=' );
+
+    this->text = text.mid( equal + 1 ).trimmed();
+    this->name = equal >= 0 ? text.left( equal ).trimmed() : this->text;
+    this->inputNames = inputNames;
+
+    error.clear();
+    code.clear();
+    stackDepth = 0;
+    position = 0;
+    depth = 0;
+    nesting = 0;
+
+    bool ok = !this->text.isEmpty() || fail( "Empty expression" );
+
+    ok = ok && ( !name.isEmpty() || fail( "Empty name" ) );
+
+    ok = ok && parseSum();
+
+    skipSpace();
+
+    if ( ok && position < this->text.size() ) {
+        ok = fail( QString( "Unexpected '%1'" ).arg( this->text[position] ) );
+    }
+
+    if ( ok && stackDepth > MaxStackDepth ) {
+        ok = fail( "Expression is too deeply nested" );
+    }
+
+    if ( !ok ) {
+        code.clear();
+    }
+
+    return ok;
+}
+
+bool ChannelExpression::isValid() const
+{
+    return !code.isEmpty();
+}
+
+QString ChannelExpression::getName() const
+{
+    return name;
+}
+
+QString ChannelExpression::getText() const
+{
+    return text;
+}
+
+QString ChannelExpression::getError() const
+{
+    return error;
+}
+
+const QVector<ChannelExpression::Instruction> &ChannelExpression::getCode() const
+{
+    return code;
+}
+
+int ChannelExpression::getInputCount() const
+{
+    // Inputs needed by evaluate, highest input used plus one
+    int count = 0;
+
+    for ( const Instruction &ins : code ) {
+        if ( ins.op == PushInput ) {
+            count = qMax( count, ins.input + 1 );
+        }
+    }
+
+    return count;
+}
+
+void ChannelExpression::evaluate(const double * const *inputs, int count, double *output) const
+{
+    if ( code.isEmpty() ) {
+        return;
+    }
+
+    // One block buffer per stack level, sized to stay in L1 cache
+    QVarLengthArray<double, 4 * BlockSize> stack( stackDepth * BlockSize );
+
+    for ( int start = 0; start < count; start += BlockSize ) {
+        int n = qMin( (int)BlockSize, count - start );
+        int top = -1;
+
+        for ( const Instruction &ins : code ) {
+            double *a = stack.data() + ( ins.op == PushInput || ins.op == PushConstant ? top + 1 : top ) * BlockSize;
+            const double *b = a + BlockSize;
+
+            switch ( ins.op ) {
+            case PushInput:
+                memcpy( a, inputs[ins.input] + start, n * sizeof( double ) );
+                top++;
+                break;
+            case PushConstant:
+                for ( int i = 0; i < n; i++ ) a[i] = ins.constant;
+                top++;
+                break;
+            case Add:
+                a -= BlockSize;
+                b -= BlockSize;
+                for ( int i = 0; i < n; i++ ) a[i] += b[i];
+                top--;
+                break;
+            case Subtract:
+                a -= BlockSize;
+                b -= BlockSize;
+                for ( int i = 0; i < n; i++ ) a[i] -= b[i];
+                top--;
+                break;
+            case Multiply:
+                a -= BlockSize;
+                b -= BlockSize;
+                for ( int i = 0; i < n; i++ ) a[i] *= b[i];
+                top--;
+                break;
+            case Divide:
+                a -= BlockSize;
+                b -= BlockSize;
+                for ( int i = 0; i < n; i++ ) a[i] /= b[i];
+                top--;
+                break;
+            case Min:
+                a -= BlockSize;
+                b -= BlockSize;
+                for ( int i = 0; i < n; i++ ) a[i] = b[i] < a[i] ? b[i] : a[i];
+                top--;
+                break;
+            case Max:
+                a -= BlockSize;
+                b -= BlockSize;
+                for ( int i = 0; i < n; i++ ) a[i] = b[i] > a[i] ? b[i] : a[i];
+                top--;
+                break;
+            case Negate:
+                for ( int i = 0; i < n; i++ ) a[i] = -a[i];
+                break;
+            case Abs:
+                for ( int i = 0; i < n; i++ ) a[i] = std::fabs( a[i] );
+                break;
+            case Sqrt:
+                for ( int i = 0; i < n; i++ ) a[i] = std::sqrt( a[i] );
+                break;
+            case Log:
+                for ( int i = 0; i < n; i++ ) a[i] = std::log( a[i] );
+                break;
+            case Exp:
+                for ( int i = 0; i < n; i++ ) a[i] = std::exp( a[i] );
+                break;
+            }
+        }
+
+        memcpy( output + start, stack.data(), n * sizeof( double ) );
+    }
+}
+
+QList<ChannelExpression> ChannelExpression::compileList(const QString &text, const QStringList &inputNames, QString *error)
+{
+    QList<ChannelExpression> list;
+
+    for ( const QString &definition : text.split( ';', QString::SkipEmptyParts ) ) {
+        if ( definition.trimmed().isEmpty() ) {
+            continue;
+        }
+
+        ChannelExpression expression;
+
+        if ( !expression.compile( definition, inputNames ) ) {
+            if ( error ) {
+                *error = QString( "%1 : %2" ).arg( definition.trimmed() ).arg( expression.getError() );
+            }
+
+            return QList<ChannelExpression>();
+        }
+
+        list << expression;
+    }
+
+    if ( error ) {
+        error->clear();
+    }
+
+    return list;
+}
+
+bool ChannelExpression::parseSum()
+{
+    if ( !parseProduct() ) {
+        return false;
+    }
+
+    while ( true ) {
+        if ( accept( '+' ) ) {
+            if ( !parseProduct() ) return false;
+            emitOp( Add );
+        } else if ( accept( '-' ) ) {
+            if ( !parseProduct() ) return false;
+            emitOp( Subtract );
+        } else {
+            return true;
+        }
+    }
+}
+
+bool ChannelExpression::parseProduct()
+{
+    if ( !parseUnary() ) {
+        return false;
+    }
+
+    while ( true ) {
+        if ( accept( '*' ) ) {
+            if ( !parseUnary() ) return false;
+            emitOp( Multiply );
+        } else if ( accept( '/' ) ) {
+            if ( !parseUnary() ) return false;
+            emitOp( Divide );
+        } else {
+            return true;
+        }
+    }
+}
+
+bool ChannelExpression::parseUnary()
+{
+    // Every level of nesting passes here, so long pasted input fails before stack runs out
+    if ( nesting >= MaxNesting ) {
+        return fail( "Expression is too deeply nested" );
+    }
+
+    bool ok;
+
+    nesting++;
+
+    if ( accept( '-' ) ) {
+        ok = parseUnary();
+
+        if ( ok ) {
+            emitOp( Negate );
+        }
+    } else {
+        accept( '+' );
+
+        ok = parsePrimary();
+    }
+
+    nesting--;
+
+    return ok;
+}
+
+bool ChannelExpression::parsePrimary()
+{
+    skipSpace();
+
+    if ( position >= text.size() ) {
+        return fail( "Unexpected end" );
+    }
+
+    QChar c = text[position];
+
+    // Parenthesis
+    if ( accept( '(' ) ) {
+        if ( !parseSum() ) return false;
+
+        return accept( ')' ) || fail( "Missing ')'" );
+    }
+
+    // Number, with optional exponent
+    if ( c.isDigit() || c == '.' ) {
+        int start = position;
+
+        while ( position < text.size() && ( text[position].isDigit() || text[position] == '.' ) ) {
+            position++;
+        }
+
+        if ( position < text.size() && ( text[position] == 'e' || text[position] == 'E' ) ) {
+            position++;
+
+            if ( position < text.size() && ( text[position] == '+' || text[position] == '-' ) ) {
+                position++;
+            }
+
+            while ( position < text.size() && text[position].isDigit() ) {
+                position++;
+            }
+        }
+
+        bool ok = false;
+        double value = text.mid( start, position - start ).toDouble( &ok );
+
+        if ( !ok ) {
+            return fail( "Bad number " + text.mid( start, position - start ) );
+        }
+
+        emitOp( PushConstant, 0, value );
+
+        return true;
+    }
+
+    if ( !c.isLetter() ) {
+        return fail( QString( "Unexpected '%1'" ).arg( c ) );
+    }
+
+    // Input name or function
+    int start = position;
+
+    while ( position < text.size() && ( text[position].isLetterOrNumber() || text[position] == '_' ) ) {
+        position++;
+    }
+
+    QString word = text.mid( start, position - start );
+    QString lower = word.toLower();
+
+    if ( accept( '(' ) ) {
+        static const char *unaryNames[] = { "abs", "sqrt", "log", "exp" };
+        static const OpCode unaryOps[] = { Abs, Sqrt, Log, Exp };
+
+        for ( int i = 0; i < 4; i++ ) {
+            if ( lower == unaryNames[i] ) {
+                if ( !parseSum() ) return false;
+                if ( !accept( ')' ) ) return fail( "Missing ')'" );
+
+                emitOp( unaryOps[i] );
+
+                return true;
+            }
+        }
+
+        if ( lower == "min" || lower == "max" ) {
+            if ( !parseSum() ) return false;
+            if ( !accept( ',' ) ) return fail( "Missing ','" );
+            if ( !parseSum() ) return false;
+            if ( !accept( ')' ) ) return fail( "Missing ')'" );
+
+            emitOp( lower == "min" ? Min : Max );
+
+            return true;
+        }
+
+        return fail( "Unknown function " + word );
+    }
+
+    for ( int i = 0; i < inputNames.size(); i++ ) {
+        if ( inputNames[i].compare( word, Qt::CaseInsensitive ) == 0 ) {
+            emitOp( PushInput, i );
+
+            return true;
+        }
+    }
+
+    return fail( "Unknown name " + word );
+}
+
+void ChannelExpression::skipSpace()
+{
+    while ( position < text.size() && text[position].isSpace() ) {
+        position++;
+    }
+}
+
+bool ChannelExpression::accept(QChar c)
+{
+    skipSpace();
+
+    if ( position < text.size() && text[position] == c ) {
+        position++;
+
+        return true;
+    }
+
+    return false;
+}
+
+bool ChannelExpression::fail(const QString &message)
+{
+    if ( error.isEmpty() ) {
+        error = message;
+    }
+
+    return false;
+}
+
+void ChannelExpression::emitOp(ChannelExpression::OpCode op, int input, double constant)
+{
+    // Constant operands are folded, so "R * ( 1 / 3 )" costs one multiply per sample
+    int size = code.size();
+    bool binary = op == Add || op == Subtract || op == Multiply || op == Divide || op == Min || op == Max;
+    bool unary = op == Negate || op == Abs || op == Sqrt || op == Log || op == Exp;
+
+    if ( unary && size >= 1 && code[size - 1].op == PushConstant ) {
+        double x = code[size - 1].constant;
+
+        switch ( op ) {
+        case Negate: x = -x; break;
+        case Abs:    x = std::fabs( x ); break;
+        case Sqrt:   x = std::sqrt( x ); break;
+        case Log:    x = std::log( x ); break;
+        default:     x = std::exp( x ); break;
+        }
+
+        code[size - 1].constant = x;
+
+        return;
+    }
+
+    if ( binary && size >= 2 && code[size - 1].op == PushConstant && code[size - 2].op == PushConstant ) {
+        double x = code[size - 2].constant;
+        double y = code[size - 1].constant;
+
+        switch ( op ) {
+        case Add:      x += y; break;
+        case Subtract: x -= y; break;
+        case Multiply: x *= y; break;
+        case Divide:   x /= y; break;
+        case Min:      x = qMin( x, y ); break;
+        default:       x = qMax( x, y ); break;
+        }
+
+        code[size - 2].constant = x;
+        code.removeLast();
+        depth--;
+
+        return;
+    }
+
+    Instruction ins;
+
+    ins.op = op;
+    ins.input = input;
+    ins.constant = constant;
+
+    code.append( ins );
+
+    if ( op == PushInput || op == PushConstant ) {
+        depth++;
+        stackDepth = qMax( stackDepth, depth );
+    } else if ( binary ) {
+        depth--;
+    }
+}
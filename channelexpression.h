@@ -0,0 +1,93 @@
+#ifndef CHANNELEXPRESSION_H
+#define CHANNELEXPRESSION_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QList>
+#include <QVarLengthArray>
+#include <QtMath>
+
+// Derived channel such as "NDI = (R - B) / (R + G + B)", compiled once to stack bytecode
+//
+//   Inputs by name ( case insensitive ), numbers, + - * / ( ), unary minus,
+//   abs( x ), sqrt( x ), log( x ), exp( x ), min( x, y ), max( x, y )
+//
+// Evaluation runs column wise over blocks of samples, every instruction is one plain loop
+// over the block, so compiler can vectorize it and work does not depend on expression size per sample
+class ChannelExpression
+{
+public:
+    enum Parameter {
+        BlockSize = 256,
+        MaxStackDepth = 16,
+        MaxNesting = 64,            // Parentheses and unary signs, parser recursion stops here
+    };
+
+    enum OpCode {
+        PushInput,
+        PushConstant,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Negate,
+        Abs,
+        Sqrt,
+        Log,
+        Exp,
+        Min,
+        Max,
+    };
+
+    struct Instruction {
+        OpCode op;
+        int input;
+        double constant;
+    };
+
+public:
+    ChannelExpression();
+
+    bool compile( const QString &text, const QStringList &inputNames );
+
+    bool isValid() const;
+    QString getName() const;
+    QString getText() const;
+    QString getError() const;
+    const QVector<Instruction> &getCode() const;
+    int getInputCount() const;
+
+    // inputs[i] points to count values of input channel i, output gets count values
+    void evaluate( const double * const *inputs, int count, double *output ) const;
+
+    // Definitions separated by ';', each "name = expression" or only expression
+    static QList<ChannelExpression> compileList( const QString &text, const QStringList &inputNames, QString *error );
+
+private:
+    bool parseSum();
+    bool parseProduct();
+    bool parseUnary();
+    bool parsePrimary();
+
+    void skipSpace();
+    bool accept( QChar c );
+    bool fail( const QString &message );
+    void emitOp( OpCode op, int input = 0, double constant = 0 );
+
+private:
+    QString name;
+    QString text;
+    QString error;
+
+    QVector<Instruction> code;
+    int stackDepth;
+
+    // Parser state
+    QStringList inputNames;
+    int position;
+    int depth;
+    int nesting;
+};
+
+#endif // CHANNELEXPRESSION_H
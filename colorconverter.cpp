@@ -0,0 +1,348 @@
+#include "colorconverter.h"
+
+#include <string.h>
+#include <math.h>
+
+namespace {
+
+// Linear to sRGB transfer function table
+struct SrgbTable {
+    enum {
+        Size = 4096,
+    };
+
+    float value[Size + 1];
+
+    SrgbTable() {
+        for ( int i = 0; i <= Size; i++ ) {
+            double c = (double)i / Size;
+
+            value[i] = ( c <= 0.0031308 ) ? 12.92 * c : 1.055 * pow( c, 1 / 2.4 ) - 0.055;
+        }
+    }
+};
+
+const SrgbTable srgbTable;
+
+// Exposure scale by lower 4 bits of control byte, manual entries are for manual time 1
+struct ExposureTable {
+    float value[16];
+
+    ExposureTable() {
+        for ( int i = 0; i < 16; i++ ) {
+            value[i] = ColorConverter::exposureScale( (ColorSensorAccess::Gain)( ( i >> 3 ) & 0x01 ),
+                                                      (ColorSensorAccess::IntegrationTime)( i & 0x03 ),
+                                                      i & ColorSensorAccess::Manual, 1 );
+        }
+    }
+};
+
+inline float fastCbrt( float v )
+{
+    // Bit level initial guess and two Newton steps, no branch so loop can be vectorized
+    uint32_t i;
+    float y;
+
+    memcpy( &i, &v, sizeof( i ) );
+    i = i / 3 + 709921077;
+    memcpy( &y, &i, sizeof( y ) );
+
+    y = ( 2.0f * y + v / ( y * y ) ) * ( 1.0f / 3.0f );
+    y = ( 2.0f * y + v / ( y * y ) ) * ( 1.0f / 3.0f );
+
+    return y;
+}
+
+inline float labF( float t )
+{
+    const float delta3 = 216.0f / 24389.0f;     // (6/29)^3
+
+    return ( t > delta3 ) ? fastCbrt( t ) : t * ( 841.0f / 108.0f ) + ( 4.0f / 29.0f );
+}
+
+}
+
+ColorConverter::ColorConverter() :
+    calibration( defaultCalibration() ),
+    exposure( 1 )
+{
+    updateEffectiveMatrix();
+}
+
+ColorConverter::Calibration ColorConverter::defaultCalibration()
+{
+    // Display equivalent weights (R 1.29, G 1.0, B 1.82) on sRGB primaries,
+    // full scale at High gain / 179.2ms gives Y = 1
+    const float srgbToXyz[3][3] = {
+        { 0.4124f, 0.3576f, 0.1805f },
+        { 0.2126f, 0.7152f, 0.0722f },
+        { 0.0193f, 0.1192f, 0.9505f },
+    };
+    const float weight[3] = { 1.29f, 1.0f, 1.82f };
+
+    Calibration cal;
+
+    for ( int row = 0; row < 3; row++ ) {
+        for ( int col = 0; col < 3; col++ ) {
+            cal.matrix[row][col] = srgbToXyz[row][col] * weight[col] / UINT16_MAX;
+        }
+
+        cal.matrix[row][3] = 0;
+        cal.irCompensation[row] = 0;
+    }
+
+    cal.whitePoint[0] = 0.95047f;
+    cal.whitePoint[1] = 1.0f;
+    cal.whitePoint[2] = 1.08883f;
+
+    return cal;
+}
+
+ColorConverter::Calibration ColorConverter::getCalibration() const
+{
+    return calibration;
+}
+
+void ColorConverter::setCalibration(const Calibration &value)
+{
+    calibration = value;
+
+    updateEffectiveMatrix();
+}
+
+bool ColorConverter::loadCalibration(QString filePath)
+{
+    // Load calibration from ini file
+    QSettings settings( filePath, QSettings::IniFormat );
+    QStringList matrix = settings.value( "calibration/matrix" ).toStringList();
+    QStringList ir = settings.value( "calibration/irCompensation", QStringList() << "0" << "0" << "0" ).toStringList();
+    QStringList white = settings.value( "calibration/whitePoint", QStringList() << "0.95047" << "1.0" << "1.08883" ).toStringList();
+
+    if ( settings.status() != QSettings::NoError || matrix.size() != 12 || ir.size() != 3 || white.size() != 3 ) {
+        return false;
+    }
+
+    Calibration cal;
+
+    for ( int row = 0; row < 3; row++ ) {
+        for ( int col = 0; col < 4; col++ ) {
+            cal.matrix[row][col] = matrix[row * 4 + col].toFloat();
+        }
+
+        cal.irCompensation[row] = ir[row].toFloat();
+        cal.whitePoint[row] = white[row].toFloat();
+    }
+
+    setCalibration( cal );
+
+    return true;
+}
+
+bool ColorConverter::saveCalibration(QString filePath) const
+{
+    QSettings settings( filePath, QSettings::IniFormat );
+    QStringList matrix, ir, white;
+
+    for ( int row = 0; row < 3; row++ ) {
+        for ( int col = 0; col < 4; col++ ) {
+            matrix << QString::number( calibration.matrix[row][col], 'g', 9 );
+        }
+
+        ir << QString::number( calibration.irCompensation[row], 'g', 9 );
+        white << QString::number( calibration.whitePoint[row], 'g', 9 );
+    }
+
+    settings.setValue( "calibration/matrix", matrix );
+    settings.setValue( "calibration/irCompensation", ir );
+    settings.setValue( "calibration/whitePoint", white );
+    settings.sync();
+
+    return settings.status() == QSettings::NoError;
+}
+
+void ColorConverter::setExposure(ColorSensorAccess::Gain gain, ColorSensorAccess::IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime)
+{
+    exposure = exposureScale( gain, intTime, manualIntegrationMode, manualTime );
+
+    updateEffectiveMatrix();
+}
+
+float ColorConverter::getExposureScale() const
+{
+    return exposure;
+}
+
+float ColorConverter::exposureScale(ColorSensorAccess::Gain gain, ColorSensorAccess::IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime)
+{
+    // Scale counts to reference setting (High gain, 179.2ms)
+    double ms = integrationTime( intTime, manualIntegrationMode, manualTime );
+
+    if ( ms <= 0 ) {
+        ms = 179.2;
+    }
+
+    // Low gain is 1/10 of High gain
+    return 179.2 / ms * ( gain == ColorSensorAccess::Low ? 10.0 : 1.0 );
+}
+
+float ColorConverter::exposureScale(const ColorSensorAccess::ColorData &data)
+{
+    static const ExposureTable table;
+
+    float scale = table.value[data.controlByte & 0x0F];
+
+    return data.isManualIntegration() ? scale / qMax<int>( 1, data.manualTime ) : scale;
+}
+
+double ColorConverter::integrationTime(ColorSensorAccess::IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime)
+{
+    // Integration time [ms]
+    double ms;
+
+    switch ( intTime ) {
+    case ColorSensorAccess::T00:
+        ms = manualIntegrationMode ? 0.175 * manualTime : 0.0875;
+        break;
+    case ColorSensorAccess::T01:
+        ms = manualIntegrationMode ? 2.8 * manualTime : 1.4;
+        break;
+    case ColorSensorAccess::T10:
+        ms = manualIntegrationMode ? 44.8 * manualTime : 22.4;
+        break;
+    case ColorSensorAccess::T11:
+    default:
+        ms = manualIntegrationMode ? 358.4 * manualTime : 179.2;
+        break;
+    }
+
+    return ms;
+}
+
+void ColorConverter::updateEffectiveMatrix()
+{
+    // Fold IR compensation and exposure into one 3x4 matrix
+    for ( int row = 0; row < 3; row++ ) {
+        float irColumn = calibration.matrix[row][3];
+
+        for ( int col = 0; col < 3; col++ ) {
+            compensated[row][col] = calibration.matrix[row][col];
+            irColumn -= calibration.matrix[row][col] * calibration.irCompensation[col];
+        }
+
+        compensated[row][3] = irColumn;
+
+        for ( int col = 0; col < 4; col++ ) {
+            effective[row][col] = compensated[row][col] * exposure;
+        }
+    }
+}
+
+void ColorConverter::rawToXYZ(const ColorSensorAccess::ColorData *data, int count, float *x, float *y, float *z) const
+{
+    const float m00 = compensated[0][0], m01 = compensated[0][1], m02 = compensated[0][2], m03 = compensated[0][3];
+    const float m10 = compensated[1][0], m11 = compensated[1][1], m12 = compensated[1][2], m13 = compensated[1][3];
+    const float m20 = compensated[2][0], m21 = compensated[2][1], m22 = compensated[2][2], m23 = compensated[2][3];
+
+    for ( int i = 0; i < count; i++ ) {
+        // Each sample carries its own gain and integration time
+        float scale = exposureScale( data[i] );
+        float r  = data[i].red * scale;
+        float g  = data[i].green * scale;
+        float b  = data[i].blue * scale;
+        float ir = data[i].infraRed * scale;
+
+        x[i] = m00 * r + m01 * g + m02 * b + m03 * ir;
+        y[i] = m10 * r + m11 * g + m12 * b + m13 * ir;
+        z[i] = m20 * r + m21 * g + m22 * b + m23 * ir;
+    }
+}
+
+void ColorConverter::rawToXYZ(const float *b, const float *g, const float *r, const float *ir, int count, float *x, float *y, float *z) const
+{
+    const float m00 = effective[0][0], m01 = effective[0][1], m02 = effective[0][2], m03 = effective[0][3];
+    const float m10 = effective[1][0], m11 = effective[1][1], m12 = effective[1][2], m13 = effective[1][3];
+    const float m20 = effective[2][0], m21 = effective[2][1], m22 = effective[2][2], m23 = effective[2][3];
+
+    for ( int i = 0; i < count; i++ ) {
+        x[i] = m00 * r[i] + m01 * g[i] + m02 * b[i] + m03 * ir[i];
+        y[i] = m10 * r[i] + m11 * g[i] + m12 * b[i] + m13 * ir[i];
+        z[i] = m20 * r[i] + m21 * g[i] + m22 * b[i] + m23 * ir[i];
+    }
+}
+
+void ColorConverter::xyzToLinearRgb(const float *x, const float *y, const float *z, int count, float *r, float *g, float *b)
+{
+    // XYZ (D65) to linear sRGB
+    for ( int i = 0; i < count; i++ ) {
+        float cx = x[i], cy = y[i], cz = z[i];
+
+        r[i] =  3.2406f * cx - 1.5372f * cy - 0.4986f * cz;
+        g[i] = -0.9689f * cx + 1.8758f * cy + 0.0415f * cz;
+        b[i] =  0.0557f * cx - 0.2040f * cy + 1.0570f * cz;
+    }
+}
+
+void ColorConverter::linearToSrgb(float *c, int count)
+{
+    // Apply sRGB transfer function in place, input is clamped to [0, 1]
+    for ( int i = 0; i < count; i++ ) {
+        float v = c[i] < 0 ? 0 : ( c[i] > 1 ? 1 : c[i] );
+        float pos = v * SrgbTable::Size;
+        int index = (int)pos;
+        int next = index < SrgbTable::Size ? index + 1 : index;
+        float frac = pos - index;
+
+        c[i] = srgbTable.value[index] + ( srgbTable.value[next] - srgbTable.value[index] ) * frac;
+    }
+}
+
+void ColorConverter::xyzToLab(const float *x, const float *y, const float *z, int count, float *l, float *a, float *b) const
+{
+    const float invXn = 1.0f / calibration.whitePoint[0];
+    const float invYn = 1.0f / calibration.whitePoint[1];
+    const float invZn = 1.0f / calibration.whitePoint[2];
+
+    for ( int i = 0; i < count; i++ ) {
+        float fx = labF( x[i] * invXn );
+        float fy = labF( y[i] * invYn );
+        float fz = labF( z[i] * invZn );
+
+        l[i] = 116.0f * fy - 16.0f;
+        a[i] = 500.0f * ( fx - fy );
+        b[i] = 200.0f * ( fy - fz );
+    }
+}
+
+void ColorConverter::toXYZ(const ColorSensorAccess::ColorData &data, float xyz[3]) const
+{
+    rawToXYZ( &data, 1, xyz + 0, xyz + 1, xyz + 2 );
+}
+
+void ColorConverter::toLab(const ColorSensorAccess::ColorData &data, float lab[3]) const
+{
+    float xyz[3];
+
+    toXYZ( data, xyz );
+    xyzToLab( xyz + 0, xyz + 1, xyz + 2, 1, lab + 0, lab + 1, lab + 2 );
+}
+
+QColor ColorConverter::toDisplayColor(const ColorSensorAccess::ColorData &data) const
+{
+    // Chromaticity for preview, brightness is normalized by largest channel
+    float xyz[3], rgb[3];
+
+    toXYZ( data, xyz );
+    xyzToLinearRgb( xyz + 0, xyz + 1, xyz + 2, 1, rgb + 0, rgb + 1, rgb + 2 );
+
+    float max = qMax( rgb[0], qMax( rgb[1], rgb[2] ) );
+
+    if ( max > 0 ) {
+        for ( int i = 0; i < 3; i++ ) {
+            rgb[i] /= max;
+        }
+    }
+
+    linearToSrgb( rgb, 3 );
+
+    return QColor::fromRgbF( rgb[0], rgb[1], rgb[2] );
+}
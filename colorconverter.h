@@ -0,0 +1,70 @@
+#ifndef COLORCONVERTER_H
+#define COLORCONVERTER_H
+
+#include <QColor>
+#include <QVector>
+#include <QString>
+#include <QSettings>
+#include <QStringList>
+
+#include <stdint.h>
+
+#include "colorsensoraccess.h"
+
+class ColorConverter
+{
+public:
+    enum Channel {
+        Blue = 0,
+        Green,
+        Red,
+        InfraRed,
+    };
+
+    struct Calibration {
+        float matrix[3][4];         // (R, G, B, IR) -> (X, Y, Z)
+        float irCompensation[3];    // IR leakage subtracted from R, G, B
+        float whitePoint[3];        // Xn, Yn, Zn
+    };
+
+public:
+    ColorConverter();
+
+    Calibration getCalibration() const;
+    void setCalibration(const Calibration &value);
+    bool loadCalibration( QString filePath );
+    bool saveCalibration( QString filePath ) const;
+    static Calibration defaultCalibration();
+
+    void setExposure( ColorSensorAccess::Gain gain, ColorSensorAccess::IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime );
+    float getExposureScale() const;
+    static float exposureScale( ColorSensorAccess::Gain gain, ColorSensorAccess::IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime );
+    static float exposureScale( const ColorSensorAccess::ColorData &data );
+    static double integrationTime( ColorSensorAccess::IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime );
+
+    // Batch kernels, arrays are structure of arrays
+    // Samples are normalized by their own gain and integration time, plain arrays by setExposure()
+    void rawToXYZ( const ColorSensorAccess::ColorData *data, int count, float *x, float *y, float *z ) const;
+    void rawToXYZ( const float *b, const float *g, const float *r, const float *ir, int count, float *x, float *y, float *z ) const;
+    static void xyzToLinearRgb( const float *x, const float *y, const float *z, int count, float *r, float *g, float *b );
+    static void linearToSrgb( float *c, int count );
+    void xyzToLab( const float *x, const float *y, const float *z, int count, float *l, float *a, float *b ) const;
+
+    // Single sample helpers
+    void toXYZ( const ColorSensorAccess::ColorData &data, float xyz[3] ) const;
+    void toLab( const ColorSensorAccess::ColorData &data, float lab[3] ) const;
+    QColor toDisplayColor( const ColorSensorAccess::ColorData &data ) const;
+
+private:
+    void updateEffectiveMatrix();
+
+private:
+    Calibration calibration;
+    float exposure;
+
+    // Matrix with IR compensation folded in, and with exposure too
+    float compensated[3][4];
+    float effective[3][4];
+};
+
+#endif // COLORCONVERTER_H
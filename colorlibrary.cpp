@@ -0,0 +1,380 @@
+#include "colorlibrary.h"
+
+#include <math.h>
+#include <algorithm>
+
+ColorLibrary::ColorLibrary() :
+    root( -1 )
+{
+
+}
+
+bool ColorLibrary::loadFile(QString filePath)
+{
+    // Comma separated "name,L,a,b", lines starting with # and header are skipped
+    QFile file( filePath );
+
+    if ( !file.open( QIODevice::ReadOnly | QIODevice::Text ) ) {
+        return false;
+    }
+
+    QTextStream stream( &file );
+    QVector<Entry> list;
+
+    while ( !stream.atEnd() ) {
+        QString line = stream.readLine().trimmed();
+
+        if ( line.isEmpty() || line.startsWith( '#' ) ) {
+            continue;
+        }
+
+        QStringList fields = line.split( ',' );
+        Entry entry;
+        bool ok[3];
+
+        if ( fields.size() < 4 ) {
+            return false;
+        }
+
+        for ( int i = 0; i < 3; i++ ) {
+            entry.lab[i] = fields[fields.size() - 3 + i].trimmed().toFloat( &ok[i] );
+        }
+
+        if ( !ok[0] || !ok[1] || !ok[2] ) {
+            if ( list.isEmpty() ) {
+                // Header
+                continue;
+            }
+
+            return false;
+        }
+
+        // Name may contain commas
+        entry.name = QStringList( fields.mid( 0, fields.size() - 3 ) ).join( ',' ).trimmed();
+
+        list.append( entry );
+    }
+
+    setEntries( list );
+
+    return true;
+}
+
+bool ColorLibrary::saveFile(QString filePath) const
+{
+    QFile file( filePath );
+
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+        return false;
+    }
+
+    QTextStream stream( &file );
+
+    stream << "name,L,a,b\n";
+
+    for ( int i = 0; i < entries.size(); i++ ) {
+        stream << entries[i].name << ',' << entries[i].lab[0] << ',' << entries[i].lab[1] << ',' << entries[i].lab[2] << '\n';
+    }
+
+    return stream.status() == QTextStream::Ok;
+}
+
+void ColorLibrary::setEntries(const QVector<Entry> &value)
+{
+    entries = value;
+
+    buildIndex();
+}
+
+const QVector<ColorLibrary::Entry> &ColorLibrary::getEntries() const
+{
+    return entries;
+}
+
+int ColorLibrary::size() const
+{
+    return entries.size();
+}
+
+void ColorLibrary::buildIndex()
+{
+    // Build once, points are stored in tree order for cache friendly search
+    int count = entries.size();
+
+    order.resize( count );
+    left.fill( -1, count );
+    right.fill( -1, count );
+    axis.fill( 0, count );
+
+    for ( int i = 0; i < count; i++ ) {
+        order[i] = i;
+    }
+
+    root = buildNode( 0, count );
+
+    points.resize( count * 3 );
+
+    for ( int i = 0; i < count; i++ ) {
+        for ( int c = 0; c < 3; c++ ) {
+            points[i * 3 + c] = entries[order[i]].lab[c];
+        }
+    }
+}
+
+int ColorLibrary::buildNode(int first, int last)
+{
+    if ( first >= last ) {
+        return -1;
+    }
+
+    // Split along widest axis at median
+    float min[3], max[3];
+
+    for ( int c = 0; c < 3; c++ ) {
+        min[c] = max[c] = entries[order[first]].lab[c];
+    }
+
+    for ( int i = first + 1; i < last; i++ ) {
+        for ( int c = 0; c < 3; c++ ) {
+            min[c] = qMin( min[c], entries[order[i]].lab[c] );
+            max[c] = qMax( max[c], entries[order[i]].lab[c] );
+        }
+    }
+
+    int ax = 0;
+
+    for ( int c = 1; c < 3; c++ ) {
+        if ( max[c] - min[c] > max[ax] - min[ax] ) {
+            ax = c;
+        }
+    }
+
+    int mid = ( first + last ) / 2;
+    const QVector<Entry> &list = entries;
+
+    std::nth_element( order.begin() + first, order.begin() + mid, order.begin() + last,
+                      [&list, ax]( int a, int b ) { return list[a].lab[ax] < list[b].lab[ax]; } );
+
+    axis[mid] = ax;
+    left[mid] = buildNode( first, mid );
+    right[mid] = buildNode( mid + 1, last );
+
+    return mid;
+}
+
+void ColorLibrary::searchNode(int node, const float lab[], int *best, float *bestDistance, int &bestCount) const
+{
+    if ( node < 0 ) {
+        return;
+    }
+
+    const float *p = points.constData() + node * 3;
+    float d0 = lab[0] - p[0], d1 = lab[1] - p[1], d2 = lab[2] - p[2];
+    float distance = d0 * d0 + d1 * d1 + d2 * d2;
+
+    // Keep sorted list of nearest candidates
+    if ( bestCount < CandidateCount || distance < bestDistance[bestCount - 1] ) {
+        int pos = bestCount < CandidateCount ? bestCount++ : bestCount - 1;
+
+        while ( pos > 0 && bestDistance[pos - 1] > distance ) {
+            bestDistance[pos] = bestDistance[pos - 1];
+            best[pos] = best[pos - 1];
+            pos--;
+        }
+
+        bestDistance[pos] = distance;
+        best[pos] = node;
+    }
+
+    int ax = axis[node];
+    float diff = lab[ax] - p[ax];
+    int nearChild = diff < 0 ? left[node] : right[node];
+    int farChild  = diff < 0 ? right[node] : left[node];
+
+    searchNode( nearChild, lab, best, bestDistance, bestCount );
+
+    if ( bestCount < CandidateCount || diff * diff < bestDistance[bestCount - 1] ) {
+        searchNode( farChild, lab, best, bestDistance, bestCount );
+    }
+}
+
+double ColorLibrary::boundRadius(double deltaE, double chroma)
+{
+    // Any entry closer than deltaE in dE00 is within this Euclidean radius, negative if no useful bound
+    // E <= dE00 * max(SL, SC, SH) / sqrt(1 - |RT|max / 2), with C' <= 1.5 C and SC growing with E
+    double denom = 1 - 2.74 * 0.03375 * deltaE;
+
+    if ( denom <= 0.05 ) {
+        return -1;
+    }
+
+    return 2.74 * deltaE * qMax( 1.75, 1 + 0.0675 * chroma ) / denom;
+}
+
+void ColorLibrary::searchRadius(int node, const float lab[], double chroma, double &radius2, Match &match) const
+{
+    if ( node < 0 ) {
+        return;
+    }
+
+    const float *p = points.constData() + node * 3;
+    float d0 = lab[0] - p[0], d1 = lab[1] - p[1], d2 = lab[2] - p[2];
+
+    if ( d0 * d0 + d1 * d1 + d2 * d2 <= radius2 ) {
+        int index = order[node];
+        double deltaE = deltaE2000( lab, entries[index].lab );
+
+        if ( deltaE < match.deltaE ) {
+            double radius = boundRadius( deltaE, chroma );
+
+            match.index = index;
+            match.deltaE = deltaE;
+            radius2 = radius * radius;
+        }
+    }
+
+    int ax = axis[node];
+    float diff = lab[ax] - p[ax];
+    int nearChild = diff < 0 ? left[node] : right[node];
+    int farChild  = diff < 0 ? right[node] : left[node];
+
+    searchRadius( nearChild, lab, chroma, radius2, match );
+
+    if ( diff * diff <= radius2 ) {
+        searchRadius( farChild, lab, chroma, radius2, match );
+    }
+}
+
+ColorLibrary::Match ColorLibrary::findNearest(const float lab[]) const
+{
+    // Exact nearest by dE00
+    Match match;
+    int best[CandidateCount];
+    float bestDistance[CandidateCount];
+    int bestCount = 0;
+
+    match.index = -1;
+    match.deltaE = 0;
+
+    if ( root < 0 ) {
+        return match;
+    }
+
+    // Euclidean neighbours give first dE00 bound D
+    searchNode( root, lab, best, bestDistance, bestCount );
+
+    for ( int i = 0; i < bestCount; i++ ) {
+        int index = order[best[i]];
+        double deltaE = deltaE2000( lab, entries[index].lab );
+
+        if ( match.index < 0 || deltaE < match.deltaE ) {
+            match.index = index;
+            match.deltaE = deltaE;
+        }
+    }
+
+    // Then every entry which can beat it is visited, bound shrinks as match improves
+    double chroma = sqrt( lab[1] * lab[1] + lab[2] * lab[2] );
+    double radius = boundRadius( match.deltaE, chroma );
+
+    if ( match.deltaE == 0 ) {
+        return match;
+    }
+
+    if ( radius < 0 ) {
+        // Far from every entry, scan all
+        for ( int i = 0; i < entries.size(); i++ ) {
+            double deltaE = deltaE2000( lab, entries[i].lab );
+
+            if ( deltaE < match.deltaE ) {
+                match.index = i;
+                match.deltaE = deltaE;
+            }
+        }
+
+        return match;
+    }
+
+    double radius2 = radius * radius;
+
+    searchRadius( root, lab, chroma, radius2, match );
+
+    return match;
+}
+
+double ColorLibrary::deltaE2000(const float lab1[], const float lab2[])
+{
+    // CIEDE2000, kL = kC = kH = 1
+    const double pow25_7 = 6103515625.0;    // 25^7
+
+    double l1 = lab1[0], a1 = lab1[1], b1 = lab1[2];
+    double l2 = lab2[0], a2 = lab2[1], b2 = lab2[2];
+
+    double c1 = sqrt( a1 * a1 + b1 * b1 );
+    double c2 = sqrt( a2 * a2 + b2 * b2 );
+    double cMean = ( c1 + c2 ) / 2;
+    double cMean7 = pow( cMean, 7 );
+    double g = 0.5 * ( 1 - sqrt( cMean7 / ( cMean7 + pow25_7 ) ) );
+
+    double a1p = ( 1 + g ) * a1;
+    double a2p = ( 1 + g ) * a2;
+    double c1p = sqrt( a1p * a1p + b1 * b1 );
+    double c2p = sqrt( a2p * a2p + b2 * b2 );
+    double h1p = ( a1p == 0 && b1 == 0 ) ? 0 : atan2( b1, a1p );
+    double h2p = ( a2p == 0 && b2 == 0 ) ? 0 : atan2( b2, a2p );
+
+    if ( h1p < 0 ) {
+        h1p += 2 * M_PI;
+    }
+
+    if ( h2p < 0 ) {
+        h2p += 2 * M_PI;
+    }
+
+    double dL = l2 - l1;
+    double dC = c2p - c1p;
+    double dh = 0;
+
+    if ( c1p * c2p != 0 ) {
+        dh = h2p - h1p;
+
+        if ( dh > M_PI ) {
+            dh -= 2 * M_PI;
+        } else if ( dh < -M_PI ) {
+            dh += 2 * M_PI;
+        }
+    }
+
+    double dH = 2 * sqrt( c1p * c2p ) * sin( dh / 2 );
+
+    double lMean = ( l1 + l2 ) / 2;
+    double cpMean = ( c1p + c2p ) / 2;
+    double hMean = h1p + h2p;
+
+    if ( c1p * c2p != 0 ) {
+        if ( fabs( h1p - h2p ) <= M_PI ) {
+            hMean /= 2;
+        } else if ( hMean < 2 * M_PI ) {
+            hMean = ( hMean + 2 * M_PI ) / 2;
+        } else {
+            hMean = ( hMean - 2 * M_PI ) / 2;
+        }
+    }
+
+    double t = 1 - 0.17 * cos( hMean - M_PI / 6 ) + 0.24 * cos( 2 * hMean )
+            + 0.32 * cos( 3 * hMean + M_PI / 30 ) - 0.20 * cos( 4 * hMean - 63 * M_PI / 180 );
+    double dTheta = 30 * M_PI / 180 * exp( -pow( ( hMean * 180 / M_PI - 275 ) / 25, 2 ) );
+    double cpMean7 = pow( cpMean, 7 );
+    double rc = 2 * sqrt( cpMean7 / ( cpMean7 + pow25_7 ) );
+    double lMean50 = ( lMean - 50 ) * ( lMean - 50 );
+    double sl = 1 + 0.015 * lMean50 / sqrt( 20 + lMean50 );
+    double sc = 1 + 0.045 * cpMean;
+    double sh = 1 + 0.015 * cpMean * t;
+    double rt = -sin( 2 * dTheta ) * rc;
+
+    double termL = dL / sl;
+    double termC = dC / sc;
+    double termH = dH / sh;
+
+    return sqrt( termL * termL + termC * termC + termH * termH + rt * termC * termH );
+}
@@ -0,0 +1,59 @@
+#ifndef COLORLIBRARY_H
+#define COLORLIBRARY_H
+
+#include <QFile>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+class ColorLibrary
+{
+public:
+    enum Parameter {
+        CandidateCount = 8,     // Euclidean neighbours giving first dE00 bound
+    };
+
+    struct Entry {
+        QString name;
+        float lab[3];
+    };
+
+    struct Match {
+        int index;              // -1 if library is empty
+        double deltaE;          // CIEDE2000
+    };
+
+public:
+    ColorLibrary();
+
+    bool loadFile( QString filePath );
+    bool saveFile( QString filePath ) const;
+    void setEntries( const QVector<Entry> &value );
+    const QVector<Entry> &getEntries() const;
+    int size() const;
+
+    Match findNearest( const float lab[3] ) const;
+
+    static double deltaE2000( const float lab1[3], const float lab2[3] );
+
+private:
+    void buildIndex();
+    int buildNode( int first, int last );
+    void searchNode( int node, const float lab[3], int *best, float *bestDistance, int &bestCount ) const;
+    void searchRadius( int node, const float lab[3], double chroma, double &radius2, Match &match ) const;
+    static double boundRadius( double deltaE, double chroma );
+
+private:
+    QVector<Entry> entries;
+
+    // Implicit k-d tree, node i covers points sorted by build, split at median
+    QVector<float> points;      // L, a, b of entry order[i]
+    QVector<int> order;
+    QVector<int> left;
+    QVector<int> right;
+    QVector<quint8> axis;
+    int root;
+};
+
+#endif // COLORLIBRARY_H
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -22,16 +22,78 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Uncomment to compile trace points out
+#DEFINES += COLORSENSOR_NO_TRACE
+
+# Let compiler vectorize batch kernels
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE += -O3
 
 SOURCES += main.cpp\
         widget.cpp \
     colorsensoraccess.cpp \
     wavegraphwidget.cpp \
-    graph.cpp
+    graph.cpp \
+    samplerecorder.cpp \
+    sampletablemodel.cpp \
+    colorconverter.cpp \
+    rollingstatistics.cpp \
+    wavedataqueue.cpp \
+    wavedatastore.cpp \
+    spectrumanalyzer.cpp \
+    triggerengine.cpp \
+    autoexposure.cpp \
+    hdrmerger.cpp \
+    darkcalibration.cpp \
+    colorlibrary.cpp \
+    rollupstore.cpp \
+    blockcodec.cpp \
+    csvimporter.cpp \
+    replaysensor.cpp \
+    pipelinebenchmark.cpp \
+    tracer.cpp \
+    metrics.cpp \
+    metricsserver.cpp \
+    sharedsamplering.cpp \
+    sharedringbenchmark.cpp \
+    streamserver.cpp \
+    streamclient.cpp \
+    channelexpression.cpp
 
 HEADERS  += widget.h \
     colorsensoraccess.h \
     wavegraphwidget.h \
-    graph.h
+    graph.h \
+    samplerecorder.h \
+    sampletablemodel.h \
+    ringbuffer.h \
+    colorconverter.h \
+    rollingstatistics.h \
+    wavedataqueue.h \
+    wavedatastore.h \
+    spectrumanalyzer.h \
+    triggerengine.h \
+    autoexposure.h \
+    hdrmerger.h \
+    darkcalibration.h \
+    colorlibrary.h \
+    rollupstore.h \
+    blockcodec.h \
+    csvimporter.h \
+    replaysensor.h \
+    pipelinebenchmark.h \
+    tracer.h \
+    metrics.h \
+    metricsserver.h \
+    sharedsampleformat.h \
+    sharedsamplereader.h \
+    sharedsamplering.h \
+    sharedringbenchmark.h \
+    streamserver.h \
+    streamclient.h \
+    channelexpression.h
 
 FORMS    += widget.ui
+
+# shm_open
+LIBS += -lrt
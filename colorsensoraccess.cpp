@@ -1,13 +1,42 @@
 #include "colorsensoraccess.h"
+#include "autoexposure.h"
+#include "hdrmerger.h"
+#include "darkcalibration.h"
+#include "colorconverter.h"
+#include "tracer.h"
+#include "metrics.h"
+#include "sharedsamplering.h"
 
 ColorSensorAccess::ColorSensorAccess(QObject *parent) : QObject(parent),
+    doReading( false ),
     sensorAddress( SensorAddress ),
     sensorPath( "/dev/i2c-1" ),
+    gain( High ),
+    intTime( T11 ),
+    manualIntegrationMode( false ),
+    manualTime( 1 ),
+    controlByte( makeControlByte( T11, false, High ) ),   // Same setting as gain and intTime above
+    autoExposure( new AutoExposure ),
+    autoExposureEnabled( false ),
+    hdrMerger( new HdrMerger ),
+    hdrEnabled( false ),
+    sweepChangedSetting( false ),
+    darkCalibration( new DarkCalibration ),
+    darkCorrectionEnabled( false ),
+    sharedRing( new SharedSampleRing ),
     file( -1 )
 {
 
 }
 
+ColorSensorAccess::~ColorSensorAccess()
+{
+    delete autoExposure;
+    delete hdrMerger;
+    delete darkCalibration;
+    delete sharedRing;
+}
+
 bool ColorSensorAccess::openSensor( QString filePath )
 {
     // Open color sensor device file
@@ -30,9 +59,6 @@ bool ColorSensorAccess::openSensor( QString filePath )
 
 bool ColorSensorAccess::initializeSensor(ColorSensorAccess::IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime, ColorSensorAccess::Gain gain)
 {
-    uint8_t bytes[4];
-    uint8_t intTimeByte = 0;
-
     if ( file < 0 ) {
         return false;
     }
@@ -43,19 +69,22 @@ bool ColorSensorAccess::initializeSensor(ColorSensorAccess::IntegrationTime intT
     this->manualIntegrationMode = manualIntegrationMode;
     this->manualTime = manualTime;
 
+    controlByte = makeControlByte( intTime, manualIntegrationMode, gain );
+    sweepChangedSetting = false;
+
+    return writeControl( controlByte, manualIntegrationMode, manualTime );
+}
+
+bool ColorSensorAccess::writeControl(uint8_t intTimeByte, bool manualIntegrationMode, uint16_t manualTime)
+{
+    TRACE_SCOPE( "writeControl" );
+
+    uint8_t bytes[4];
+
     // Register address
     bytes[0] = 0x00;
     bytes[2] = 0x00;
 
-    if ( manualIntegrationMode ) {
-        // This mode is not yet implemented
-        intTimeByte = ( gain << 3 ) | intTime | Manual;
-    } else {
-        intTimeByte = ( gain << 3 ) | intTime;
-    }
-
-    controlByte = intTimeByte;
-
     // Using simple R/W APIs
     /*
     // reset ADC, disable sleeping
@@ -90,6 +119,7 @@ bool ColorSensorAccess::initializeSensor(ColorSensorAccess::IntegrationTime intT
         // qDebug() << ret;
 
         if ( ret < 0 ) {
+            Metrics::ioctlErrors.add();
             return false;
         }
     }
@@ -119,6 +149,7 @@ bool ColorSensorAccess::initializeSensor(ColorSensorAccess::IntegrationTime intT
     // qDebug() << ret;
 
     if ( ret < 0 ) {
+        Metrics::ioctlErrors.add();
         return false;
     }
 
@@ -138,6 +169,8 @@ void ColorSensorAccess::closeSensor()
 
 void ColorSensorAccess::readColors(bool waitForIntegration)
 {
+    TRACE_SCOPE( "readColors" );
+
     uint8_t bytes[8];
 
     if ( file < 0 ) {
@@ -160,6 +193,11 @@ void ColorSensorAccess::readColors(bool waitForIntegration)
     uint8_t reg;
     int ret;
 
+    // Setting was left changed by HDR sweep
+    if ( sweepChangedSetting && !manualIntegrationMode ) {
+        initializeSensor( intTime, manualIntegrationMode, manualTime, gain );
+    }
+
     // Wait for integration
     if ( manualIntegrationMode ) {
         // Reset system, start integration
@@ -188,11 +226,13 @@ void ColorSensorAccess::readColors(bool waitForIntegration)
             ret = ioctl( file, I2C_RDWR, &i2cData );
 
             if ( ret < 0 ) {
+                Metrics::ioctlErrors.add();
                 break;
             }
         } while ( !( bytes[0] & 0x20 ) );
 
         lastElapsedNanosec = elapsed.nsecsElapsed();
+        Metrics::integrationWait.observe( lastElapsedNanosec );
     } else {
         // Wait until doing integration
         if ( waitForIntegration ) {
@@ -201,7 +241,60 @@ void ColorSensorAccess::readColors(bool waitForIntegration)
     }
 
     // Read data
-    reg = 0x03;
+    ColorData data;
+
+    if ( !readRegisters( data, controlByte, manualIntegrationMode ? manualTime : 0 ) ) {
+        Metrics::samplesDropped.add();
+        return;
+    }
+
+    publish( data );
+}
+
+void ColorSensorAccess::publish(ColorSensorAccess::ColorData data)
+{
+    TRACE_SCOPE( "publish" );
+
+    Metrics::samplesRead.add();
+
+    // Correct, range and emit, shared by every source of samples
+    mutex.lock();
+
+    if ( darkCorrectionEnabled ) {
+        darkCalibration->apply( data );
+    }
+
+    colorData = data;
+
+    // Other processes see sample before GUI does
+    sharedRing->append( colorData );
+
+    // Choose setting of next read from this sample's headroom
+    bool rangeChanged = false;
+
+    if ( autoExposureEnabled && !manualIntegrationMode ) {
+        rangeChanged = autoExposure->update( colorData );
+    }
+
+    AutoExposure::Setting next = autoExposure->getSetting( autoExposure->getStep() );
+    mutex.unlock();
+
+    emit dataRead( colorData );
+
+    if ( rangeChanged ) {
+        initializeSensor( next.intTime, false, manualTime, next.gain );
+    }
+}
+
+bool ColorSensorAccess::readRegisters(ColorSensorAccess::ColorData &data, uint8_t control, uint16_t manualTime)
+{
+    TRACE_SCOPE( "readRegisters" );
+
+    uint8_t bytes[8];
+    i2c_rdwr_ioctl_data i2cData;
+    i2c_msg i2cMsg[2];
+    uint8_t reg = 0x03;
+    int ret;
 
     i2cMsg[0].addr  = sensorAddress;
     i2cMsg[0].buf   = &reg;
@@ -220,23 +313,101 @@ void ColorSensorAccess::readColors(bool waitForIntegration)
     // qDebug() << ret;
 
     if ( ret < 0 ) {
-        return;
+        Metrics::ioctlErrors.add();
+        return false;
     }
 
     // Store data into structure
     // host processor is assumed as little endian in this block
+    data.red      = qFromBigEndian<uint16_t>( (uint16_t *)( bytes + 0 ) );
+    data.green    = qFromBigEndian<uint16_t>( (uint16_t *)( bytes + 2 ) );
+    data.blue     = qFromBigEndian<uint16_t>( (uint16_t *)( bytes + 4 ) );
+    data.infraRed = qFromBigEndian<uint16_t>( (uint16_t *)( bytes + 6 ) );
+    data.timestamp = timestampNow();
+    data.controlByte = control;
+    data.manualTime = manualTime;
+
+    return true;
+}
+
+void ColorSensorAccess::readHdrCycle()
+{
+    TRACE_SCOPE( "readHdrCycle" );
+
+    // Sweep exposures as fast as conversion allows, then merge into one sample
     mutex.lock();
-    colorData.red      = qFromBigEndian<uint16_t>( (uint16_t *)( bytes + 0 ) );
-    colorData.green    = qFromBigEndian<uint16_t>( (uint16_t *)( bytes + 2 ) );
-    colorData.blue     = qFromBigEndian<uint16_t>( (uint16_t *)( bytes + 4 ) );
-    colorData.infraRed = qFromBigEndian<uint16_t>( (uint16_t *)( bytes + 6 ) );
+    HdrMerger merger = *hdrMerger;
     mutex.unlock();
 
-    emit dataRead( colorData );
+    int count = merger.getExposureCount();
+    QVector<HdrMerger::Exposure> exposures = merger.getExposures();
+
+    hdrRaw.resize( count );
+
+    if ( file < 0 || count == 0 ) {
+        return;
+    }
+
+    QElapsedTimer cycle;
+    cycle.start();
+
+    sweepChangedSetting = true;
+
+    for ( int i = 0; i < count; i++ ) {
+        uint8_t control = makeControlByte( exposures[i].intTime, false, exposures[i].gain );
+
+        // Reset and start ADC with this exposure, registers of sensor are not copied to members
+        if ( !writeControl( control, false, 0 ) ) {
+            Metrics::samplesDropped.add();
+            return;
+        }
+
+        // Four channels are converted one after another
+        {
+            TRACE_SCOPE( "usleep" );
+
+            QThread::usleep( ColorConverter::integrationTime( exposures[i].intTime, false, 1 ) * 4 * 1000 + ConversionMarginMicrosec );
+        }
+
+        if ( !readRegisters( hdrRaw[i], control, 0 ) ) {
+            Metrics::samplesDropped.add();
+            return;
+        }
+
+        Metrics::samplesRead.add();
+
+        mutex.lock();
+
+        if ( darkCorrectionEnabled ) {
+            darkCalibration->apply( hdrRaw[i] );
+        }
+
+        sharedRing->append( hdrRaw[i] );
+        mutex.unlock();
+
+        // Every exposure is a raw sample of its own setting, consumers convert it by control byte
+        emit dataRead( hdrRaw[i] );
+    }
+
+    float merged[4];
+    HdrData hdr;
+
+    merger.merge( hdrRaw.constData(), 1, merged );
+
+    hdr.blue     = merged[0];
+    hdr.green    = merged[1];
+    hdr.red      = merged[2];
+    hdr.infraRed = merged[3];
+    hdr.timestamp = hdrRaw[0].timestamp + ( hdrRaw[count - 1].timestamp - hdrRaw[0].timestamp ) / 2;
+    hdr.cycleNanosec = cycle.nsecsElapsed();
+
+    emit hdrDataRead( hdr );
 }
 
 void ColorSensorAccess::waitIntegrationTime()
 {
+    TRACE_SCOPE( "waitIntegrationTime" );
+
     // Wait for integration time
     unsigned long ms;
 
@@ -282,6 +453,8 @@ void ColorSensorAccess::waitIntegrationTime()
         }
     }
 
+    MetricTimer timer( Metrics::integrationWait );
+
     QThread::msleep( ms );
 }
 
@@ -290,7 +463,11 @@ void ColorSensorAccess::startReading(bool continuously)
     doReading = continuously;
 
     do {
-        readColors( true );
+        if ( getHdrEnabled() ) {
+            readHdrCycle();
+        } else {
+            readColors( true );
+        }
     } while( doReading );
 }
 
@@ -308,3 +485,144 @@ qint64 ColorSensorAccess::getLastElapsedNanosec() const
 {
     return lastElapsedNanosec;
 }
+
+bool ColorSensorAccess::getAutoExposureEnabled()
+{
+    QMutexLocker locker( &mutex );
+
+    return autoExposureEnabled;
+}
+
+void ColorSensorAccess::setAutoExposureEnabled(bool value)
+{
+    // Ranging starts from current setting
+    QMutexLocker locker( &mutex );
+
+    autoExposureEnabled = value;
+    autoExposure->setStep( autoExposure->findStep( gain, intTime ) );
+}
+
+bool ColorSensorAccess::getHdrEnabled()
+{
+    QMutexLocker locker( &mutex );
+
+    return hdrEnabled;
+}
+
+void ColorSensorAccess::setHdrEnabled(bool value)
+{
+    QMutexLocker locker( &mutex );
+
+    hdrEnabled = value;
+}
+
+QString ColorSensorAccess::getHdrExposures()
+{
+    QMutexLocker locker( &mutex );
+
+    return HdrMerger::exposuresToString( hdrMerger->getExposures() );
+}
+
+bool ColorSensorAccess::setHdrExposures(QString exposures)
+{
+    // Sweep picks up new list at next cycle
+    QVector<HdrMerger::Exposure> list;
+
+    if ( !HdrMerger::parseExposures( exposures, list ) ) {
+        return false;
+    }
+
+    QMutexLocker locker( &mutex );
+
+    hdrMerger->setExposures( list );
+
+    return true;
+}
+
+bool ColorSensorAccess::getDarkCorrectionEnabled()
+{
+    QMutexLocker locker( &mutex );
+
+    return darkCorrectionEnabled;
+}
+
+void ColorSensorAccess::setDarkCorrectionEnabled(bool value)
+{
+    QMutexLocker locker( &mutex );
+
+    darkCorrectionEnabled = value;
+}
+
+void ColorSensorAccess::setDarkCalibration(const DarkCalibration &value)
+{
+    // Sensor thread keeps its own copy of the table
+    QMutexLocker locker( &mutex );
+
+    *darkCalibration = value;
+}
+
+bool ColorSensorAccess::openSharedRing(QString name, int capacity)
+{
+    QMutexLocker locker( &mutex );
+
+    return sharedRing->open( name, capacity );
+}
+
+void ColorSensorAccess::closeSharedRing()
+{
+    QMutexLocker locker( &mutex );
+
+    sharedRing->close();
+}
+
+bool ColorSensorAccess::isSharedRingOpen()
+{
+    QMutexLocker locker( &mutex );
+
+    return sharedRing->isOpen();
+}
+
+AutoExposure *ColorSensorAccess::getAutoExposure()
+{
+    return autoExposure;
+}
+
+uint8_t ColorSensorAccess::makeControlByte(ColorSensorAccess::IntegrationTime intTime, bool manualIntegrationMode, ColorSensorAccess::Gain gain)
+{
+    if ( manualIntegrationMode ) {
+        return ( gain << 3 ) | intTime | Manual;
+    } else {
+        return ( gain << 3 ) | intTime;
+    }
+}
+
+QString ColorSensorAccess::settingName(ColorSensorAccess::Gain gain, ColorSensorAccess::IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime)
+{
+    const char *timeName[] = { "T00", "T01", "T10", "T11" };
+    QString str = QString( "%1 %2" ).arg( gain == High ? "High" : "Low" ).arg( timeName[intTime & 0x03] );
+
+    if ( manualIntegrationMode ) {
+        str += QString( " x%1" ).arg( manualTime );
+    }
+
+    return str;
+}
+
+QString ColorSensorAccess::settingName(const ColorSensorAccess::ColorData &data)
+{
+    return settingName( data.getGain(), data.getIntegrationTime(), data.isManualIntegration(), data.manualTime );
+}
+
+qint64 ColorSensorAccess::timestampNow()
+{
+    // Process wide monotonic clock, shared by all consumers of sample timestamps
+    static const struct Clock {
+        QElapsedTimer timer;
+
+        Clock() {
+            timer.start();
+        }
+    } clock;
+
+    return clock.timer.nsecsElapsed();
+}
@@ -8,6 +8,7 @@
 #include <QThread>
 #include <QtEndian>
 #include <QElapsedTimer>
+#include <QVector>
 
 #include <sys/ioctl.h>
 #include <linux/i2c.h>
@@ -16,6 +17,11 @@
 #include <unistd.h>
 #include <stdint.h>
 
+class AutoExposure;
+class HdrMerger;
+class DarkCalibration;
+class SharedSampleRing;
+
 class ColorSensorAccess : public QObject
 {
     Q_OBJECT
@@ -23,6 +29,7 @@ class ColorSensorAccess : public QObject
 public:
     enum SensorParameter {
         SensorAddress = 0x2A,
+        ConversionMarginMicrosec = 500,
     };
 
     enum IntegrationTime {
@@ -43,21 +50,46 @@ public:
         uint16_t green;
         uint16_t red;
         uint16_t infraRed;
+        qint64 timestamp;   // Monotonic time of read [ns]
+        uint8_t controlByte;    // Gain and integration time this sample was taken with
+        uint16_t manualTime;
 
     public:
         QColor getColor() {
             return QColor( (double)red / UINT16_MAX * UINT8_MAX, (double)green / UINT16_MAX * UINT8_MAX, (double)blue / UINT16_MAX * UINT8_MAX );
         }
+
+        Gain getGain() const {
+            return (Gain)( ( controlByte >> 3 ) & 0x01 );
+        }
+
+        IntegrationTime getIntegrationTime() const {
+            return (IntegrationTime)( controlByte & 0x03 );
+        }
+
+        bool isManualIntegration() const {
+            return controlByte & Manual;
+        }
+    };
+
+    struct HdrData {
+        float blue;         // Counts at reference setting (High gain / T11)
+        float green;
+        float red;
+        float infraRed;
+        qint64 timestamp;   // Middle of sweep [ns]
+        qint64 cycleNanosec;
     };
 
 public:
     explicit ColorSensorAccess(QObject *parent = 0);
+    virtual ~ColorSensorAccess();
 
-    bool openSensor(QString filePath = "/dev/i2c-0");
-    bool initializeSensor(IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime, Gain gain );
-    void closeSensor();
+    virtual bool openSensor(QString filePath = "/dev/i2c-0");
+    virtual bool initializeSensor(IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime, Gain gain );
+    virtual void closeSensor();
 
-    void readColors( bool waitForIntegration );
+    virtual void readColors( bool waitForIntegration );
 
     void waitIntegrationTime();
 
@@ -65,13 +97,47 @@ public:
 
     bool getManualIntegrationMode() const;
 
+    bool getAutoExposureEnabled();
+    void setAutoExposureEnabled(bool value);
+    AutoExposure *getAutoExposure();
+
+    bool getHdrEnabled();
+    void setHdrEnabled(bool value);
+    QString getHdrExposures();
+    bool setHdrExposures( QString exposures );
+
+    bool getDarkCorrectionEnabled();
+    void setDarkCorrectionEnabled(bool value);
+    void setDarkCalibration( const DarkCalibration &value );
+
+    bool openSharedRing( QString name, int capacity );
+    void closeSharedRing();
+    bool isSharedRingOpen();
+
+    static qint64 timestampNow();
+    static uint8_t makeControlByte( IntegrationTime intTime, bool manualIntegrationMode, Gain gain );
+    static QString settingName( Gain gain, IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime );
+    static QString settingName( const ColorData &data );
+
 signals:
     void dataRead( ColorSensorAccess::ColorData data );
+    void hdrDataRead( ColorSensorAccess::HdrData data );
 
 public slots:
-    void startReading( bool continuously = false );
+    virtual void startReading( bool continuously = false );
     void stopReading();
 
+protected:
+    void publish( ColorData data );
+
+protected:
+    bool doReading;
+
+private:
+    bool writeControl( uint8_t intTimeByte, bool manualIntegrationMode, uint16_t manualTime );
+    bool readRegisters( ColorData &data, uint8_t control, uint16_t manualTime );
+    void readHdrCycle();
+
 private:
     QMutex mutex;
 
@@ -87,11 +153,27 @@ private:
     QElapsedTimer elapsed;
     qint64 lastElapsedNanosec;
 
-    bool doReading;
+    // Automatic gain and integration time ranging
+    AutoExposure *autoExposure;
+    bool autoExposureEnabled;
+
+    // Multi exposure sweep
+    HdrMerger *hdrMerger;
+    bool hdrEnabled;
+    bool sweepChangedSetting;
+    QVector<ColorData> hdrRaw;
+
+    // Dark offset and IR leakage correction, applied before publishing
+    DarkCalibration *darkCalibration;
+    bool darkCorrectionEnabled;
+
+    // Published samples for other processes
+    SharedSampleRing *sharedRing;
 
     int file;
 };
 
 Q_DECLARE_METATYPE(ColorSensorAccess::ColorData)
+Q_DECLARE_METATYPE(ColorSensorAccess::HdrData)
 
 #endif // COLORSENSORACCESS_H
@@ -0,0 +1,336 @@
+#include "csvimporter.h"
+
+#include <string.h>
+#include <stdint.h>
+
+// One chunk of file for thread pool
+class ChunkParser : public QRunnable
+{
+public:
+    ChunkParser( CsvImporter::Chunk &chunk, int columnCount, const QAtomicInt &canceled, QAtomicInteger<qint64> &parsedBytes ) :
+        chunk( chunk ),
+        columnCount( columnCount ),
+        canceled( canceled ),
+        parsedBytes( parsedBytes )
+    {
+    }
+
+    void run() {
+        CsvImporter::parseChunk( chunk, columnCount, canceled, parsedBytes );
+    }
+
+private:
+    CsvImporter::Chunk &chunk;
+    int columnCount;
+    const QAtomicInt &canceled;
+    QAtomicInteger<qint64> &parsedBytes;
+};
+
+CsvImporter::CsvImporter(QObject *parent) : QObject(parent),
+    canceled( 0 )
+{
+    result.valid = false;
+    result.canceled = false;
+    result.rowCount = 0;
+    result.columnCount = 0;
+    result.bytes = 0;
+    result.elapsedNanosec = 0;
+}
+
+void CsvImporter::cancel()
+{
+    // Called from other thread, parsers poll it
+    canceled.store( 1 );
+}
+
+CsvImporter::Result CsvImporter::getResult()
+{
+    QMutexLocker locker( &mutex );
+
+    return result;
+}
+
+QVector<qint32> CsvImporter::takeValues()
+{
+    QMutexLocker locker( &mutex );
+    QVector<qint32> ret;
+
+    ret.swap( values );
+
+    return ret;
+}
+
+int CsvImporter::parseLine(const char *&p, const char *end, qint32 *out, int maxCount)
+{
+    // Integer fields separated by comma, returns field count, 0 for empty line and -1 for error
+    int count = 0;
+
+    if ( p < end && ( *p == '\n' || *p == '\r' ) ) {
+        p += ( *p == '\r' && p + 1 < end && p[1] == '\n' ) ? 2 : 1;
+
+        return 0;
+    }
+
+    while ( true ) {
+        while ( p < end && ( *p == ' ' || *p == '\t' ) ) {
+            p++;
+        }
+
+        bool negative = false;
+
+        if ( p < end && ( *p == '-' || *p == '+' ) ) {
+            negative = *p == '-';
+            p++;
+        }
+
+        const char *digits = p;
+        qint64 value = 0;
+
+        while ( p < end && (uchar)( *p - '0' ) < 10 && p - digits < 11 ) {
+            value = value * 10 + ( *p - '0' );
+            p++;
+        }
+
+        if ( negative ) {
+            value = -value;
+        }
+
+        if ( p == digits || value > INT32_MAX || value < INT32_MIN || count >= maxCount ) {
+            break;
+        }
+
+        out[count++] = value;
+
+        while ( p < end && ( *p == ' ' || *p == '\t' ) ) {
+            p++;
+        }
+
+        if ( p >= end ) {
+            return count;
+        }
+
+        char c = *p++;
+
+        if ( c == ',' ) {
+            continue;
+        }
+
+        if ( c == '\n' ) {
+            return count;
+        }
+
+        if ( c == '\r' ) {
+            if ( p < end && *p == '\n' ) {
+                p++;
+            }
+
+            return count;
+        }
+
+        break;
+    }
+
+    // Skip rest of bad line
+    const char *newline = (const char *)memchr( p, '\n', end - p );
+
+    p = newline ? newline + 1 : end;
+
+    return -1;
+}
+
+void CsvImporter::parseChunk(Chunk &chunk, int columnCount, const QAtomicInt &canceled, QAtomicInteger<qint64> &parsedBytes)
+{
+    const char *p = chunk.begin;
+    const char *reported = p;
+    qint32 row[MaxColumnCount];
+
+    chunk.lineCount = 0;
+    chunk.errorLine = -1;
+
+    if ( canceled.load() ) {
+        return;
+    }
+
+    while ( p < chunk.end ) {
+        const char *line = p;
+        int count = parseLine( p, chunk.end, row, MaxColumnCount );
+
+        chunk.lineCount++;
+
+        if ( count == 0 ) {
+            continue;
+        }
+
+        if ( count != columnCount ) {
+            chunk.errorLine = chunk.lineCount - 1;
+            break;
+        }
+
+        // Size output from length of first line
+        if ( chunk.values.isEmpty() ) {
+            chunk.values.reserve( ( chunk.end - chunk.begin ) / ( p - line ) * columnCount * 11 / 10 + columnCount );
+        }
+
+        for ( int i = 0; i < columnCount; i++ ) {
+            chunk.values.append( row[i] );
+        }
+
+        if ( p - reported >= ProgressStep ) {
+            parsedBytes.fetchAndAddRelaxed( p - reported );
+            reported = p;
+
+            if ( canceled.load() ) {
+                break;
+            }
+        }
+    }
+
+    parsedBytes.fetchAndAddRelaxed( p - reported );
+}
+
+void CsvImporter::importFile(QString filePath)
+{
+    QElapsedTimer elapsed;
+    QVector<qint32> merged;
+    Result r;
+
+    elapsed.start();
+    canceled.store( 0 );
+
+    r.valid = false;
+    r.canceled = false;
+    r.rowCount = 0;
+    r.columnCount = 0;
+    r.bytes = 0;
+    r.elapsedNanosec = 0;
+
+    QFile file( filePath );
+
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        r.message = "Failed to open " + filePath;
+        finish( r, merged );
+
+        return;
+    }
+
+    qint64 size = file.size();
+    const char *data = size > 0 ? (const char *)file.map( 0, size ) : 0;
+
+    if ( !data ) {
+        r.message = size > 0 ? "Failed to map " + filePath : "File is empty";
+        finish( r, merged );
+
+        return;
+    }
+
+    // Column count from first line, a line which is not numbers is header
+    const char *end = data + size;
+    const char *start = data;
+    const char *p = data;
+    qint32 row[MaxColumnCount];
+    int headerLines = 0;
+    int columnCount = parseLine( p, end, row, MaxColumnCount );
+
+    if ( columnCount <= 0 ) {
+        start = p;
+        headerLines = 1;
+        columnCount = parseLine( p, end, row, MaxColumnCount );
+    }
+
+    if ( columnCount <= 0 ) {
+        file.unmap( (uchar *)data );
+
+        r.message = "No comma separated integers in " + filePath;
+        finish( r, merged );
+
+        return;
+    }
+
+    // Line aligned chunks, more than threads to even out load
+    int threadCount = qMax( 1, QThread::idealThreadCount() );
+    qint64 bytes = end - start;
+    int chunkCount = qBound( (qint64)1, bytes / MinChunkSize, (qint64)threadCount * ChunksPerThread );
+    QVector<Chunk> chunks( chunkCount );
+    const char *begin = start;
+
+    for ( int i = 0; i < chunkCount; i++ ) {
+        const char *target = i == chunkCount - 1 ? end : qMax( begin, start + bytes * ( i + 1 ) / chunkCount );
+
+        if ( target < end ) {
+            const char *newline = (const char *)memchr( target, '\n', end - target );
+
+            target = newline ? newline + 1 : end;
+        }
+
+        chunks[i].begin = begin;
+        chunks[i].end = target;
+        begin = target;
+    }
+
+    QAtomicInteger<qint64> parsedBytes( 0 );
+    QThreadPool pool;
+
+    pool.setMaxThreadCount( threadCount );
+
+    for ( int i = 0; i < chunkCount; i++ ) {
+        pool.start( new ChunkParser( chunks[i], columnCount, canceled, parsedBytes ) );
+    }
+
+    while ( !pool.waitForDone( ProgressInterval ) ) {
+        emit progress( parsedBytes.load(), bytes );
+    }
+
+    file.unmap( (uchar *)data );
+
+    r.columnCount = columnCount;
+    r.bytes = size;
+
+    if ( canceled.load() ) {
+        r.canceled = true;
+        r.message = "Canceled";
+        finish( r, merged );
+
+        return;
+    }
+
+    // Join in file order, first error is reported with its line number
+    qint64 lineNumber = headerLines;
+    qint64 total = 0;
+
+    for ( int i = 0; i < chunkCount; i++ ) {
+        if ( chunks[i].errorLine >= 0 ) {
+            r.message = QString( "Line %1 is not %2 comma separated integers" ).arg( lineNumber + chunks[i].errorLine + 1 ).arg( columnCount );
+            finish( r, merged );
+
+            return;
+        }
+
+        lineNumber += chunks[i].lineCount;
+        total += chunks[i].values.size();
+    }
+
+    merged.reserve( total );
+
+    for ( int i = 0; i < chunkCount; i++ ) {
+        merged += chunks[i].values;
+        chunks[i].values = QVector<qint32>();
+    }
+
+    emit progress( bytes, bytes );
+
+    r.valid = true;
+    r.rowCount = total / columnCount;
+    r.elapsedNanosec = elapsed.nsecsElapsed();
+
+    finish( r, merged );
+}
+
+void CsvImporter::finish(const Result &value, QVector<qint32> &data)
+{
+    mutex.lock();
+    result = value;
+    values.swap( data );
+    mutex.unlock();
+
+    emit finished( value.valid );
+}
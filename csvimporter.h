@@ -0,0 +1,75 @@
+#ifndef CSVIMPORTER_H
+#define CSVIMPORTER_H
+
+#include <QObject>
+#include <QFile>
+#include <QMutex>
+#include <QVector>
+#include <QString>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+// Loads integer CSV ( saved log ) with line aligned chunks parsed in parallel from a memory map
+class CsvImporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Parameter {
+        MaxColumnCount = 16,
+        ChunksPerThread = 4,
+        MinChunkSize = 1024 * 1024,
+        ProgressInterval = 100,         // [ms]
+        ProgressStep = 4 * 1024 * 1024, // Bytes between progress updates of a parser
+    };
+
+    struct Chunk {
+        const char *begin;
+        const char *end;
+        QVector<qint32> values;
+        qint64 lineCount;
+        qint64 errorLine;       // Line in chunk of first error, -1 if none
+    };
+
+    struct Result {
+        bool valid;
+        bool canceled;
+        qint64 rowCount;
+        int columnCount;
+        qint64 bytes;
+        qint64 elapsedNanosec;
+        QString message;
+    };
+
+public:
+    explicit CsvImporter(QObject *parent = 0);
+
+    void cancel();
+    Result getResult();
+    QVector<qint32> takeValues();
+
+    static void parseChunk( Chunk &chunk, int columnCount, const QAtomicInt &canceled, QAtomicInteger<qint64> &parsedBytes );
+    static int parseLine( const char *&p, const char *end, qint32 *out, int maxCount );
+
+public slots:
+    void importFile( QString filePath );
+
+signals:
+    void progress( qint64 doneBytes, qint64 totalBytes );
+    void finished( bool valid );
+
+private:
+    void finish( const Result &value, QVector<qint32> &data );
+
+private:
+    QMutex mutex;
+    Result result;
+    QVector<qint32> values;
+
+    QAtomicInt canceled;
+};
+
+#endif // CSVIMPORTER_H
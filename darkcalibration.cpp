@@ -0,0 +1,249 @@
+#include "darkcalibration.h"
+
+#include <string.h>
+#include <math.h>
+
+DarkCalibration::DarkCalibration() :
+    captureMode( NoCapture )
+{
+    clear();
+}
+
+DarkCalibration::Entry DarkCalibration::getEntry(int control) const
+{
+    return table[control & ( SettingCount - 1 )];
+}
+
+void DarkCalibration::setEntry(int control, const Entry &entry)
+{
+    control &= SettingCount - 1;
+
+    table[control] = entry;
+
+    updateCorrection( control );
+}
+
+void DarkCalibration::clear()
+{
+    for ( int i = 0; i < SettingCount; i++ ) {
+        memset( &table[i], 0, sizeof( Entry ) );
+
+        updateCorrection( i );
+    }
+
+    memset( captureSum, 0, sizeof( captureSum ) );
+    memset( captureCount, 0, sizeof( captureCount ) );
+}
+
+int DarkCalibration::getValidCount() const
+{
+    int count = 0;
+
+    for ( int i = 0; i < SettingCount; i++ ) {
+        if ( table[i].valid ) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+bool DarkCalibration::loadTable(QString filePath)
+{
+    // Load table from ini file, one group per setting
+    QSettings settings( filePath, QSettings::IniFormat );
+    Entry loaded[SettingCount];
+
+    if ( settings.status() != QSettings::NoError ) {
+        return false;
+    }
+
+    for ( int i = 0; i < SettingCount; i++ ) {
+        QStringList dark = settings.value( QString( "dark_%1/offset" ).arg( i, 2, 16, QChar( '0' ) ) ).toStringList();
+        QStringList ir = settings.value( QString( "dark_%1/irLeakage" ).arg( i, 2, 16, QChar( '0' ) ), QStringList() << "0" << "0" << "0" ).toStringList();
+
+        memset( &loaded[i], 0, sizeof( Entry ) );
+
+        if ( dark.isEmpty() ) {
+            continue;
+        }
+
+        if ( dark.size() != 4 || ir.size() != 3 ) {
+            return false;
+        }
+
+        for ( int ch = 0; ch < 4; ch++ ) {
+            loaded[i].dark[ch] = dark[ch].toFloat();
+        }
+
+        for ( int ch = 0; ch < 3; ch++ ) {
+            loaded[i].irLeakage[ch] = ir[ch].toFloat();
+        }
+
+        loaded[i].valid = true;
+    }
+
+    for ( int i = 0; i < SettingCount; i++ ) {
+        setEntry( i, loaded[i] );
+    }
+
+    return true;
+}
+
+bool DarkCalibration::saveTable(QString filePath) const
+{
+    QSettings settings( filePath, QSettings::IniFormat );
+
+    settings.clear();
+
+    for ( int i = 0; i < SettingCount; i++ ) {
+        if ( !table[i].valid ) {
+            continue;
+        }
+
+        QStringList dark, ir;
+
+        for ( int ch = 0; ch < 4; ch++ ) {
+            dark << QString::number( table[i].dark[ch], 'g', 9 );
+        }
+
+        for ( int ch = 0; ch < 3; ch++ ) {
+            ir << QString::number( table[i].irLeakage[ch], 'g', 9 );
+        }
+
+        settings.setValue( QString( "dark_%1/offset" ).arg( i, 2, 16, QChar( '0' ) ), dark );
+        settings.setValue( QString( "dark_%1/irLeakage" ).arg( i, 2, 16, QChar( '0' ) ), ir );
+    }
+
+    settings.sync();
+
+    return settings.status() == QSettings::NoError;
+}
+
+void DarkCalibration::beginCapture(CaptureMode mode)
+{
+    captureMode = mode;
+
+    memset( captureSum, 0, sizeof( captureSum ) );
+    memset( captureCount, 0, sizeof( captureCount ) );
+}
+
+void DarkCalibration::addSample(const ColorSensorAccess::ColorData &data)
+{
+    if ( captureMode == NoCapture ) {
+        return;
+    }
+
+    int control = data.controlByte & ( SettingCount - 1 );
+
+    captureSum[control][0] += data.blue;
+    captureSum[control][1] += data.green;
+    captureSum[control][2] += data.red;
+    captureSum[control][3] += data.infraRed;
+    captureCount[control]++;
+}
+
+int DarkCalibration::endCapture()
+{
+    // Update entries of every setting seen while capturing
+    int updated = 0;
+
+    for ( int i = 0; i < SettingCount && captureMode != NoCapture; i++ ) {
+        if ( captureCount[i] == 0 ) {
+            continue;
+        }
+
+        Entry entry = table[i];
+        double mean[4];
+
+        for ( int ch = 0; ch < 4; ch++ ) {
+            mean[ch] = captureSum[i][ch] / captureCount[i];
+        }
+
+        if ( captureMode == CaptureDark ) {
+            if ( !entry.valid ) {
+                memset( &entry, 0, sizeof( entry ) );
+            }
+
+            for ( int ch = 0; ch < 4; ch++ ) {
+                entry.dark[ch] = mean[ch];
+            }
+
+            entry.valid = true;
+        } else {
+            // IR only source, leakage is response of B, G, R to IR above dark level
+            double ir = mean[3] - ( entry.valid ? entry.dark[3] : 0 );
+
+            if ( ir < 100 ) {
+                continue;
+            }
+
+            for ( int ch = 0; ch < 3; ch++ ) {
+                entry.irLeakage[ch] = ( mean[ch] - ( entry.valid ? entry.dark[ch] : 0 ) ) / ir;
+            }
+
+            entry.valid = true;
+        }
+
+        setEntry( i, entry );
+        updated++;
+    }
+
+    captureMode = NoCapture;
+
+    return updated;
+}
+
+DarkCalibration::CaptureMode DarkCalibration::getCaptureMode() const
+{
+    return captureMode;
+}
+
+int DarkCalibration::getCapturedCount() const
+{
+    int count = 0;
+
+    for ( int i = 0; i < SettingCount; i++ ) {
+        count += captureCount[i];
+    }
+
+    return count;
+}
+
+void DarkCalibration::updateCorrection(int control)
+{
+    // Fold dark level of IR into offsets so one multiply per channel is left
+    const Entry &entry = table[control];
+    Correction &c = correction[control];
+
+    if ( !entry.valid ) {
+        memset( &c, 0, sizeof( c ) );
+
+        return;
+    }
+
+    for ( int ch = 0; ch < 3; ch++ ) {
+        c.offset[ch] = lround( entry.dark[ch] - entry.irLeakage[ch] * entry.dark[3] );
+        c.irGain[ch] = lround( entry.irLeakage[ch] * ( 1 << IrGainShift ) );
+    }
+
+    c.offset[3] = lround( entry.dark[3] );
+}
+
+void DarkCalibration::apply(ColorSensorAccess::ColorData &data) const
+{
+    // Integer correction from table, result is clamped to sensor range
+    const Correction &c = correction[data.controlByte & ( SettingCount - 1 )];
+    int64_t ir = data.infraRed;
+
+    int32_t b  = data.blue  - c.offset[0] - (int32_t)( ( ir * c.irGain[0] ) >> IrGainShift );
+    int32_t g  = data.green - c.offset[1] - (int32_t)( ( ir * c.irGain[1] ) >> IrGainShift );
+    int32_t r  = data.red   - c.offset[2] - (int32_t)( ( ir * c.irGain[2] ) >> IrGainShift );
+    int32_t i  = data.infraRed - c.offset[3];
+
+    // Saturated channels stay at full scale so range checks still see them
+    data.blue     = data.blue     == UINT16_MAX ? UINT16_MAX : qBound( 0, b, UINT16_MAX );
+    data.green    = data.green    == UINT16_MAX ? UINT16_MAX : qBound( 0, g, UINT16_MAX );
+    data.red      = data.red      == UINT16_MAX ? UINT16_MAX : qBound( 0, r, UINT16_MAX );
+    data.infraRed = data.infraRed == UINT16_MAX ? UINT16_MAX : qBound( 0, i, UINT16_MAX );
+}
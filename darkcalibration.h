@@ -0,0 +1,71 @@
+#ifndef DARKCALIBRATION_H
+#define DARKCALIBRATION_H
+
+#include <QString>
+#include <QSettings>
+#include <QStringList>
+
+#include <stdint.h>
+
+#include "colorsensoraccess.h"
+
+class DarkCalibration
+{
+public:
+    enum Parameter {
+        SettingCount = 16,      // Lower 4 bits of control byte
+        IrGainShift = 16,
+    };
+
+    enum CaptureMode {
+        NoCapture = 0,
+        CaptureDark,
+        CaptureIrReference,
+    };
+
+    struct Entry {
+        bool valid;
+        float dark[4];          // B, G, R, IR offset [counts]
+        float irLeakage[3];     // B, G, R response per IR count
+    };
+
+public:
+    DarkCalibration();
+
+    Entry getEntry( int control ) const;
+    void setEntry( int control, const Entry &entry );
+    void clear();
+    int getValidCount() const;
+
+    bool loadTable( QString filePath );
+    bool saveTable( QString filePath ) const;
+
+    // Capture workflow, samples are accumulated by their own setting
+    void beginCapture( CaptureMode mode );
+    void addSample( const ColorSensorAccess::ColorData &data );
+    int endCapture();
+    CaptureMode getCaptureMode() const;
+    int getCapturedCount() const;
+
+    void apply( ColorSensorAccess::ColorData &data ) const;
+
+private:
+    void updateCorrection( int control );
+
+private:
+    Entry table[SettingCount];
+
+    // Precomputed integer correction: v - offset - ( ir * irGain >> IrGainShift )
+    struct Correction {
+        int32_t offset[4];
+        int32_t irGain[3];
+    };
+
+    Correction correction[SettingCount];
+
+    CaptureMode captureMode;
+    double captureSum[SettingCount][4];
+    int captureCount[SettingCount];
+};
+
+#endif // DARKCALIBRATION_H
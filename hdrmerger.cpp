@@ -0,0 +1,148 @@
+#include "hdrmerger.h"
+#include "colorconverter.h"
+
+HdrMerger::HdrMerger() :
+    leastSensitive( 0 ),
+    saturationLevel( 60000 )
+{
+    QVector<Exposure> list;
+    Exposure exposure;
+
+    // Default sweep covers whole range with 10x steps
+    exposure.gain = ColorSensorAccess::Low;
+    exposure.intTime = ColorSensorAccess::T00;
+    list.append( exposure );
+
+    exposure.gain = ColorSensorAccess::Low;
+    exposure.intTime = ColorSensorAccess::T01;
+    list.append( exposure );
+
+    exposure.gain = ColorSensorAccess::Low;
+    exposure.intTime = ColorSensorAccess::T10;
+    list.append( exposure );
+
+    exposure.gain = ColorSensorAccess::High;
+    exposure.intTime = ColorSensorAccess::T10;
+    list.append( exposure );
+
+    setExposures( list );
+}
+
+QVector<HdrMerger::Exposure> HdrMerger::getExposures() const
+{
+    return exposures;
+}
+
+void HdrMerger::setExposures(const QVector<Exposure> &value)
+{
+    // Sensitivity relative to reference setting is computed once here
+    exposures = value;
+    sensitivity.resize( exposures.size() );
+    leastSensitive = 0;
+
+    for ( int i = 0; i < exposures.size(); i++ ) {
+        sensitivity[i] = 1.0f / ColorConverter::exposureScale( exposures[i].gain, exposures[i].intTime, false, 1 );
+
+        if ( sensitivity[i] < sensitivity[leastSensitive] ) {
+            leastSensitive = i;
+        }
+    }
+}
+
+int HdrMerger::getExposureCount() const
+{
+    return exposures.size();
+}
+
+int HdrMerger::getSaturationLevel() const
+{
+    return saturationLevel;
+}
+
+void HdrMerger::setSaturationLevel(int value)
+{
+    saturationLevel = value;
+}
+
+bool HdrMerger::parseExposures(QString str, QVector<Exposure> &exposures)
+{
+    // Comma separated list like "Low T00, High T10"
+    QStringList items = str.split( ',', QString::SkipEmptyParts );
+    QStringList timeNames = QStringList() << "T00" << "T01" << "T10" << "T11";
+
+    exposures.clear();
+
+    for ( int i = 0; i < items.size(); i++ ) {
+        QStringList words = items[i].simplified().split( ' ' );
+        Exposure exposure;
+
+        if ( words.size() != 2 || timeNames.indexOf( words[1].toUpper() ) < 0 ) {
+            return false;
+        }
+
+        if ( words[0].toLower() == "low" ) {
+            exposure.gain = ColorSensorAccess::Low;
+        } else if ( words[0].toLower() == "high" ) {
+            exposure.gain = ColorSensorAccess::High;
+        } else {
+            return false;
+        }
+
+        exposure.intTime = (ColorSensorAccess::IntegrationTime)timeNames.indexOf( words[1].toUpper() );
+
+        exposures.append( exposure );
+    }
+
+    return !exposures.isEmpty();
+}
+
+QString HdrMerger::exposuresToString(const QVector<Exposure> &exposures)
+{
+    QStringList items;
+
+    for ( int i = 0; i < exposures.size(); i++ ) {
+        items << ColorSensorAccess::settingName( exposures[i].gain, exposures[i].intTime, false, 0 );
+    }
+
+    return items.join( ", " );
+}
+
+void HdrMerger::merge(const ColorSensorAccess::ColorData *raw, int cycleCount, float *out) const
+{
+    // Non saturated readings weighted by exposure: sum(counts) / sum(sensitivity),
+    // result is in counts of reference setting (High gain / T11)
+    const int count = exposures.size();
+    const float *sens = sensitivity.constData();
+    const float level = (float)saturationLevel;
+
+    if ( count == 0 ) {
+        return;
+    }
+
+    for ( int cycle = 0; cycle < cycleCount; cycle++, raw += count, out += 4 ) {
+        float num[4] = { 0, 0, 0, 0 };
+        float den[4] = { 0, 0, 0, 0 };
+
+        for ( int i = 0; i < count; i++ ) {
+            const float v[4] = { (float)raw[i].blue, (float)raw[i].green, (float)raw[i].red, (float)raw[i].infraRed };
+            const float s = sens[i];
+
+            // Branch free so four channels are processed as one vector
+            for ( int ch = 0; ch < 4; ch++ ) {
+                float valid = v[ch] < level ? 1.0f : 0.0f;
+
+                num[ch] += valid * v[ch];
+                den[ch] += valid * s;
+            }
+        }
+
+        // Every exposure saturated, least sensitive one gives lower bound
+        const ColorSensorAccess::ColorData &least = raw[leastSensitive];
+        const float bound[4] = { (float)least.blue, (float)least.green, (float)least.red, (float)least.infraRed };
+        const float leastSens = sens[leastSensitive];
+
+        for ( int ch = 0; ch < 4; ch++ ) {
+            out[ch] = den[ch] > 0 ? num[ch] / den[ch] : bound[ch] / leastSens;
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef HDRMERGER_H
+#define HDRMERGER_H
+
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+#include "colorsensoraccess.h"
+
+class HdrMerger
+{
+public:
+    struct Exposure {
+        ColorSensorAccess::Gain gain;
+        ColorSensorAccess::IntegrationTime intTime;
+    };
+
+public:
+    HdrMerger();
+
+    QVector<Exposure> getExposures() const;
+    void setExposures(const QVector<Exposure> &value);
+    int getExposureCount() const;
+    int getSaturationLevel() const;
+    void setSaturationLevel(int value);
+
+    static bool parseExposures( QString str, QVector<Exposure> &exposures );
+    static QString exposuresToString( const QVector<Exposure> &exposures );
+
+    // Merge cycles of raw samples, raw holds exposure count samples per cycle, out holds B, G, R, IR per cycle
+    void merge( const ColorSensorAccess::ColorData *raw, int cycleCount, float *out ) const;
+
+private:
+    QVector<Exposure> exposures;
+    QVector<float> sensitivity;
+    int leastSensitive;
+    int saturationLevel;
+};
+
+#endif // HDRMERGER_H
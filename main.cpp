@@ -1,11 +1,152 @@
 #include "widget.h"
+#include "pipelinebenchmark.h"
+#include "tracer.h"
+#include "metricsserver.h"
+#include "sharedringbenchmark.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QJsonDocument>
+#include <QTextStream>
+
+static bool writeBenchmark( const QJsonObject &result, const QString &filePath )
+{
+    // JSON to file, or to stdout if no file is given
+    QFile file;
+
+    if ( filePath.isEmpty() ) {
+        if ( !file.open( stdout, QIODevice::WriteOnly ) ) {
+            return false;
+        }
+    } else {
+        file.setFileName( filePath );
+
+        if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+            return false;
+        }
+    }
+
+    return file.write( QJsonDocument( result ).toJson() ) > 0;
+}
 
 int main(int argc, char *argv[])
 {
+    QStringList arguments;
+
+    for ( int i = 0; i < argc; i++ ) {
+        arguments << QString::fromLocal8Bit( argv[i] );
+    }
+
+    // Options are parsed before QApplication so benchmarks can default to offscreen platform
+    QCommandLineParser parser;
+    QCommandLineOption benchOutput( "bench-output", "Write benchmark JSON to <file> instead of stdout", "file" );
+    QCommandLineOption benchPipeline( "bench-pipeline", "Drive acquisition pipeline at rising rates until saturated and write JSON" );
+    QCommandLineOption benchMaxRate( "bench-max-rate", "Highest sample rate of pipeline benchmark", "samples/s", "1000000" );
+    QCommandLineOption benchStep( "bench-step-ms", "Length of each rate step of pipeline benchmark", "ms", "2000" );
+    QCommandLineOption benchSharedRing( "bench-shared-ring", "Measure publish to read latency of shared memory ring and write JSON" );
+    QCommandLineOption benchReaders( "bench-readers", "Reader count of shared ring benchmark", "count", "2" );
+    QCommandLineOption trace( "trace", "Record trace spans and write Chrome trace JSON to <file> at exit", "file" );
+    QCommandLineOption metricsPort( "metrics-port", "Serve Prometheus metrics on localhost <port>", "port" );
+    QCommandLineOption metricsSocket( "metrics-socket", "Serve Prometheus metrics on Unix socket <path>", "path" );
+
+    parser.addHelpOption();
+    parser.addOption( benchOutput );
+    parser.addOption( benchPipeline );
+    parser.addOption( benchMaxRate );
+    parser.addOption( benchStep );
+    parser.addOption( benchSharedRing );
+    parser.addOption( benchReaders );
+    parser.addOption( trace );
+    parser.addOption( metricsPort );
+    parser.addOption( metricsSocket );
+    parser.parse( arguments );
+
+    bool benchmark = parser.isSet( benchPipeline ) || parser.isSet( benchSharedRing );
+
+    if ( benchmark && qgetenv( "QT_QPA_PLATFORM" ).isEmpty() ) {
+        qputenv( "QT_QPA_PLATFORM", "offscreen" );
+    }
+
     QApplication a(argc, argv);
-    Widget w;
-    w.show();
 
-    return a.exec();
+    QThread::currentThread()->setObjectName( "GUI" );
+    Tracer::setEnabled( parser.isSet( trace ) );
+
+    if ( parser.isSet( "help" ) ) {
+        parser.showHelp();
+    }
+
+    // Scrapes are answered in own thread, so a busy GUI does not delay them
+    QThread metricsThread;
+    MetricsServer *metrics = new MetricsServer;
+
+    metricsThread.setObjectName( "Metrics" );
+    metrics->moveToThread( &metricsThread );
+    metricsThread.start();
+
+    if ( parser.isSet( metricsPort ) ) {
+        bool ok = false;
+
+        QMetaObject::invokeMethod( metrics, "listenTcp", Qt::BlockingQueuedConnection, Q_RETURN_ARG( bool, ok ), Q_ARG( int, parser.value( metricsPort ).toInt() ) );
+
+        if ( !ok ) {
+            QTextStream( stderr ) << "Failed to listen metrics port\n";
+        }
+    }
+
+    if ( parser.isSet( metricsSocket ) ) {
+        bool ok = false;
+
+        QMetaObject::invokeMethod( metrics, "listenLocal", Qt::BlockingQueuedConnection, Q_RETURN_ARG( bool, ok ), Q_ARG( QString, parser.value( metricsSocket ) ) );
+
+        if ( !ok ) {
+            QTextStream( stderr ) << "Failed to listen metrics socket\n";
+        }
+    }
+
+    int ret = 0;
+
+    if ( benchmark ) {
+        QJsonObject result;
+
+        if ( parser.isSet( benchPipeline ) ) {
+            PipelineBenchmark bench;
+
+            bench.setMaxRate( parser.value( benchMaxRate ).toInt() );
+            bench.setStepMillisec( parser.value( benchStep ).toInt() );
+            result = bench.run();
+        } else {
+            SharedRingBenchmark bench;
+
+            bench.setReaderCount( parser.value( benchReaders ).toInt() );
+            result = bench.run();
+        }
+
+        if ( !writeBenchmark( result, parser.value( benchOutput ) ) ) {
+            QTextStream( stderr ) << "Failed to write benchmark result\n";
+
+            ret = 1;
+        }
+    } else {
+        Widget w;
+        w.show();
+
+        ret = a.exec();
+    }
+
+    QMetaObject::invokeMethod( metrics, "close", Qt::BlockingQueuedConnection );
+    metricsThread.quit();
+    metricsThread.wait( 3000 );
+
+    delete metrics;
+
+    // Dump after window and workers are gone, so their spans are complete
+    if ( parser.isSet( trace ) ) {
+        Tracer::setEnabled( false );
+
+        if ( !Tracer::writeJson( parser.value( trace ) ) ) {
+            QTextStream( stderr ) << "Failed to write trace\n";
+        }
+    }
+
+    return ret;
 }
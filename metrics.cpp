@@ -0,0 +1,96 @@
+#include "metrics.h"
+
+MetricCounter Metrics::samplesRead;
+MetricCounter Metrics::samplesDropped;
+MetricCounter Metrics::samplesDelivered;
+MetricCounter Metrics::ioctlErrors;
+MetricCounter Metrics::streamDropped;
+
+MetricHistogram Metrics::integrationWait;
+MetricHistogram Metrics::deliveryLatency;
+MetricHistogram Metrics::graphFrameTime;
+
+MetricGauge Metrics::graphQueueSize;
+
+MetricHistogram::MetricHistogram() :
+    sumNanosec( 0 )
+{
+    for ( int i = 0; i <= BucketCount; i++ ) {
+        buckets[i].store( 0 );
+    }
+}
+
+qint64 MetricHistogram::bucketBound(int index)
+{
+    // 10[us] * { 1, 2.5, 5 } * 10^n [ns]
+    const int steps[] = { 4, 10, 20 };
+    qint64 bound = 2500;
+
+    for ( int i = 0; i < index / 3; i++ ) {
+        bound *= 10;
+    }
+
+    return bound * steps[index % 3];
+}
+
+void MetricHistogram::observe(qint64 nanosec)
+{
+    int index = 0;
+
+    while ( index < BucketCount && nanosec > bucketBound( index ) ) {
+        index++;
+    }
+
+    buckets[index].fetchAndAddRelaxed( 1 );
+    sumNanosec.fetchAndAddRelaxed( nanosec );
+}
+
+void MetricHistogram::write(QByteArray &out, const char *name, const char *help) const
+{
+    // Buckets are cumulative in exposition format
+    quint64 count = 0;
+
+    out.append( QString( "# HELP %1 %2\n# TYPE %1 histogram\n" ).arg( name ).arg( help ).toUtf8() );
+
+    for ( int i = 0; i <= BucketCount; i++ ) {
+        count += buckets[i].load();
+
+        QString le = i < BucketCount ? QString::number( bucketBound( i ) / 1e9, 'g', 6 ) : QString( "+Inf" );
+
+        out.append( QString( "%1_bucket{le=\"%2\"} %3\n" ).arg( name ).arg( le ).arg( count ).toUtf8() );
+    }
+
+    out.append( QString( "%1_sum %2\n%1_count %3\n" ).arg( name ).arg( sumNanosec.load() / 1e9, 0, 'g', 12 ).arg( count ).toUtf8() );
+}
+
+static void writeCounter( QByteArray &out, const char *name, const char *help, quint64 value )
+{
+    out.append( QString( "# HELP %1 %2\n# TYPE %1 counter\n%1 %3\n" ).arg( name ).arg( help ).arg( value ).toUtf8() );
+}
+
+static void writeGauge( QByteArray &out, const char *name, const char *help, qint64 value )
+{
+    out.append( QString( "# HELP %1 %2\n# TYPE %1 gauge\n%1 %3\n" ).arg( name ).arg( help ).arg( value ).toUtf8() );
+}
+
+QByteArray Metrics::toText()
+{
+    // Rates such as samples/s are left to rate() of the scraper
+    QByteArray out;
+    quint64 read = samplesRead.get();
+    quint64 delivered = samplesDelivered.get();
+
+    writeCounter( out, "colorsensor_samples_read_total", "Samples published by sensor, replay or remote stream", read );
+    writeCounter( out, "colorsensor_samples_dropped_total", "Reads which failed and produced no sample", samplesDropped.get() );
+    writeCounter( out, "colorsensor_samples_delivered_total", "Samples handled by GUI thread", delivered );
+    writeCounter( out, "colorsensor_ioctl_errors_total", "Failed I2C transfers", ioctlErrors.get() );
+    writeCounter( out, "colorsensor_stream_dropped_total", "Samples skipped for stream subscribers which did not keep up", streamDropped.get() );
+    writeGauge( out, "colorsensor_delivery_queue_depth", "Samples published but not yet handled by GUI thread", read > delivered ? read - delivered : 0 );
+    writeGauge( out, "colorsensor_graph_queue_size", "Rows held by graph", graphQueueSize.get() );
+
+    integrationWait.write( out, "colorsensor_integration_wait_seconds", "Time waiting for sensor integration" );
+    deliveryLatency.write( out, "colorsensor_delivery_latency_seconds", "Time from sample read to GUI thread" );
+    graphFrameTime.write( out, "colorsensor_graph_frame_seconds", "Paint time of graphs" );
+
+    return out;
+}
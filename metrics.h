@@ -0,0 +1,107 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+// Lock free counter, updated from any thread
+class MetricCounter
+{
+public:
+    MetricCounter() : value( 0 ) {}
+
+    inline void add( quint64 n = 1 ) {
+        value.fetchAndAddRelaxed( n );
+    }
+
+    inline quint64 get() const {
+        return value.load();
+    }
+
+private:
+    QAtomicInteger<quint64> value;
+};
+
+class MetricGauge
+{
+public:
+    MetricGauge() : value( 0 ) {}
+
+    inline void set( qint64 v ) {
+        value.store( v );
+    }
+
+    inline void add( qint64 n ) {
+        value.fetchAndAddRelaxed( n );
+    }
+
+    inline qint64 get() const {
+        return value.load();
+    }
+
+private:
+    QAtomicInteger<qint64> value;
+};
+
+// Durations in fixed buckets of 1, 2.5, 5 steps from 10[us] to 10[s]
+class MetricHistogram
+{
+public:
+    enum Parameter {
+        BucketCount = 19,
+    };
+
+public:
+    MetricHistogram();
+
+    void observe( qint64 nanosec );
+    void write( QByteArray &out, const char *name, const char *help ) const;
+
+    static qint64 bucketBound( int index );
+
+private:
+    QAtomicInteger<quint64> buckets[BucketCount + 1];  // Last one is +Inf
+    QAtomicInteger<qint64> sumNanosec;
+};
+
+// Observes lifetime of scope
+class MetricTimer
+{
+public:
+    inline explicit MetricTimer( MetricHistogram &histogram ) :
+        histogram( histogram )
+    {
+        elapsed.start();
+    }
+
+    inline ~MetricTimer() {
+        histogram.observe( elapsed.nsecsElapsed() );
+    }
+
+private:
+    MetricHistogram &histogram;
+    QElapsedTimer elapsed;
+};
+
+// Process wide registry, written in Prometheus text exposition format
+class Metrics
+{
+public:
+    static MetricCounter samplesRead;
+    static MetricCounter samplesDropped;
+    static MetricCounter samplesDelivered;
+    static MetricCounter ioctlErrors;
+    static MetricCounter streamDropped;
+
+    static MetricHistogram integrationWait;
+    static MetricHistogram deliveryLatency;
+    static MetricHistogram graphFrameTime;
+
+    static MetricGauge graphQueueSize;
+
+public:
+    static QByteArray toText();
+};
+
+#endif // METRICS_H
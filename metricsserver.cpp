@@ -0,0 +1,135 @@
+#include "metricsserver.h"
+
+MetricsServer::MetricsServer(QObject *parent) : QObject(parent),
+    tcpServer( 0 ),
+    localServer( 0 )
+{
+}
+
+bool MetricsServer::listenTcp(int port)
+{
+    // Servers are made in slot so they belong to thread of this object
+    if ( !tcpServer ) {
+        tcpServer = new QTcpServer( this );
+
+        connect( tcpServer, SIGNAL(newConnection()), this, SLOT(acceptTcp()) );
+    }
+
+    return tcpServer->listen( QHostAddress::LocalHost, port );
+}
+
+bool MetricsServer::listenLocal(QString path)
+{
+    if ( !localServer ) {
+        localServer = new QLocalServer( this );
+
+        connect( localServer, SIGNAL(newConnection()), this, SLOT(acceptLocal()) );
+    }
+
+    // Socket file is removed only when nobody answers on it, as left by a crashed process
+    if ( localServer->listen( path ) ) {
+        return true;
+    }
+
+    if ( localServer->serverError() != QAbstractSocket::AddressInUseError ) {
+        return false;
+    }
+
+    QLocalSocket probe;
+
+    probe.connectToServer( path );
+
+    if ( probe.waitForConnected( StaleProbeMillisec ) ) {
+        probe.abort();
+
+        return false;
+    }
+
+    QLocalServer::removeServer( path );
+
+    return localServer->listen( path );
+}
+
+void MetricsServer::close()
+{
+    delete tcpServer;
+    delete localServer;
+
+    tcpServer = 0;
+    localServer = 0;
+}
+
+void MetricsServer::acceptTcp()
+{
+    while ( tcpServer->hasPendingConnections() ) {
+        accept( tcpServer->nextPendingConnection() );
+    }
+}
+
+void MetricsServer::acceptLocal()
+{
+    while ( localServer->hasPendingConnections() ) {
+        accept( localServer->nextPendingConnection() );
+    }
+}
+
+void MetricsServer::accept(QIODevice *socket)
+{
+    connect( socket, SIGNAL(readyRead()), this, SLOT(readRequest()) );
+    connect( socket, SIGNAL(disconnected()), this, SLOT(removeRequest()) );
+    connect( socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()) );
+
+    requests.insert( socket, QByteArray() );
+}
+
+void MetricsServer::removeRequest()
+{
+    // Client went away before sending whole request
+    requests.remove( qobject_cast<QIODevice *>( sender() ) );
+}
+
+void MetricsServer::readRequest()
+{
+    // Wait for end of header, body is not used
+    QIODevice *socket = qobject_cast<QIODevice *>( sender() );
+
+    if ( !socket || !requests.contains( socket ) ) {
+        return;
+    }
+
+    QByteArray &request = requests[socket];
+
+    request.append( socket->readAll() );
+
+    if ( request.contains( "\r\n\r\n" ) || request.contains( "\n\n" ) || request.size() > MaxRequestSize ) {
+        QByteArray done = request;
+
+        requests.remove( socket );
+        respond( socket, done );
+    }
+}
+
+void MetricsServer::respond(QIODevice *socket, const QByteArray &request)
+{
+    QList<QByteArray> line = request.left( request.indexOf( '\n' ) ).trimmed().split( ' ' );
+    QByteArray status = "200 OK";
+    QByteArray body;
+
+    if ( line.size() < 2 || line[0] != "GET" ) {
+        status = "405 Method Not Allowed";
+    } else if ( line[1] != "/metrics" && line[1] != "/" ) {
+        status = "404 Not Found";
+    } else {
+        body = Metrics::toText();
+    }
+
+    QByteArray response = "HTTP/1.0 " + status + "\r\n"
+                          "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                          "Content-Length: " + QByteArray::number( body.size() ) + "\r\n"
+                          "Connection: close\r\n"
+                          "\r\n" + body;
+
+    // Close flushes pending data before disconnecting
+    socket->write( response );
+    socket->close();
+}
@@ -0,0 +1,50 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QHostAddress>
+#include <QHash>
+
+#include "metrics.h"
+
+// Minimal HTTP/1.0 server answering GET /metrics, on localhost port and/or Unix socket
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Parameter {
+        MaxRequestSize = 8192,
+        StaleProbeMillisec = 100,       // Wait for live server on existing socket file
+    };
+
+public:
+    explicit MetricsServer(QObject *parent = 0);
+
+public slots:
+    bool listenTcp( int port );
+    bool listenLocal( QString path );
+    void close();
+
+private slots:
+    void acceptTcp();
+    void acceptLocal();
+    void readRequest();
+    void removeRequest();
+
+private:
+    void accept( QIODevice *socket );
+    void respond( QIODevice *socket, const QByteArray &request );
+
+private:
+    QTcpServer *tcpServer;
+    QLocalServer *localServer;
+
+    QHash<QIODevice *, QByteArray> requests;
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,371 @@
+#include "pipelinebenchmark.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QSysInfo>
+#include <QFile>
+
+#include <algorithm>
+
+#include <math.h>
+#include <unistd.h>
+#include <malloc.h>
+
+ThreadProbe::ThreadProbe(QObject *parent) : QObject(parent),
+    valid( false )
+{
+}
+
+void ThreadProbe::probe()
+{
+    thread = pthread_self();
+    valid = true;
+}
+
+qint64 ThreadProbe::getCpuNanosec()
+{
+    clockid_t clock;
+    timespec ts;
+
+    if ( !valid || pthread_getcpuclockid( thread, &clock ) != 0 || clock_gettime( clock, &ts ) != 0 ) {
+        return 0;
+    }
+
+    return (qint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+PipelineBenchmark::PipelineBenchmark(QObject *parent) : QObject(parent),
+    maxRate( 1000000 ),
+    stepMillisec( StepMillisec ),
+    deliveredCount( 0 ),
+    setDataCpuNanosec( 0 ),
+    queueDepthSum( 0 ),
+    queueDepthSamples( 0 ),
+    maxQueueDepth( 0 )
+{
+    // Application window is the consumer, shown offscreen so graph is painted
+    widget = new Widget;
+    widget->setAttribute( Qt::WA_DontShowOnScreen );
+    widget->show();
+
+    sensor = new ReplaySensor;
+    sensorProbe = new ThreadProbe;
+    sensor->moveToThread( &sensorThread );
+    sensorProbe->moveToThread( &sensorThread );
+    sensorThread.start();
+
+    recorder = new SampleRecorder;
+    recorderProbe = new ThreadProbe;
+    recorder->moveToThread( &recorderThread );
+    recorderProbe->moveToThread( &recorderThread );
+    recorderThread.start();
+
+    QMetaObject::invokeMethod( sensorProbe, "probe", Qt::BlockingQueuedConnection );
+    QMetaObject::invokeMethod( recorderProbe, "probe", Qt::BlockingQueuedConnection );
+
+    connect( sensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), this, SLOT(deliver(ColorSensorAccess::ColorData)) );
+    connect( sensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), recorder, SLOT(appendData(ColorSensorAccess::ColorData)) );
+}
+
+PipelineBenchmark::~PipelineBenchmark()
+{
+    sensor->stopReading();
+    sensorThread.quit();
+    sensorThread.wait( 3000 );
+
+    QMetaObject::invokeMethod( recorder, "closeFile", Qt::BlockingQueuedConnection );
+    recorderThread.quit();
+    recorderThread.wait( 3000 );
+
+    delete sensorProbe;
+    delete sensor;
+    delete recorderProbe;
+    delete recorder;
+    delete widget;
+}
+
+int PipelineBenchmark::getMaxRate() const
+{
+    return maxRate;
+}
+
+void PipelineBenchmark::setMaxRate(int value)
+{
+    maxRate = value;
+}
+
+int PipelineBenchmark::getStepMillisec() const
+{
+    return stepMillisec;
+}
+
+void PipelineBenchmark::setStepMillisec(int value)
+{
+    stepMillisec = value;
+}
+
+QJsonObject PipelineBenchmark::run()
+{
+    // 1, 2, 5 steps of rate, stop at first saturated step
+    QJsonArray steps;
+    int sustainedRate = 0;
+    double peakThroughput = 0;
+    bool ok = false;
+
+    QMetaObject::invokeMethod( recorder, "openFile", Qt::BlockingQueuedConnection, Q_RETURN_ARG( bool, ok ), Q_ARG( QString, recordDir.path() + "/bench.csr" ) );
+
+    for ( int decade = 1000; decade <= maxRate; decade *= 10 ) {
+        const int factors[] = { 1, 2, 5 };
+        bool saturated = false;
+
+        for ( int factor : factors ) {
+            int rate = decade * factor;
+
+            if ( rate > maxRate ) {
+                break;
+            }
+
+            Step step = runStep( rate );
+
+            steps.append( toJson( step ) );
+            peakThroughput = qMax( peakThroughput, step.throughput );
+
+            if ( step.saturated ) {
+                saturated = true;
+                break;
+            }
+
+            sustainedRate = rate;
+        }
+
+        if ( saturated ) {
+            break;
+        }
+    }
+
+    QMetaObject::invokeMethod( recorder, "closeFile", Qt::BlockingQueuedConnection );
+
+    QJsonObject root;
+
+    root["benchmark"] = QString( "pipeline" );
+    root["date"] = QDateTime::currentDateTimeUtc().toString( Qt::ISODate );
+    root["qtVersion"] = QString( qVersion() );
+    root["cpu"] = QSysInfo::currentCpuArchitecture();
+    root["threads"] = QThread::idealThreadCount();
+    root["stepMs"] = stepMillisec;
+    root["recording"] = ok;
+    root["maxSustainedRate"] = sustainedRate;
+    root["peakThroughput"] = peakThroughput;
+    root["steps"] = steps;
+
+    return root;
+}
+
+QVector<ColorSensorAccess::ColorData> PipelineBenchmark::generate(int rate, qint64 count)
+{
+    // Evenly spaced samples of fixed seed, so each run plays the same session
+    QVector<ColorSensorAccess::ColorData> records( count );
+    quint32 seed = 12345;
+
+    for ( qint64 i = 0; i < count; i++ ) {
+        ColorSensorAccess::ColorData &data = records[i];
+
+        seed = seed * 1664525 + 1013904223;
+
+        data.blue     = 10000 + 5000 * sin( i * 0.01 ) + ( seed >> 26 );
+        data.green    = 20000 + 5000 * sin( i * 0.02 ) + ( seed >> 26 );
+        data.red      = 30000 + 5000 * sin( i * 0.03 ) + ( seed >> 26 );
+        data.infraRed = 5000 + ( seed >> 24 );
+        data.timestamp = i * 1000000000 / rate;
+        data.controlByte = ColorSensorAccess::makeControlByte( ColorSensorAccess::T00, false, ColorSensorAccess::High );
+        data.manualTime = 0;
+    }
+
+    return records;
+}
+
+PipelineBenchmark::Step PipelineBenchmark::runStep(int rate)
+{
+    qint64 count = (qint64)rate * stepMillisec / 1000;
+    Step step;
+
+    sensor->setRecords( generate( rate, count ) );
+    sensor->setSpeed( 1 );
+
+    latencies.clear();
+    latencies.reserve( count );
+    deliveredCount = 0;
+    setDataCpuNanosec = 0;
+    queueDepthSum = 0;
+    queueDepthSamples = 0;
+    maxQueueDepth = 0;
+
+    qint64 resident = residentBytes();
+    qint64 heap = heapInUse();
+    qint64 sensorCpu = sensorProbe->getCpuNanosec();
+    qint64 recorderCpu = recorderProbe->getCpuNanosec();
+    qint64 guiCpu = threadCpuNanosec();
+
+    QTimer queueTimer;
+    QEventLoop loop;
+    QElapsedTimer elapsed;
+
+    queueTimer.setInterval( QueueSampleMillisec );
+    connect( &queueTimer, SIGNAL(timeout()), this, SLOT(sampleQueue()) );
+    connect( sensor, SIGNAL(replayFinished()), &loop, SLOT(quit()) );
+
+    elapsed.start();
+    queueTimer.start();
+
+    QMetaObject::invokeMethod( sensor, "startReading", Qt::QueuedConnection, Q_ARG( bool, true ) );
+    loop.exec();
+
+    // Finished signal is queued behind samples, wait anyway if something is still in flight
+    qint64 emitted = sensor->getStatistics().sampleCount;
+
+    while ( deliveredCount < emitted && elapsed.elapsed() < stepMillisec + DrainTimeoutMillisec ) {
+        QCoreApplication::processEvents( QEventLoop::AllEvents, QueueSampleMillisec );
+    }
+
+    step.elapsedNanosec = elapsed.nsecsElapsed();
+    queueTimer.stop();
+
+    // Let graph repaint and recorder catch up before reading CPU time
+    QCoreApplication::processEvents();
+    QMetaObject::invokeMethod( recorder, "commit", Qt::BlockingQueuedConnection );
+
+    step.rate = rate;
+    step.emittedCount = emitted;
+    step.deliveredCount = deliveredCount;
+    step.throughput = deliveredCount / ( step.elapsedNanosec / 1e9 );
+    step.sensorCpuNanosec = sensorProbe->getCpuNanosec() - sensorCpu;
+    step.recorderCpuNanosec = recorderProbe->getCpuNanosec() - recorderCpu;
+    step.guiCpuNanosec = threadCpuNanosec() - guiCpu;
+    step.setDataCpuNanosec = setDataCpuNanosec;
+    step.maxQueueDepth = maxQueueDepth;
+    step.meanQueueDepth = queueDepthSamples ? (double)queueDepthSum / queueDepthSamples : 0;
+    step.residentGrowthBytes = residentBytes() - resident;
+    step.heapGrowthBytes = heapInUse() - heap;
+
+    std::sort( latencies.begin(), latencies.end() );
+
+    step.latencyP50 = percentile( latencies, 0.5 );
+    step.latencyP90 = percentile( latencies, 0.9 );
+    step.latencyP99 = percentile( latencies, 0.99 );
+    step.latencyP999 = percentile( latencies, 0.999 );
+    step.latencyMax = latencies.isEmpty() ? 0 : latencies.last();
+
+    step.saturated = deliveredCount < count ||
+                     step.throughput * 100 < (double)rate * MinThroughputPercent ||
+                     step.latencyP99 > (qint64)MaxLatencyMillisec * 1000000;
+
+    return step;
+}
+
+void PipelineBenchmark::deliver(ColorSensorAccess::ColorData data)
+{
+    // Queue wait is from emission to here, stage cost is CPU time of setData
+    qint64 start = threadCpuNanosec();
+
+    latencies.append( ColorSensorAccess::timestampNow() - data.timestamp );
+    deliveredCount++;
+
+    widget->setData( data );
+
+    setDataCpuNanosec += threadCpuNanosec() - start;
+}
+
+void PipelineBenchmark::sampleQueue()
+{
+    // Emitted but not yet delivered to GUI thread
+    int depth = sensor->getStatistics().sampleCount - deliveredCount;
+
+    queueDepthSum += depth;
+    queueDepthSamples++;
+    maxQueueDepth = qMax( maxQueueDepth, depth );
+}
+
+QJsonObject PipelineBenchmark::toJson(const PipelineBenchmark::Step &step)
+{
+    QJsonObject json;
+    QJsonObject cpu;
+    QJsonObject latency;
+    QJsonObject queue;
+    QJsonObject memory;
+
+    cpu["sensorMs"] = step.sensorCpuNanosec / 1e6;
+    cpu["guiMs"] = step.guiCpuNanosec / 1e6;
+    cpu["setDataMs"] = step.setDataCpuNanosec / 1e6;
+    cpu["recorderMs"] = step.recorderCpuNanosec / 1e6;
+
+    latency["p50Ms"] = step.latencyP50 / 1e6;
+    latency["p90Ms"] = step.latencyP90 / 1e6;
+    latency["p99Ms"] = step.latencyP99 / 1e6;
+    latency["p999Ms"] = step.latencyP999 / 1e6;
+    latency["maxMs"] = step.latencyMax / 1e6;
+
+    queue["max"] = step.maxQueueDepth;
+    queue["mean"] = step.meanQueueDepth;
+
+    memory["residentGrowthBytes"] = (double)step.residentGrowthBytes;
+    memory["heapGrowthBytes"] = (double)step.heapGrowthBytes;
+
+    json["rate"] = step.rate;
+    json["emitted"] = (double)step.emittedCount;
+    json["delivered"] = (double)step.deliveredCount;
+    json["elapsedMs"] = step.elapsedNanosec / 1e6;
+    json["throughput"] = step.throughput;
+    json["cpu"] = cpu;
+    json["latency"] = latency;
+    json["queueDepth"] = queue;
+    json["memory"] = memory;
+    json["saturated"] = step.saturated;
+
+    return json;
+}
+
+qint64 PipelineBenchmark::percentile(const QVector<qint64> &sorted, double ratio)
+{
+    if ( sorted.isEmpty() ) {
+        return 0;
+    }
+
+    return sorted[qMin( sorted.size() - 1, (int)( sorted.size() * ratio ) )];
+}
+
+qint64 PipelineBenchmark::residentBytes()
+{
+    // Second field of statm is resident pages
+    QFile statm( "/proc/self/statm" );
+
+    if ( !statm.open( QIODevice::ReadOnly ) ) {
+        return 0;
+    }
+
+    QList<QByteArray> fields = statm.readAll().split( ' ' );
+
+    return fields.size() > 1 ? fields[1].toLongLong() * sysconf( _SC_PAGESIZE ) : 0;
+}
+
+qint64 PipelineBenchmark::heapInUse()
+{
+    // Bytes allocated by malloc, glibc only
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ( 2, 33 )
+    return mallinfo2().uordblks;
+#else
+    return (unsigned int)mallinfo().uordblks;
+#endif
+#else
+    return 0;
+#endif
+}
+
+qint64 PipelineBenchmark::threadCpuNanosec()
+{
+    timespec ts;
+
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+
+    return (qint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
@@ -0,0 +1,124 @@
+#ifndef PIPELINEBENCHMARK_H
+#define PIPELINEBENCHMARK_H
+
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QTimer>
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include <pthread.h>
+#include <time.h>
+
+#include "widget.h"
+#include "replaysensor.h"
+#include "samplerecorder.h"
+
+// Remembers the thread it was called in, so CPU time of that thread can be read from others
+class ThreadProbe : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ThreadProbe(QObject *parent = 0);
+
+    qint64 getCpuNanosec();
+
+public slots:
+    void probe();
+
+private:
+    pthread_t thread;
+    bool valid;
+};
+
+// Drives sensor signal, Widget::setData, log, graph and recorder at rising rates until saturated
+class PipelineBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Parameter {
+        StepMillisec = 2000,            // Length of session played at each rate
+        DrainTimeoutMillisec = 10000,
+        QueueSampleMillisec = 10,
+        MaxLatencyMillisec = 100,       // Step is saturated if p99 latency is above
+        MinThroughputPercent = 95,      // or throughput is below this part of rate
+    };
+
+    struct Step {
+        int rate;
+        qint64 emittedCount;
+        qint64 deliveredCount;
+        qint64 elapsedNanosec;
+        double throughput;
+        qint64 sensorCpuNanosec;
+        qint64 guiCpuNanosec;
+        qint64 setDataCpuNanosec;
+        qint64 recorderCpuNanosec;
+        int maxQueueDepth;
+        double meanQueueDepth;
+        qint64 latencyP50;
+        qint64 latencyP90;
+        qint64 latencyP99;
+        qint64 latencyP999;
+        qint64 latencyMax;
+        qint64 residentGrowthBytes;
+        qint64 heapGrowthBytes;
+        bool saturated;
+    };
+
+public:
+    explicit PipelineBenchmark(QObject *parent = 0);
+    ~PipelineBenchmark();
+
+    int getMaxRate() const;
+    void setMaxRate(int value);
+    int getStepMillisec() const;
+    void setStepMillisec(int value);
+
+    QJsonObject run();
+
+    static qint64 residentBytes();
+    static qint64 heapInUse();
+    static qint64 threadCpuNanosec();
+
+private slots:
+    void deliver( ColorSensorAccess::ColorData data );
+    void sampleQueue();
+
+private:
+    Step runStep( int rate );
+    QVector<ColorSensorAccess::ColorData> generate( int rate, qint64 count );
+    QJsonObject toJson( const Step &step );
+    static qint64 percentile( const QVector<qint64> &sorted, double ratio );
+
+private:
+    Widget *widget;
+
+    QThread sensorThread;
+    ReplaySensor *sensor;
+    ThreadProbe *sensorProbe;
+
+    QThread recorderThread;
+    SampleRecorder *recorder;
+    ThreadProbe *recorderProbe;
+    QTemporaryDir recordDir;
+
+    int maxRate;
+    int stepMillisec;
+
+    // Counters of running step, GUI thread only
+    QVector<qint64> latencies;
+    qint64 deliveredCount;
+    qint64 setDataCpuNanosec;
+    qint64 queueDepthSum;
+    int queueDepthSamples;
+    int maxQueueDepth;
+};
+
+#endif // PIPELINEBENCHMARK_H
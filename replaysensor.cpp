@@ -0,0 +1,175 @@
+#include "replaysensor.h"
+#include "samplerecorder.h"
+
+ReplaySensor::ReplaySensor(QObject *parent) : ColorSensorAccess(parent),
+    position( 0 ),
+    speed( 1 )
+{
+    statistics.recordCount = 0;
+    statistics.sampleCount = 0;
+    statistics.elapsedNanosec = 0;
+    statistics.maxLagNanosec = 0;
+}
+
+bool ReplaySensor::openSensor(QString filePath)
+{
+    // Whole recording is loaded, so playback timing does not depend on disk
+    QVector<ColorData> data;
+
+    if ( !SampleRecorder::readFile( filePath, data ) || data.isEmpty() ) {
+        return false;
+    }
+
+    setRecords( data );
+
+    return true;
+}
+
+void ReplaySensor::setRecords(const QVector<ColorSensorAccess::ColorData> &value)
+{
+    // Generated sessions are played like recorded ones
+    replayMutex.lock();
+    records = value;
+    replayMutex.unlock();
+
+    rewind();
+}
+
+bool ReplaySensor::initializeSensor(ColorSensorAccess::IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime, ColorSensorAccess::Gain gain)
+{
+    // Each recorded sample carries its own setting
+    Q_UNUSED( intTime );
+    Q_UNUSED( manualIntegrationMode );
+    Q_UNUSED( manualTime );
+    Q_UNUSED( gain );
+
+    QMutexLocker locker( &replayMutex );
+
+    return !records.isEmpty();
+}
+
+void ReplaySensor::closeSensor()
+{
+    QMutexLocker locker( &replayMutex );
+
+    records.clear();
+    position = 0;
+}
+
+void ReplaySensor::readColors(bool waitForIntegration)
+{
+    Q_UNUSED( waitForIntegration );
+
+    replayMutex.lock();
+
+    if ( position >= records.size() ) {
+        replayMutex.unlock();
+
+        return;
+    }
+
+    // Stamped at emission like a live read, so consumers measure latency from here
+    ColorData data = records[position++];
+
+    statistics.sampleCount++;
+    replayMutex.unlock();
+
+    data.timestamp = timestampNow();
+
+    publish( data );
+}
+
+void ReplaySensor::rewind()
+{
+    QMutexLocker locker( &replayMutex );
+
+    position = 0;
+
+    statistics.recordCount = records.size();
+    statistics.sampleCount = 0;
+    statistics.elapsedNanosec = 0;
+    statistics.maxLagNanosec = 0;
+}
+
+double ReplaySensor::getSpeed()
+{
+    QMutexLocker locker( &replayMutex );
+
+    return speed;
+}
+
+void ReplaySensor::setSpeed(double value)
+{
+    QMutexLocker locker( &replayMutex );
+
+    speed = value;
+}
+
+ReplaySensor::Statistics ReplaySensor::getStatistics()
+{
+    QMutexLocker locker( &replayMutex );
+
+    return statistics;
+}
+
+void ReplaySensor::startReading(bool continuously)
+{
+    // Schedule starts at the first sample played by this call
+    doReading = continuously;
+
+    replayMutex.lock();
+    int count = records.size();
+    int index = position;
+    double rate = speed;
+    qint64 recordedStart = index < count ? records[index].timestamp : 0;
+    replayMutex.unlock();
+
+    qint64 start = timestampNow();
+
+    while ( index < count ) {
+        if ( continuously && rate > 0 ) {
+            replayMutex.lock();
+
+            // Recording was closed meanwhile
+            if ( index >= records.size() ) {
+                replayMutex.unlock();
+                break;
+            }
+
+            qint64 due = start + (qint64)( ( records[index].timestamp - recordedStart ) / rate );
+            replayMutex.unlock();
+
+            qint64 wait;
+
+            while ( doReading && ( wait = due - timestampNow() ) > 0 ) {
+                QThread::usleep( qMin( wait / 1000, (qint64)WaitSliceMillisec * 1000 ) + 1 );
+            }
+
+            qint64 lag = timestampNow() - due;
+
+            replayMutex.lock();
+            statistics.maxLagNanosec = qMax( statistics.maxLagNanosec, lag );
+            replayMutex.unlock();
+        }
+
+        if ( continuously && !doReading ) {
+            break;
+        }
+
+        readColors( false );
+        index++;
+
+        if ( !doReading ) {
+            break;
+        }
+    }
+
+    replayMutex.lock();
+    statistics.elapsedNanosec += timestampNow() - start;
+    replayMutex.unlock();
+
+    // Stopped or played to the end
+    if ( continuously || index >= count ) {
+        emit replayFinished();
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef REPLAYSENSOR_H
+#define REPLAYSENSOR_H
+
+#include <QObject>
+#include <QMutex>
+#include <QVector>
+#include <QThread>
+
+#include "colorsensoraccess.h"
+
+// Virtual sensor playing a recording through the same signals as live data
+class ReplaySensor : public ColorSensorAccess
+{
+    Q_OBJECT
+
+public:
+    enum Parameter {
+        WaitSliceMillisec = 20,     // Longest sleep, stop request is checked between slices
+    };
+
+    struct Statistics {
+        qint64 recordCount;
+        qint64 sampleCount;
+        qint64 elapsedNanosec;
+        qint64 maxLagNanosec;       // Worst delay behind schedule
+    };
+
+public:
+    explicit ReplaySensor(QObject *parent = 0);
+
+    bool openSensor( QString filePath );
+    bool initializeSensor( IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime, Gain gain );
+    void closeSensor();
+
+    void readColors( bool waitForIntegration );
+
+    void setRecords( const QVector<ColorData> &value );
+    void rewind();
+
+    double getSpeed();
+    void setSpeed( double value );
+
+    Statistics getStatistics();
+
+public slots:
+    void startReading( bool continuously = false );
+
+signals:
+    void replayFinished();
+
+private:
+    QMutex replayMutex;
+
+    QVector<ColorData> records;
+    int position;
+
+    double speed;               // Times of original rate, 0 for as fast as possible
+
+    Statistics statistics;
+};
+
+#endif // REPLAYSENSOR_H
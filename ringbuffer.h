@@ -0,0 +1,131 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <QVector>
+
+// Fixed capacity FIFO, the oldest element is overwritten when full
+template <typename T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer( int capacity = 0 ) :
+        buffer( capacity ),
+        head( 0 ),
+        count( 0 )
+    {
+    }
+
+    void setCapacity( int capacity )
+    {
+        buffer = QVector<T>( capacity );
+        head = 0;
+        count = 0;
+    }
+
+    int capacity() const
+    {
+        return buffer.size();
+    }
+
+    int size() const
+    {
+        return count;
+    }
+
+    bool isEmpty() const
+    {
+        return count == 0;
+    }
+
+    bool isFull() const
+    {
+        return count == buffer.size();
+    }
+
+    void clear()
+    {
+        head = 0;
+        count = 0;
+    }
+
+    void append( const T &value )
+    {
+        if ( buffer.size() == 0 ) {
+            return;
+        }
+
+        if ( count == buffer.size() ) {
+            // Overwrite oldest
+            buffer[head] = value;
+            head = ( head + 1 ) % buffer.size();
+        } else {
+            buffer[( head + count ) % buffer.size()] = value;
+            count++;
+        }
+    }
+
+    void removeFirst( int n = 1 )
+    {
+        if ( n > count ) {
+            n = count;
+        }
+
+        if ( buffer.size() > 0 ) {
+            head = ( head + n ) % buffer.size();
+        }
+
+        count -= n;
+    }
+
+    void removeLast( int n = 1 )
+    {
+        if ( n > count ) {
+            n = count;
+        }
+
+        count -= n;
+    }
+
+    const T &at( int index ) const
+    {
+        return buffer[position( index )];
+    }
+
+    T &operator[]( int index )
+    {
+        return buffer[position( index )];
+    }
+
+    const T &operator[]( int index ) const
+    {
+        return at( index );
+    }
+
+    const T &first() const
+    {
+        return at( 0 );
+    }
+
+    const T &last() const
+    {
+        return at( count - 1 );
+    }
+
+private:
+    int position( int index ) const
+    {
+        // Index must be below size as with QVector, so empty or zero capacity buffer has no valid index
+        Q_ASSERT( index >= 0 && index < count );
+
+        int i = head + index;
+
+        return i >= buffer.size() ? i - buffer.size() : i;
+    }
+
+private:
+    QVector<T> buffer;
+    int head;
+    int count;
+};
+
+#endif // RINGBUFFER_H
@@ -0,0 +1,175 @@
+#include "rollingstatistics.h"
+
+#include <math.h>
+
+RollingStatistics::RollingStatistics(QObject *parent) : QObject(parent),
+    nextSeq( 0 ),
+    windowCount( 100 ),
+    windowNanosec( 0 )
+{
+    resetBuffers();
+}
+
+int RollingStatistics::getWindowCount() const
+{
+    return windowCount;
+}
+
+void RollingStatistics::setWindowCount(int value)
+{
+    // Buffers are sized by window, so statistics restart
+    windowCount = qMax( 1, value );
+
+    resetBuffers();
+}
+
+qint64 RollingStatistics::getWindowTime() const
+{
+    return windowNanosec / 1000000;
+}
+
+void RollingStatistics::setWindowTime(qint64 msec)
+{
+    // 0 disables time window
+    windowNanosec = qMax( (qint64)0, msec ) * 1000000;
+}
+
+void RollingStatistics::appendData(ColorSensorAccess::ColorData data)
+{
+    // Push new sample, each step is O(1) amortized per channel
+    Entry entry;
+
+    entry.seq = nextSeq++;
+    entry.timestamp = data.timestamp;
+    entry.value[0] = data.blue;
+    entry.value[1] = data.green;
+    entry.value[2] = data.red;
+    entry.value[3] = data.infraRed;
+
+    // Slide window by count
+    if ( window.isFull() ) {
+        removeFirst();
+    }
+
+    window.append( entry );
+
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        Accumulator &acc = accumulator[ch];
+        double x = entry.value[ch];
+        double delta = x - acc.mean;
+
+        acc.count++;
+        acc.mean += delta / acc.count;
+        acc.m2 += delta * ( x - acc.mean );
+
+        // Drop values which can never be extreme again
+        while ( !minDeque[ch].isEmpty() && minDeque[ch].last().second >= x ) {
+            minDeque[ch].removeLast();
+        }
+        minDeque[ch].append( qMakePair( entry.seq, x ) );
+
+        while ( !maxDeque[ch].isEmpty() && maxDeque[ch].last().second <= x ) {
+            maxDeque[ch].removeLast();
+        }
+        maxDeque[ch].append( qMakePair( entry.seq, x ) );
+    }
+
+    // Slide window by time
+    if ( windowNanosec > 0 ) {
+        while ( window.size() > 1 && data.timestamp - window.first().timestamp > windowNanosec ) {
+            removeFirst();
+        }
+    }
+
+    emit updated();
+}
+
+void RollingStatistics::removeFirst()
+{
+    // Remove oldest sample from accumulators
+    Entry entry = window.first();
+
+    window.removeFirst();
+
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        Accumulator &acc = accumulator[ch];
+        double x = entry.value[ch];
+
+        if ( acc.count <= 1 ) {
+            acc.count = 0;
+            acc.mean = 0;
+            acc.m2 = 0;
+        } else {
+            double oldMean = acc.mean;
+
+            acc.count--;
+            acc.mean = ( oldMean * ( acc.count + 1 ) - x ) / acc.count;
+            acc.m2 -= ( x - oldMean ) * ( x - acc.mean );
+
+            if ( acc.m2 < 0 ) {
+                acc.m2 = 0;
+            }
+        }
+
+        if ( !minDeque[ch].isEmpty() && minDeque[ch].first().first == entry.seq ) {
+            minDeque[ch].removeFirst();
+        }
+
+        if ( !maxDeque[ch].isEmpty() && maxDeque[ch].first().first == entry.seq ) {
+            maxDeque[ch].removeFirst();
+        }
+    }
+}
+
+void RollingStatistics::resetBuffers()
+{
+    // Deques never hold more than window
+    window.setCapacity( windowCount );
+
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        minDeque[ch].setCapacity( windowCount );
+        maxDeque[ch].setCapacity( windowCount );
+    }
+
+    clear();
+}
+
+void RollingStatistics::clear()
+{
+    window.clear();
+
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        accumulator[ch].count = 0;
+        accumulator[ch].mean = 0;
+        accumulator[ch].m2 = 0;
+
+        minDeque[ch].clear();
+        maxDeque[ch].clear();
+    }
+}
+
+RollingStatistics::ChannelStatistics RollingStatistics::getStatistics(int channel) const
+{
+    ChannelStatistics stat;
+    const Accumulator &acc = accumulator[channel];
+
+    stat.count  = acc.count;
+    stat.mean   = acc.mean;
+    stat.stdDev = acc.count > 1 ? sqrt( acc.m2 / ( acc.count - 1 ) ) : 0;
+    stat.min    = minDeque[channel].isEmpty() ? 0 : minDeque[channel].first().second;
+    stat.max    = maxDeque[channel].isEmpty() ? 0 : maxDeque[channel].first().second;
+    stat.cv     = acc.mean != 0 ? stat.stdDev / acc.mean : 0;
+
+    return stat;
+}
+
+QVector<RollingStatistics::ChannelStatistics> RollingStatistics::getAllStatistics() const
+{
+    QVector<ChannelStatistics> ret;
+
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        ret.append( getStatistics( ch ) );
+    }
+
+    return ret;
+}
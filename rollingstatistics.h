@@ -0,0 +1,80 @@
+#ifndef ROLLINGSTATISTICS_H
+#define ROLLINGSTATISTICS_H
+
+#include <QObject>
+#include <QPair>
+#include <QVector>
+
+#include "colorsensoraccess.h"
+#include "ringbuffer.h"
+
+class RollingStatistics : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Parameter {
+        ChannelCount = 4,
+    };
+
+    struct ChannelStatistics {
+        qint64 count;
+        double mean;
+        double stdDev;
+        double min;
+        double max;
+        double cv;
+    };
+
+private:
+    struct Entry {
+        qint64 seq;
+        qint64 timestamp;
+        double value[ChannelCount];
+    };
+
+    // Welford accumulator with removal
+    struct Accumulator {
+        qint64 count;
+        double mean;
+        double m2;
+    };
+
+    // Monotonic deque, front is the extreme of current window
+    typedef RingBuffer<QPair<qint64, double> > MonotonicDeque;
+
+public:
+    explicit RollingStatistics(QObject *parent = 0);
+
+    int getWindowCount() const;
+    void setWindowCount(int value);
+    qint64 getWindowTime() const;
+    void setWindowTime(qint64 msec);
+
+    ChannelStatistics getStatistics( int channel ) const;
+    QVector<ChannelStatistics> getAllStatistics() const;
+
+public slots:
+    void appendData( ColorSensorAccess::ColorData data );
+    void clear();
+
+signals:
+    void updated();
+
+private:
+    void removeFirst();
+    void resetBuffers();
+
+private:
+    RingBuffer<Entry> window;
+    Accumulator accumulator[ChannelCount];
+    MonotonicDeque minDeque[ChannelCount];
+    MonotonicDeque maxDeque[ChannelCount];
+
+    qint64 nextSeq;
+
+    int windowCount;
+    qint64 windowNanosec;
+};
+
+#endif // ROLLINGSTATISTICS_H
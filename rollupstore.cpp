@@ -0,0 +1,307 @@
+#include "rollupstore.h"
+
+#include <string.h>
+
+RollupStore::RollupStore(QObject *parent) : QObject(parent),
+    saveTimer( this )
+{
+    // One day of seconds, a month of minutes, a year of hours
+    buckets[Second].setCapacity( 24 * 60 * 60 );
+    buckets[Minute].setCapacity( 30 * 24 * 60 );
+    buckets[Hour].setCapacity( 365 * 24 );
+
+    for ( int level = 0; level < LevelCount; level++ ) {
+        hasCurrent[level] = false;
+    }
+
+    wallClockOffset = QDateTime::currentMSecsSinceEpoch() * 1000000 - ColorSensorAccess::timestampNow();
+
+    // Persist periodically, and at exit by owner
+    saveTimer.setInterval( 5 * 60 * 1000 );
+
+    connect( &saveTimer, SIGNAL(timeout()), this, SLOT(saveFile()) );
+}
+
+qint64 RollupStore::levelDuration(int level)
+{
+    switch ( level ) {
+    case Second:
+        return 1000000000LL;
+    case Minute:
+        return 60 * 1000000000LL;
+    case Hour:
+    default:
+        return 60 * 60 * 1000000000LL;
+    }
+}
+
+QString RollupStore::levelName(int level)
+{
+    switch ( level ) {
+    case Second:
+        return "1 s";
+    case Minute:
+        return "1 min";
+    case Hour:
+    default:
+        return "1 h";
+    }
+}
+
+int RollupStore::getBucketCount(int level) const
+{
+    return buckets[level].size();
+}
+
+const RollupStore::Bucket &RollupStore::getBucket(int level, int index) const
+{
+    return buckets[level].at( index );
+}
+
+int RollupStore::findBucket(int level, qint64 start) const
+{
+    // First bucket starting at or after start, buckets are in time order
+    const RingBuffer<Bucket> &ring = buckets[level];
+    int low = 0, high = ring.size();
+
+    while ( low < high ) {
+        int mid = ( low + high ) / 2;
+
+        if ( ring.at( mid ).start < start ) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+void RollupStore::appendData(ColorSensorAccess::ColorData data)
+{
+    // Sample is a bucket of one, rolled up level by level
+    Bucket bucket;
+    float value[ChannelCount] = { (float)data.blue, (float)data.green, (float)data.red, (float)data.infraRed };
+
+    bucket.start = data.timestamp + wallClockOffset;
+    bucket.count = 1;
+
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        bucket.min[ch] = value[ch];
+        bucket.max[ch] = value[ch];
+        bucket.sum[ch] = value[ch];
+    }
+
+    addToLevel( Second, bucket );
+}
+
+void RollupStore::addToLevel(int level, const Bucket &bucket)
+{
+    if ( level >= LevelCount ) {
+        return;
+    }
+
+    qint64 duration = levelDuration( level );
+    qint64 start = bucket.start - bucket.start % duration;
+
+    if ( hasCurrent[level] && current[level].start != start ) {
+        // Close bucket and feed it to next coarser level
+        Bucket closed = current[level];
+
+        if ( closed.start < start ) {
+            buckets[level].append( closed );
+            hasCurrent[level] = false;
+
+            emit rolledUp( level );
+
+            addToLevel( level + 1, closed );
+        } else {
+            // Clock went backwards, keep filling current bucket
+            start = closed.start;
+        }
+    }
+
+    if ( !hasCurrent[level] ) {
+        current[level] = bucket;
+        current[level].start = start;
+        hasCurrent[level] = true;
+
+        return;
+    }
+
+    mergeBucket( current[level], bucket );
+}
+
+void RollupStore::mergeBucket(Bucket &target, const Bucket &source)
+{
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        target.min[ch] = qMin( target.min[ch], source.min[ch] );
+        target.max[ch] = qMax( target.max[ch], source.max[ch] );
+        target.sum[ch] += source.sum[ch];
+    }
+
+    target.count += source.count;
+}
+
+bool RollupStore::load(QString filePath)
+{
+    // Read buckets, newer file replaces contents
+    QFile file( filePath );
+
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return false;
+    }
+
+    QDataStream stream( &file );
+    char magic[8];
+    qint32 version, levelCount;
+
+    stream.setByteOrder( QDataStream::LittleEndian );
+
+    if ( stream.readRawData( magic, 8 ) != 8 || memcmp( magic, "CSROLLUP", 8 ) != 0 ) {
+        return false;
+    }
+
+    stream >> version >> levelCount;
+
+    if ( version < 1 || version > FileVersion || levelCount != LevelCount ) {
+        return false;
+    }
+
+    RingBuffer<Bucket> loaded[LevelCount];
+    Bucket loadedCurrent[LevelCount];
+    bool loadedHasCurrent[LevelCount];
+
+    for ( int level = 0; level < LevelCount; level++ ) {
+        qint32 count;
+
+        stream >> count;
+
+        loaded[level].setCapacity( buckets[level].capacity() );
+
+        for ( int i = 0; i < count && stream.status() == QDataStream::Ok; i++ ) {
+            Bucket bucket;
+
+            readBucket( stream, bucket );
+            loaded[level].append( bucket );
+        }
+
+        // Open bucket keeps rolling up into coarser level after restart, version 1 has none
+        qint8 hasOpen = 0;
+
+        if ( version >= 2 ) {
+            stream >> hasOpen;
+        }
+
+        loadedHasCurrent[level] = hasOpen;
+
+        if ( hasOpen ) {
+            readBucket( stream, loadedCurrent[level] );
+        }
+    }
+
+    if ( stream.status() != QDataStream::Ok ) {
+        return false;
+    }
+
+    for ( int level = 0; level < LevelCount; level++ ) {
+        buckets[level] = loaded[level];
+        current[level] = loadedCurrent[level];
+        hasCurrent[level] = loadedHasCurrent[level];
+
+        emit rolledUp( level );
+    }
+
+    return true;
+}
+
+bool RollupStore::save(QString filePath)
+{
+    // Written to temporary file and renamed, old file survives crash
+    QSaveFile file( filePath );
+
+    if ( !file.open( QIODevice::WriteOnly ) ) {
+        return false;
+    }
+
+    QDataStream stream( &file );
+
+    stream.setByteOrder( QDataStream::LittleEndian );
+    stream.writeRawData( "CSROLLUP", 8 );
+    stream << (qint32)FileVersion << (qint32)LevelCount;
+
+    for ( int level = 0; level < LevelCount; level++ ) {
+        const RingBuffer<Bucket> &ring = buckets[level];
+
+        stream << (qint32)ring.size();
+
+        for ( int i = 0; i < ring.size(); i++ ) {
+            writeBucket( stream, ring.at( i ) );
+        }
+
+        stream << (qint8)hasCurrent[level];
+
+        if ( hasCurrent[level] ) {
+            writeBucket( stream, current[level] );
+        }
+    }
+
+    if ( stream.status() != QDataStream::Ok ) {
+        file.cancelWriting();
+
+        return false;
+    }
+
+    return file.commit();
+}
+
+void RollupStore::writeBucket(QDataStream &stream, const RollupStore::Bucket &bucket)
+{
+    stream << bucket.start << bucket.count;
+
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        stream << bucket.min[ch] << bucket.max[ch] << bucket.sum[ch];
+    }
+}
+
+void RollupStore::readBucket(QDataStream &stream, RollupStore::Bucket &bucket)
+{
+    stream >> bucket.start >> bucket.count;
+
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        stream >> bucket.min[ch] >> bucket.max[ch] >> bucket.sum[ch];
+    }
+}
+
+QString RollupStore::getFilePath() const
+{
+    return filePath;
+}
+
+void RollupStore::setFilePath(const QString &value)
+{
+    filePath = value;
+
+    if ( filePath.isEmpty() ) {
+        saveTimer.stop();
+    } else {
+        saveTimer.start();
+    }
+}
+
+void RollupStore::saveFile()
+{
+    if ( !filePath.isEmpty() ) {
+        save( filePath );
+    }
+}
+
+void RollupStore::clear()
+{
+    for ( int level = 0; level < LevelCount; level++ ) {
+        buckets[level].clear();
+        hasCurrent[level] = false;
+
+        emit rolledUp( level );
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef ROLLUPSTORE_H
+#define ROLLUPSTORE_H
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+#include <QVector>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+
+#include "colorsensoraccess.h"
+#include "ringbuffer.h"
+
+class RollupStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Level {
+        Second = 0,
+        Minute,
+        Hour,
+        LevelCount,
+    };
+
+    enum Parameter {
+        ChannelCount = 4,
+        FileVersion = 2,        // Open bucket of each level follows closed ones
+    };
+
+    struct Bucket {
+        qint64 start;       // Wall clock [ns since epoch]
+        qint32 count;
+        float min[ChannelCount];
+        float max[ChannelCount];
+        double sum[ChannelCount];
+
+        double mean( int channel ) const {
+            return count > 0 ? sum[channel] / count : 0;
+        }
+    };
+
+public:
+    explicit RollupStore(QObject *parent = 0);
+
+    static qint64 levelDuration( int level );
+    static QString levelName( int level );
+
+    int getBucketCount( int level ) const;
+    const Bucket &getBucket( int level, int index ) const;
+    int findBucket( int level, qint64 start ) const;
+
+    bool load( QString filePath );
+    bool save( QString filePath );
+    QString getFilePath() const;
+    void setFilePath(const QString &value);
+
+public slots:
+    void appendData( ColorSensorAccess::ColorData data );
+    void saveFile();
+    void clear();
+
+signals:
+    void rolledUp( int level );
+
+private:
+    void addToLevel( int level, const Bucket &bucket );
+    static void mergeBucket( Bucket &target, const Bucket &source );
+    static void writeBucket( QDataStream &stream, const Bucket &bucket );
+    static void readBucket( QDataStream &stream, Bucket &bucket );
+
+private:
+    // Round robin store of closed buckets and the one being filled per level
+    RingBuffer<Bucket> buckets[LevelCount];
+    Bucket current[LevelCount];
+    bool hasCurrent[LevelCount];
+
+    // Sample timestamps are monotonic, this maps them to wall clock
+    qint64 wallClockOffset;
+
+    QString filePath;
+    QTimer saveTimer;
+};
+
+#endif // ROLLUPSTORE_H
@@ -0,0 +1,688 @@
+#include "samplerecorder.h"
+
+SampleRecorder::SampleRecorder(QObject *parent) : QObject(parent),
+    syncTimer( this ),
+    committedBytes( 0 ),
+    pendingTriggerIndex( -1 ),
+    syncRecordCount( 64 ),
+    syncInterval( 1000 )
+{
+    syncTimer.setSingleShot( true );
+
+    connect( &syncTimer, SIGNAL(timeout()), this, SLOT(commit()) );
+
+    memset( &statistics, 0, sizeof( statistics ) );
+    memset( &lastRecovery, 0, sizeof( lastRecovery ) );
+}
+
+SampleRecorder::~SampleRecorder()
+{
+    closeFile();
+}
+
+bool SampleRecorder::openFile(QString filePath)
+{
+    // Open record file, existing file is recovered and appended
+    closeFile();
+
+    mutex.lock();
+    errorString.clear();
+    mutex.unlock();
+
+    // Only an empty file or a record file is written, anything else is left untouched
+    QFileInfo info( filePath );
+    bool empty = !info.exists() || info.size() == 0;
+
+    RecoveryResult recovery = recoverFile( filePath, false );
+
+    if ( !empty && !recovery.valid ) {
+        return failOpen( "Not a record file, choose a new file or an existing record" );
+    }
+
+    // Older files are read only, so they are left as they are
+    if ( recovery.valid && recovery.version != FileVersion ) {
+        return failOpen( QString( "Record file version %1 can be replayed but not appended, version %2 is written" )
+                         .arg( recovery.version ).arg( FileVersion ) );
+    }
+
+    // Cut torn tail only of file which is appended
+    if ( recovery.valid && recovery.discardedBytes > 0 ) {
+        recovery = recoverFile( filePath, true );
+    }
+
+    file.setFileName( filePath );
+
+    if ( !file.open( QIODevice::ReadWrite ) ) {
+        return failOpen( file.errorString() );
+    }
+
+    if ( !recovery.valid ) {
+        // Write new file header
+        uchar header[FileHeaderSize];
+
+        memcpy( header, "CSRECORD", 8 );
+        qToLittleEndian<uint32_t>( FileVersion, header + 8 );
+        qToLittleEndian<uint32_t>( RecordSize, header + 12 );
+
+        if ( file.write( (const char *)header, FileHeaderSize ) != FileHeaderSize || !file.flush() ) {
+            QString message = file.errorString();
+
+            file.close();
+
+            return failOpen( message );
+        }
+
+        recovery.validBytes = FileHeaderSize;
+    }
+
+    file.seek( recovery.validBytes );
+    committedBytes = recovery.validBytes;
+
+    mutex.lock();
+    memset( &statistics, 0, sizeof( statistics ) );
+    lastRecovery = recovery;
+    mutex.unlock();
+
+    pending.clear();
+    pending.reserve( syncRecordCount );
+
+    elapsed.start();
+
+    return true;
+}
+
+void SampleRecorder::closeFile()
+{
+    if ( !file.isOpen() ) {
+        return;
+    }
+
+    commit();
+
+    syncTimer.stop();
+    file.close();
+}
+
+bool SampleRecorder::isOpen()
+{
+    return file.isOpen();
+}
+
+void SampleRecorder::appendData(ColorSensorAccess::ColorData data)
+{
+    // Collect into pending chunk, it is coded at commit
+    if ( !file.isOpen() ) {
+        return;
+    }
+
+    if ( pending.isEmpty() ) {
+        syncTimer.start( syncInterval );
+    }
+
+    pending.append( data );
+
+    // Group commit by record count
+    if ( pending.size() >= syncRecordCount ) {
+        commit();
+    }
+}
+
+void SampleRecorder::appendWindow(QVector<ColorSensorAccess::ColorData> window, int triggerIndex)
+{
+    // Capture window is committed as its own chunk tagged with trigger position
+    commit();
+
+    if ( !file.isOpen() || window.isEmpty() ) {
+        return;
+    }
+
+    pending = window;
+    pendingTriggerIndex = triggerIndex;
+
+    commit();
+}
+
+void SampleRecorder::commit()
+{
+    // Write pending records as checksummed chunks, then sync
+    syncTimer.stop();
+
+    if ( !file.isOpen() || pending.isEmpty() ) {
+        return;
+    }
+
+    int pendingRecords = pending.size();
+    int chunkCount = 0;
+    qint64 bytes = 0;
+    qint64 syncNanosec = 0;
+    QElapsedTimer syncElapsed;
+
+    // Large capture window is split, so no chunk is over what recovery and reading accept
+    for ( int first = 0; first < pendingRecords; first += MaxChunkRecordCount ) {
+        buildChunk( first, qMin( (int)MaxChunkRecordCount, pendingRecords - first ), first > 0 );
+
+        syncElapsed.start();
+
+        // Records count as saved only when every chunk reached disk
+        if ( file.write( chunk ) != chunk.size() ) {
+            failWrite( file.errorString() );
+
+            return;
+        }
+
+        syncNanosec += syncElapsed.nsecsElapsed();
+        bytes += chunk.size();
+        chunkCount++;
+    }
+
+    syncElapsed.start();
+
+    if ( !file.flush() ) {
+        failWrite( file.errorString() );
+
+        return;
+    }
+
+    if ( fdatasync( file.handle() ) != 0 ) {
+        failWrite( QString( "fdatasync failed, %1" ).arg( strerror( errno ) ) );
+
+        return;
+    }
+
+    syncNanosec += syncElapsed.nsecsElapsed();
+    committedBytes += bytes;
+
+    qint64 recordCount;
+
+    mutex.lock();
+    statistics.recordCount += pendingRecords;
+    statistics.chunkCount += chunkCount;
+    statistics.syncCount++;
+    statistics.bytesWritten += bytes;
+    statistics.syncNanosec += syncNanosec;
+    statistics.elapsedNanosec = elapsed.nsecsElapsed();
+
+    if ( syncNanosec > statistics.maxSyncNanosec ) {
+        statistics.maxSyncNanosec = syncNanosec;
+    }
+
+    recordCount = statistics.recordCount;
+    mutex.unlock();
+
+    pending.clear();
+    pendingTriggerIndex = -1;
+
+    emit committed( recordCount );
+}
+
+void SampleRecorder::buildChunk(int first, int count, bool continued)
+{
+    // Code pending records first to first + count - 1 as one chunk
+    bool window = pendingTriggerIndex >= 0;
+
+    chunk.resize( ChunkHeaderSize + ( window ? WindowHeaderSize : 0 ) );
+
+    // Every part of window keeps trigger index, counted from start of whole window
+    if ( window ) {
+        qToLittleEndian<uint32_t>( pendingTriggerIndex, (uchar *)chunk.data() + ChunkHeaderSize );
+        qToLittleEndian<uint32_t>( continued ? WindowContinued : 0, (uchar *)chunk.data() + ChunkHeaderSize + 4 );
+    }
+
+    encodeChunk( pending.constData() + first, count, chunk );
+
+    uchar *header = (uchar *)chunk.data();
+    int payloadSize = chunk.size() - ChunkHeaderSize;
+
+    qToLittleEndian<uint32_t>( window ? WindowMagic : ChunkMagic, header + 0 );
+    qToLittleEndian<uint32_t>( count, header + 4 );
+    qToLittleEndian<uint32_t>( payloadSize, header + 8 );
+
+    // CRC covers count, size and payload
+    uint32_t crc = crc32( chunk.constData() + 4, 8 );
+    crc = crc32( chunk.constData() + ChunkHeaderSize, payloadSize, crc );
+    qToLittleEndian<uint32_t>( crc, header + 12 );
+}
+
+bool SampleRecorder::failOpen(const QString &message)
+{
+    QMutexLocker locker( &mutex );
+
+    errorString = message;
+
+    return false;
+}
+
+void SampleRecorder::failWrite(const QString &message)
+{
+    // Cut torn chunk so later recovery keeps every committed one, then stop recording
+    syncTimer.stop();
+    file.resize( committedBytes );
+    file.close();
+
+    pending.clear();
+    pendingTriggerIndex = -1;
+
+    mutex.lock();
+    errorString = message;
+    mutex.unlock();
+
+    emit writeFailed( message );
+}
+
+SampleRecorder::RecoveryResult SampleRecorder::recoverFile(QString filePath, bool truncate)
+{
+    // Scan chunks and find the end of the last valid one
+    RecoveryResult result;
+    QFile in( filePath );
+
+    memset( &result, 0, sizeof( result ) );
+
+    if ( !in.open( truncate ? QIODevice::ReadWrite : QIODevice::ReadOnly ) ) {
+        return result;
+    }
+
+    QByteArray header = in.read( FileHeaderSize );
+
+    if ( header.size() != FileHeaderSize || !header.startsWith( "CSRECORD" ) ) {
+        return result;
+    }
+
+    uint32_t version = qFromLittleEndian<uint32_t>( (const uchar *)header.constData() + 8 );
+    uint32_t recordSize = qFromLittleEndian<uint32_t>( (const uchar *)header.constData() + 12 );
+
+    if ( !validVersion( version, recordSize ) ) {
+        return result;
+    }
+
+    result.valid = true;
+    result.version = version;
+    result.recordSize = recordSize;
+    result.validBytes = FileHeaderSize;
+
+    while ( true ) {
+        QByteArray chunkHeader = in.read( ChunkHeaderSize );
+
+        if ( chunkHeader.size() != ChunkHeaderSize ) {
+            break;
+        }
+
+        const uchar *h = (const uchar *)chunkHeader.constData();
+        uint32_t magic       = qFromLittleEndian<uint32_t>( h + 0 );
+        uint32_t recordCount = qFromLittleEndian<uint32_t>( h + 4 );
+        uint32_t payloadSize = qFromLittleEndian<uint32_t>( h + 8 );
+        uint32_t crc         = qFromLittleEndian<uint32_t>( h + 12 );
+
+        int offset = payloadOffset( version, magic );
+
+        if ( offset < 0 || payloadSize < (uint32_t)offset ||
+             !validPayloadSize( version, recordSize, recordCount, payloadSize - offset ) ||
+             result.validBytes + ChunkHeaderSize + payloadSize > in.size() ) {
+            break;
+        }
+
+        QByteArray payload = in.read( payloadSize );
+
+        if ( payload.size() != (int)payloadSize ) {
+            break;
+        }
+
+        uint32_t check = crc32( chunkHeader.constData() + 4, 8 );
+        check = crc32( payload.constData(), payload.size(), check );
+
+        if ( check != crc ) {
+            break;
+        }
+
+        result.validBytes += ChunkHeaderSize + payloadSize;
+        result.recordCount += recordCount;
+        result.chunkCount++;
+    }
+
+    result.discardedBytes = in.size() - result.validBytes;
+
+    // Cut torn tail
+    if ( truncate && result.discardedBytes > 0 ) {
+        in.resize( result.validBytes );
+    }
+
+    return result;
+}
+
+bool SampleRecorder::readFile(QString filePath, QVector<ColorSensorAccess::ColorData> &data)
+{
+    // Read all valid records
+    return readRange( filePath, 0, -1, data );
+}
+
+bool SampleRecorder::readRange(QString filePath, qint64 first, qint64 count, QVector<ColorSensorAccess::ColorData> &data)
+{
+    // Records first to first + count - 1, chunks out of range are skipped by header
+    QFile in( filePath );
+
+    data.clear();
+
+    if ( !in.open( QIODevice::ReadOnly ) ) {
+        return false;
+    }
+
+    QByteArray header = in.read( FileHeaderSize );
+
+    if ( header.size() != FileHeaderSize || !header.startsWith( "CSRECORD" ) ) {
+        return false;
+    }
+
+    uint32_t version = qFromLittleEndian<uint32_t>( (const uchar *)header.constData() + 8 );
+    uint32_t recordSize = qFromLittleEndian<uint32_t>( (const uchar *)header.constData() + 12 );
+
+    if ( !validVersion( version, recordSize ) ) {
+        return false;
+    }
+
+    qint64 last = count < 0 ? LLONG_MAX : first + count;
+    qint64 index = 0;
+    QVector<ColorSensorAccess::ColorData> records;
+
+    while ( index < last ) {
+        QByteArray chunkHeader = in.read( ChunkHeaderSize );
+
+        if ( chunkHeader.size() != ChunkHeaderSize ) {
+            break;
+        }
+
+        const uchar *h = (const uchar *)chunkHeader.constData();
+        uint32_t magic       = qFromLittleEndian<uint32_t>( h + 0 );
+        uint32_t recordCount = qFromLittleEndian<uint32_t>( h + 4 );
+        uint32_t payloadSize = qFromLittleEndian<uint32_t>( h + 8 );
+        uint32_t crc         = qFromLittleEndian<uint32_t>( h + 12 );
+
+        int offset = payloadOffset( version, magic );
+
+        if ( offset < 0 || payloadSize < (uint32_t)offset ||
+             !validPayloadSize( version, recordSize, recordCount, payloadSize - offset ) ||
+             in.pos() + payloadSize > in.size() ) {
+            break;
+        }
+
+        if ( index + recordCount <= first ) {
+            in.seek( in.pos() + payloadSize );
+            index += recordCount;
+
+            continue;
+        }
+
+        QByteArray payload = in.read( payloadSize );
+        uint32_t check = crc32( chunkHeader.constData() + 4, 8 );
+
+        check = crc32( payload.constData(), payload.size(), check );
+
+        // Torn or corrupt chunk ends valid data
+        if ( payload.size() != (int)payloadSize || check != crc ||
+             !decodeChunk( payload.mid( offset ), version, recordSize, recordCount, records ) ) {
+            break;
+        }
+
+        for ( int i = qMax( (qint64)0, first - index ); i < records.size() && index + i < last; i++ ) {
+            data.append( records[i] );
+        }
+
+        index += recordCount;
+    }
+
+    return true;
+}
+
+bool SampleRecorder::readWindows(QString filePath, QVector<CaptureWindow> &windows)
+{
+    // Capture windows with position of their records, plain chunks only advance record index
+    QFile in( filePath );
+
+    windows.clear();
+
+    if ( !in.open( QIODevice::ReadOnly ) ) {
+        return false;
+    }
+
+    QByteArray header = in.read( FileHeaderSize );
+
+    if ( header.size() != FileHeaderSize || !header.startsWith( "CSRECORD" ) ) {
+        return false;
+    }
+
+    uint32_t version = qFromLittleEndian<uint32_t>( (const uchar *)header.constData() + 8 );
+    uint32_t recordSize = qFromLittleEndian<uint32_t>( (const uchar *)header.constData() + 12 );
+
+    if ( !validVersion( version, recordSize ) ) {
+        return false;
+    }
+
+    qint64 index = 0;
+
+    while ( true ) {
+        QByteArray chunkHeader = in.read( ChunkHeaderSize );
+
+        if ( chunkHeader.size() != ChunkHeaderSize ) {
+            break;
+        }
+
+        const uchar *h = (const uchar *)chunkHeader.constData();
+        uint32_t magic       = qFromLittleEndian<uint32_t>( h + 0 );
+        uint32_t recordCount = qFromLittleEndian<uint32_t>( h + 4 );
+        uint32_t payloadSize = qFromLittleEndian<uint32_t>( h + 8 );
+        uint32_t crc         = qFromLittleEndian<uint32_t>( h + 12 );
+        int offset = payloadOffset( version, magic );
+
+        if ( offset < 0 || payloadSize < (uint32_t)offset ||
+             !validPayloadSize( version, recordSize, recordCount, payloadSize - offset ) ||
+             in.pos() + payloadSize > in.size() ) {
+            break;
+        }
+
+        QByteArray payload = in.read( payloadSize );
+        uint32_t check = crc32( chunkHeader.constData() + 4, 8 );
+
+        check = crc32( payload.constData(), payload.size(), check );
+
+        if ( payload.size() != (int)payloadSize || check != crc ) {
+            break;
+        }
+
+        uint32_t flags = magic == WindowMagic ? qFromLittleEndian<uint32_t>( (const uchar *)payload.constData() + 4 ) : 0;
+
+        if ( ( flags & WindowContinued ) && !windows.isEmpty() &&
+             windows.last().firstRecord + windows.last().recordCount == index ) {
+            // Rest of window split over several chunks
+            windows.last().recordCount += recordCount;
+        } else if ( magic == WindowMagic ) {
+            CaptureWindow window;
+
+            window.firstRecord = index;
+            window.recordCount = recordCount;
+            window.triggerIndex = qFromLittleEndian<uint32_t>( (const uchar *)payload.constData() );
+
+            windows.append( window );
+        }
+
+        index += recordCount;
+    }
+
+    return true;
+}
+
+void SampleRecorder::encodeChunk(const ColorSensorAccess::ColorData *records, int count, QByteArray &out)
+{
+    // One column per field, timestamps are regular and channels change slowly
+    QVector<qint64> columns( count * RecordColumnCount );
+    qint64 *c = columns.data();
+
+    for ( int i = 0; i < count; i++ ) {
+        const ColorSensorAccess::ColorData &d = records[i];
+
+        c[i]             = d.timestamp;
+        c[count + i]     = d.blue;
+        c[count * 2 + i] = d.green;
+        c[count * 3 + i] = d.red;
+        c[count * 4 + i] = d.infraRed;
+        c[count * 5 + i] = d.controlByte;
+        c[count * 6 + i] = d.manualTime;
+    }
+
+    for ( int col = 0; col < RecordColumnCount; col++ ) {
+        BlockCodec::encodeColumn( c + col * count, count, out );
+    }
+}
+
+bool SampleRecorder::decodeChunk(const QByteArray &payload, int version, int recordSize, int recordCount, QVector<ColorSensorAccess::ColorData> &data)
+{
+    const uchar *p = (const uchar *)payload.constData();
+    const uchar *end = p + payload.size();
+
+    data.resize( recordCount );
+
+    if ( version >= 3 ) {
+        QVector<qint64> columns( recordCount * RecordColumnCount );
+
+        for ( int col = 0; col < RecordColumnCount; col++ ) {
+            if ( !BlockCodec::decodeColumn( p, end, columns.data() + col * recordCount, recordCount ) ) {
+                return false;
+            }
+        }
+
+        const qint64 *c = columns.constData();
+
+        for ( int i = 0; i < recordCount; i++ ) {
+            ColorSensorAccess::ColorData &d = data[i];
+
+            d.timestamp   = c[i];
+            d.blue        = c[recordCount + i];
+            d.green       = c[recordCount * 2 + i];
+            d.red         = c[recordCount * 3 + i];
+            d.infraRed    = c[recordCount * 4 + i];
+            d.controlByte = c[recordCount * 5 + i];
+            d.manualTime  = c[recordCount * 6 + i];
+        }
+
+        return true;
+    }
+
+    // Fixed size records
+    for ( int i = 0; i < recordCount; i++, p += recordSize ) {
+        ColorSensorAccess::ColorData &d = data[i];
+
+        d.timestamp = qFromLittleEndian<qint64>( p + 0 );
+        d.blue      = qFromLittleEndian<uint16_t>( p + 8 );
+        d.green     = qFromLittleEndian<uint16_t>( p + 10 );
+        d.red       = qFromLittleEndian<uint16_t>( p + 12 );
+        d.infraRed  = qFromLittleEndian<uint16_t>( p + 14 );
+
+        if ( version >= 2 ) {
+            d.controlByte = p[16];
+            d.manualTime  = qFromLittleEndian<uint16_t>( p + 18 );
+        } else {
+            // Version 1 has no setting, assume reference setting
+            d.controlByte = ColorSensorAccess::makeControlByte( ColorSensorAccess::T11, false, ColorSensorAccess::High );
+            d.manualTime  = 0;
+        }
+    }
+
+    return true;
+}
+
+bool SampleRecorder::validPayloadSize(int version, int recordSize, uint32_t recordCount, uint32_t payloadSize)
+{
+    if ( version < 3 ) {
+        return payloadSize == recordCount * recordSize;
+    }
+
+    // Coded column is at most mode, width, two varints and 64 bits per record
+    return recordCount > 0 && recordCount <= MaxChunkRecordCount &&
+            (quint64)payloadSize <= (quint64)RecordColumnCount * ( 22 + 8 * (quint64)recordCount );
+}
+
+bool SampleRecorder::validVersion(uint32_t version, uint32_t recordSize)
+{
+    return ( ( version >= 2 && version <= FileVersion ) && recordSize == RecordSize ) ||
+            ( version == 1 && recordSize == RecordSizeVersion1 );
+}
+
+int SampleRecorder::payloadOffset(int version, uint32_t magic)
+{
+    // Bytes ahead of coded records in payload, negative for unknown chunk
+    if ( magic == ChunkMagic ) {
+        return 0;
+    }
+
+    if ( magic == WindowMagic && version >= 4 ) {
+        return WindowHeaderSize;
+    }
+
+    return -1;
+}
+
+int SampleRecorder::getSyncRecordCount() const
+{
+    return syncRecordCount;
+}
+
+void SampleRecorder::setSyncRecordCount(int value)
+{
+    syncRecordCount = qMax( 1, value );
+}
+
+int SampleRecorder::getSyncInterval() const
+{
+    return syncInterval;
+}
+
+void SampleRecorder::setSyncInterval(int value)
+{
+    syncInterval = qMax( 1, value );
+}
+
+SampleRecorder::Statistics SampleRecorder::getStatistics()
+{
+    QMutexLocker locker( &mutex );
+
+    return statistics;
+}
+
+SampleRecorder::RecoveryResult SampleRecorder::getLastRecovery()
+{
+    QMutexLocker locker( &mutex );
+
+    return lastRecovery;
+}
+
+QString SampleRecorder::getErrorString()
+{
+    QMutexLocker locker( &mutex );
+
+    return errorString;
+}
+
+uint32_t SampleRecorder::crc32(const char *data, int length, uint32_t crc)
+{
+    // CRC-32 (IEEE 802.3)
+    static const struct CrcTable {
+        uint32_t value[256];
+
+        CrcTable() {
+            for ( uint32_t i = 0; i < 256; i++ ) {
+                uint32_t c = i;
+
+                for ( int k = 0; k < 8; k++ ) {
+                    c = ( c & 1 ) ? ( 0xEDB88320 ^ ( c >> 1 ) ) : ( c >> 1 );
+                }
+
+                value[i] = c;
+            }
+        }
+    } table;
+
+    crc = ~crc;
+
+    for ( int i = 0; i < length; i++ ) {
+        crc = table.value[( crc ^ (uint8_t)data[i] ) & 0xFF] ^ ( crc >> 8 );
+    }
+
+    return ~crc;
+}
@@ -0,0 +1,133 @@
+#ifndef SAMPLERECORDER_H
+#define SAMPLERECORDER_H
+
+#include <QObject>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QTimer>
+#include <QVector>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QtEndian>
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "colorsensoraccess.h"
+#include "blockcodec.h"
+
+class SampleRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum FileParameter {
+        FileVersion = 4,            // Capture windows are tagged chunks
+        FileHeaderSize = 16,
+        ChunkHeaderSize = 16,
+        WindowHeaderSize = 8,       // Trigger index and reserved word ahead of window payload
+        RecordSize = 20,
+        RecordSizeVersion1 = 16,    // Without gain and integration time
+        RecordColumnCount = 7,
+        MaxChunkRecordCount = 0x100000,  // Larger batch is split into several chunks
+        ChunkMagic = 0x4B4E4843,   // "CHNK"
+        WindowMagic = 0x4E495743,  // "CWIN"
+        WindowContinued = 1,        // Window flag, chunk continues window of previous chunk
+    };
+
+    struct Statistics {
+        qint64 recordCount;
+        qint64 chunkCount;
+        qint64 syncCount;
+        qint64 bytesWritten;
+        qint64 syncNanosec;
+        qint64 maxSyncNanosec;
+        qint64 elapsedNanosec;
+    };
+
+    struct RecoveryResult {
+        bool valid;
+        int version;
+        int recordSize;
+        qint64 recordCount;
+        qint64 chunkCount;
+        qint64 validBytes;
+        qint64 discardedBytes;
+    };
+
+    struct CaptureWindow {
+        qint64 firstRecord;
+        int recordCount;
+        int triggerIndex;           // Offset of trigger sample within window
+    };
+
+public:
+    explicit SampleRecorder(QObject *parent = 0);
+    ~SampleRecorder();
+
+    static RecoveryResult recoverFile( QString filePath, bool truncate );
+    static bool readFile( QString filePath, QVector<ColorSensorAccess::ColorData> &data );
+    static bool readRange( QString filePath, qint64 first, qint64 count, QVector<ColorSensorAccess::ColorData> &data );
+    static bool readWindows( QString filePath, QVector<CaptureWindow> &windows );
+
+    bool isOpen();
+
+    int getSyncRecordCount() const;
+    void setSyncRecordCount(int value);
+    int getSyncInterval() const;
+    void setSyncInterval(int value);
+
+    Statistics getStatistics();
+    RecoveryResult getLastRecovery();
+    QString getErrorString();
+
+public slots:
+    bool openFile( QString filePath );
+    void closeFile();
+    void appendData( ColorSensorAccess::ColorData data );
+    void appendWindow( QVector<ColorSensorAccess::ColorData> window, int triggerIndex );
+    void commit();
+
+signals:
+    void committed( qint64 recordCount );
+    void writeFailed( QString message );
+
+private:
+    static uint32_t crc32( const char *data, int length, uint32_t crc = 0 );
+    static void encodeChunk( const ColorSensorAccess::ColorData *records, int count, QByteArray &out );
+    static bool decodeChunk( const QByteArray &payload, int version, int recordSize, int recordCount, QVector<ColorSensorAccess::ColorData> &data );
+    static bool validPayloadSize( int version, int recordSize, uint32_t recordCount, uint32_t payloadSize );
+    static bool validVersion( uint32_t version, uint32_t recordSize );
+    static int payloadOffset( int version, uint32_t magic );
+
+private:
+    void buildChunk( int first, int count, bool continued );
+    bool failOpen( const QString &message );
+    void failWrite( const QString &message );
+
+private:
+    QMutex mutex;
+
+    QFile file;
+    QTimer syncTimer;
+    QElapsedTimer elapsed;
+
+    QVector<ColorSensorAccess::ColorData> pending;
+    int pendingTriggerIndex;    // Pending records are a capture window when not negative
+    QByteArray chunk;
+    qint64 committedBytes;      // End of last chunk known to be on disk
+
+    // Group commit policy
+    int syncRecordCount;
+    int syncInterval;
+
+    Statistics statistics;
+    RecoveryResult lastRecovery;
+    QString errorString;
+};
+
+#endif // SAMPLERECORDER_H
@@ -0,0 +1,226 @@
+#include "sampletablemodel.h"
+#include "tracer.h"
+
+SampleTableModel::SampleTableModel(QObject *parent) : QAbstractTableModel(parent),
+    samples( 1000000 ),
+    flushTimer( this )
+{
+    // Rows are inserted in batches by timer
+    flushTimer.setSingleShot( true );
+    flushTimer.setInterval( 100 );
+
+    connect( &flushTimer, SIGNAL(timeout()), this, SLOT(flush()) );
+}
+
+int SampleTableModel::getCapacity() const
+{
+    return samples.capacity();
+}
+
+void SampleTableModel::setCapacity(int value)
+{
+    beginResetModel();
+    samples.setCapacity( value );
+    pendingSamples.clear();
+    endResetModel();
+}
+
+int SampleTableModel::getFlushInterval() const
+{
+    return flushTimer.interval();
+}
+
+void SampleTableModel::setFlushInterval(int value)
+{
+    flushTimer.setInterval( value );
+}
+
+const ColorSensorAccess::ColorData &SampleTableModel::getSample(int row) const
+{
+    return samples.at( row );
+}
+
+void SampleTableModel::writeCsv(QTextStream &stream) const
+{
+    // Write comma separated values
+    for ( int i = 0; i < samples.size(); i++ ) {
+        const ColorSensorAccess::ColorData &data = samples.at( i );
+
+        stream << data.blue << ',' << data.green << ',' << data.red << ',' << data.infraRed << '\n';
+    }
+}
+
+void SampleTableModel::writeDerivedCsv(QTextStream &stream, const QList<ChannelExpression> &derived) const
+{
+    // Header of names, then one line per log row, evaluated block by block
+    // Value which is not finite, such as ratio of zero counts, is written as empty field
+    const int blockSize = ChannelExpression::BlockSize;
+    double inputs[4][blockSize];
+    const double *inputPointers[4] = { inputs[0], inputs[1], inputs[2], inputs[3] };
+    QVector<double> outputs( derived.size() * blockSize );
+
+    for ( int d = 0; d < derived.size(); d++ ) {
+        stream << ( d > 0 ? "," : "" ) << derived[d].getName();
+    }
+
+    stream << '\n';
+
+    for ( int start = 0; start < samples.size(); start += blockSize ) {
+        int count = qMin( blockSize, samples.size() - start );
+
+        for ( int i = 0; i < count; i++ ) {
+            const ColorSensorAccess::ColorData &data = samples.at( start + i );
+
+            inputs[0][i] = data.blue;
+            inputs[1][i] = data.green;
+            inputs[2][i] = data.red;
+            inputs[3][i] = data.infraRed;
+        }
+
+        for ( int d = 0; d < derived.size(); d++ ) {
+            derived[d].evaluate( inputPointers, count, outputs.data() + d * blockSize );
+        }
+
+        for ( int i = 0; i < count; i++ ) {
+            for ( int d = 0; d < derived.size(); d++ ) {
+                double value = outputs[d * blockSize + i];
+
+                if ( d > 0 ) {
+                    stream << ',';
+                }
+
+                if ( qIsFinite( value ) ) {
+                    stream << value;
+                }
+            }
+
+            stream << '\n';
+        }
+    }
+}
+
+void SampleTableModel::appendData(ColorSensorAccess::ColorData data)
+{
+    TRACE_SCOPE( "logAppend" );
+
+    // Queue sample, view is notified at next flush
+    pendingSamples.append( data );
+
+    if ( !flushTimer.isActive() ) {
+        flushTimer.start();
+    }
+}
+
+void SampleTableModel::flush()
+{
+    TRACE_SCOPE( "logFlush" );
+
+    // Insert pending samples as one batch
+    if ( pendingSamples.isEmpty() || samples.capacity() == 0 ) {
+        pendingSamples.clear();
+        return;
+    }
+
+    int capacity = samples.capacity();
+    int first = qMax( 0, pendingSamples.size() - capacity );
+    int insertCount = pendingSamples.size() - first;
+    int overflow = samples.size() + insertCount - capacity;
+
+    // Drop oldest rows to keep memory bounded
+    if ( overflow > 0 ) {
+        beginRemoveRows( QModelIndex(), 0, overflow - 1 );
+        samples.removeFirst( overflow );
+        endRemoveRows();
+    }
+
+    beginInsertRows( QModelIndex(), samples.size(), samples.size() + insertCount - 1 );
+
+    for ( int i = first; i < pendingSamples.size(); i++ ) {
+        samples.append( pendingSamples[i] );
+    }
+
+    endInsertRows();
+
+    pendingSamples.clear();
+}
+
+void SampleTableModel::clear()
+{
+    beginResetModel();
+    samples.clear();
+    pendingSamples.clear();
+    endResetModel();
+}
+
+int SampleTableModel::rowCount(const QModelIndex &parent) const
+{
+    if ( parent.isValid() ) {
+        return 0;
+    }
+
+    return samples.size();
+}
+
+int SampleTableModel::columnCount(const QModelIndex &parent) const
+{
+    if ( parent.isValid() ) {
+        return 0;
+    }
+
+    return ColumnCount;
+}
+
+QVariant SampleTableModel::data(const QModelIndex &index, int role) const
+{
+    // Only visible cells are requested by view
+    if ( !index.isValid() || index.row() >= samples.size() ) {
+        return QVariant();
+    }
+
+    if ( role == Qt::TextAlignmentRole ) {
+        return int( Qt::AlignRight | Qt::AlignVCenter );
+    }
+
+    if ( role != Qt::DisplayRole ) {
+        return QVariant();
+    }
+
+    const ColorSensorAccess::ColorData &data = samples.at( index.row() );
+
+    switch ( index.column() ) {
+    case Blue:
+        return data.blue;
+    case Green:
+        return data.green;
+    case Red:
+        return data.red;
+    case InfraRed:
+        return data.infraRed;
+    case Setting:
+        return ColorSensorAccess::settingName( data );
+    default:
+        return QVariant();
+    }
+}
+
+QVariant SampleTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if ( role != Qt::DisplayRole || orientation != Qt::Horizontal ) {
+        return QAbstractTableModel::headerData( section, orientation, role );
+    }
+
+    switch ( section ) {
+    case Blue:
+        return "B";
+    case Green:
+        return "G";
+    case Red:
+        return "R";
+    case InfraRed:
+        return "IR";
+    case Setting:
+        return "Setting";
+    default:
+        return QVariant();
+    }
+}
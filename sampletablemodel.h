@@ -0,0 +1,58 @@
+#ifndef SAMPLETABLEMODEL_H
+#define SAMPLETABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QTimer>
+#include <QVector>
+#include <QTextStream>
+
+#include "colorsensoraccess.h"
+#include "ringbuffer.h"
+#include "channelexpression.h"
+
+class SampleTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        Blue = 0,
+        Green,
+        Red,
+        InfraRed,
+        Setting,
+        ColumnCount,
+    };
+
+public:
+    explicit SampleTableModel(QObject *parent = 0);
+
+    int getCapacity() const;
+    void setCapacity(int value);
+    int getFlushInterval() const;
+    void setFlushInterval(int value);
+
+    const ColorSensorAccess::ColorData &getSample( int row ) const;
+    void writeCsv( QTextStream &stream ) const;
+    void writeDerivedCsv( QTextStream &stream, const QList<ChannelExpression> &derived ) const;
+
+public slots:
+    void appendData( ColorSensorAccess::ColorData data );
+    void flush();
+    void clear();
+
+    // QAbstractItemModel interface
+public:
+    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+private:
+    RingBuffer<ColorSensorAccess::ColorData> samples;
+    QVector<ColorSensorAccess::ColorData> pendingSamples;
+
+    QTimer flushTimer;
+};
+
+#endif // SAMPLETABLEMODEL_H
@@ -0,0 +1,192 @@
+#include "sharedringbenchmark.h"
+
+#include <QDateTime>
+#include <QSysInfo>
+
+#include <algorithm>
+
+// One attached consumer, reads until producer is finished and ring is drained
+class RingReader : public QRunnable
+{
+public:
+    RingReader( const QByteArray &name, const QAtomicInt &finished, QAtomicInt &attached, SharedRingBenchmark::ReaderResult &result ) :
+        name( name ),
+        finished( finished ),
+        attached( attached ),
+        result( result )
+    {
+    }
+
+    void run() {
+        SharedSampleReader reader;
+        SharedSampleRecord records[SharedRingBenchmark::ReadBatchSize];
+
+        result.receivedCount = 0;
+        result.lostCount = 0;
+
+        bool ok = reader.attach( name.constData() );
+
+        attached.fetchAndAddRelease( 1 );
+
+        if ( !ok ) {
+            return;
+        }
+
+        while ( true ) {
+            int count = reader.read( records, SharedRingBenchmark::ReadBatchSize );
+            int64_t now = sharedSampleClock();
+
+            for ( int i = 0; i < count && result.latencies.size() < SharedRingBenchmark::MaxLatencyCount; i++ ) {
+                result.latencies.append( now - records[i].publishNanosec );
+            }
+
+            result.receivedCount += count;
+
+            if ( count == 0 ) {
+                if ( finished.loadAcquire() ) {
+                    break;
+                }
+
+                reader.wait( SharedRingBenchmark::WaitMicrosec );
+            }
+        }
+
+        result.lostCount = reader.getLostCount();
+
+        std::sort( result.latencies.begin(), result.latencies.end() );
+    }
+
+private:
+    QByteArray name;
+    const QAtomicInt &finished;
+    QAtomicInt &attached;
+    SharedRingBenchmark::ReaderResult &result;
+};
+
+static qint64 percentile( const QVector<qint64> &sorted, double ratio )
+{
+    if ( sorted.isEmpty() ) {
+        return 0;
+    }
+
+    return sorted[qMin( sorted.size() - 1, (int)( sorted.size() * ratio ) )];
+}
+
+SharedRingBenchmark::SharedRingBenchmark() :
+    readerCount( 2 ),
+    name( QString( "/colorsensor-bench-%1" ).arg( getpid() ) )
+{
+}
+
+int SharedRingBenchmark::getReaderCount() const
+{
+    return readerCount;
+}
+
+void SharedRingBenchmark::setReaderCount(int value)
+{
+    readerCount = value;
+}
+
+QJsonObject SharedRingBenchmark::run()
+{
+    // Paced rates, then producer as fast as it can write ( rate 0 )
+    QJsonArray steps;
+    const int rates[] = { 1000, 10000, 100000, 1000000, 0 };
+
+    for ( int rate : rates ) {
+        steps.append( runStep( rate ) );
+    }
+
+    QJsonObject root;
+
+    root["benchmark"] = QString( "sharedRing" );
+    root["date"] = QDateTime::currentDateTimeUtc().toString( Qt::ISODate );
+    root["qtVersion"] = QString( qVersion() );
+    root["cpu"] = QSysInfo::currentCpuArchitecture();
+    root["threads"] = QThread::idealThreadCount();
+    root["capacity"] = Capacity;
+    root["readers"] = readerCount;
+    root["stepMs"] = StepMillisec;
+    root["steps"] = steps;
+
+    return root;
+}
+
+QJsonObject SharedRingBenchmark::runStep(int rate)
+{
+    SharedSampleRing ring;
+    QVector<ReaderResult> results( readerCount );
+    QAtomicInt finished( 0 );
+    QAtomicInt attached( 0 );
+    QThreadPool pool;
+    QJsonObject json;
+
+    json["rate"] = rate;
+
+    if ( !ring.open( name, Capacity ) ) {
+        json["error"] = QString( "Failed to open shared memory" );
+
+        return json;
+    }
+
+    pool.setMaxThreadCount( readerCount );
+
+    for ( int i = 0; i < readerCount; i++ ) {
+        pool.start( new RingReader( name.toLocal8Bit(), finished, attached, results[i] ) );
+    }
+
+    while ( attached.loadAcquire() < readerCount ) {
+        QThread::yieldCurrentThread();
+    }
+
+    // Producer paces by busy waiting, sleeping would dominate latency at high rates
+    ColorSensorAccess::ColorData data;
+    QElapsedTimer elapsed;
+    qint64 written = 0;
+
+    data.blue = data.green = data.red = data.infraRed = 0;
+    data.controlByte = 0;
+    data.manualTime = 0;
+
+    elapsed.start();
+
+    while ( elapsed.elapsed() < StepMillisec ) {
+        if ( rate > 0 && elapsed.nsecsElapsed() < written * 1000000000 / rate ) {
+            continue;
+        }
+
+        data.blue = written;
+        data.timestamp = ColorSensorAccess::timestampNow();
+
+        ring.append( data );
+        written++;
+    }
+
+    qint64 producerNanosec = elapsed.nsecsElapsed();
+
+    finished.storeRelease( 1 );
+    pool.waitForDone();
+    ring.close();
+
+    QJsonArray readers;
+
+    for ( const ReaderResult &result : results ) {
+        QJsonObject reader;
+
+        reader["received"] = (double)result.receivedCount;
+        reader["lost"] = (double)result.lostCount;
+        reader["p50Us"] = percentile( result.latencies, 0.5 ) / 1e3;
+        reader["p99Us"] = percentile( result.latencies, 0.99 ) / 1e3;
+        reader["p999Us"] = percentile( result.latencies, 0.999 ) / 1e3;
+        reader["maxUs"] = result.latencies.isEmpty() ? 0 : result.latencies.last() / 1e3;
+
+        readers.append( reader );
+    }
+
+    json["written"] = (double)written;
+    json["throughput"] = written / ( producerNanosec / 1e9 );
+    json["readers"] = readers;
+
+    return json;
+}
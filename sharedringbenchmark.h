@@ -0,0 +1,50 @@
+#ifndef SHAREDRINGBENCHMARK_H
+#define SHAREDRINGBENCHMARK_H
+
+#include <QVector>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include "sharedsamplering.h"
+#include "sharedsamplereader.h"
+
+// Publish to read latency of shared memory ring, readers attach by name like other processes do
+class SharedRingBenchmark
+{
+public:
+    enum Parameter {
+        StepMillisec = 1000,
+        Capacity = 4096,
+        ReadBatchSize = 256,
+        WaitMicrosec = 100000,
+        MaxLatencyCount = 4000000,     // Latencies kept per reader and step
+    };
+
+    struct ReaderResult {
+        qint64 receivedCount;
+        qint64 lostCount;
+        QVector<qint64> latencies;      // Sorted [ns]
+    };
+
+public:
+    SharedRingBenchmark();
+
+    int getReaderCount() const;
+    void setReaderCount(int value);
+
+    QJsonObject run();
+
+private:
+    QJsonObject runStep( int rate );
+
+private:
+    int readerCount;
+    QString name;
+};
+
+#endif // SHAREDRINGBENCHMARK_H
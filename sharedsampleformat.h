@@ -0,0 +1,113 @@
+#ifndef SHAREDSAMPLEFORMAT_H
+#define SHAREDSAMPLEFORMAT_H
+
+// Layout of POSIX shared memory sample ring, plain C++ so consumers do not need Qt
+//
+// Header, then capacity slots of one cache line. Sample n goes to slot n % capacity.
+// Slot sequence is 2n + 1 while sample n is written and 2n + 2 when it is complete,
+// a reader copies the record and accepts it only if sequence was 2n + 2 before and after.
+// Readers never write to the segment, so they cannot block the producer or each other.
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+static_assert( ATOMIC_LLONG_LOCK_FREE == 2, "Shared ring needs lock free 64 bit atomics" );
+
+enum SharedSampleParameter {
+    SharedSampleMagic = 0x474E5253,     // "SRNG"
+    SharedSampleVersion = 1,
+    SharedSampleCacheLine = 64,
+};
+
+struct SharedSampleRecord {
+    uint16_t blue;
+    uint16_t green;
+    uint16_t red;
+    uint16_t infraRed;
+    uint8_t controlByte;
+    uint8_t reserved;
+    uint16_t manualTime;
+    uint32_t reserved2;
+    int64_t timestamp;          // Sample timestamp of producer process [ns]
+    int64_t publishNanosec;     // CLOCK_MONOTONIC at publish, comparable between processes
+};
+
+struct alignas( SharedSampleCacheLine ) SharedSampleSlot {
+    std::atomic<uint64_t> sequence;
+    SharedSampleRecord record;
+};
+
+struct alignas( SharedSampleCacheLine ) SharedSampleHeader {
+    uint32_t magic;             // Written last by producer
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t slotSize;
+    int64_t producerPid;
+
+    alignas( SharedSampleCacheLine ) std::atomic<uint64_t> writeIndex;     // Number of next sample
+};
+
+enum SharedSampleStatus {
+    SharedSampleOk = 0,
+    SharedSampleNotYet,         // Not written yet
+    SharedSampleLapped,         // Overwritten by newer sample
+};
+
+static inline size_t sharedSampleSegmentSize( uint32_t capacity )
+{
+    return sizeof( SharedSampleHeader ) + (size_t)capacity * sizeof( SharedSampleSlot );
+}
+
+static inline SharedSampleSlot *sharedSampleSlots( SharedSampleHeader *header )
+{
+    return (SharedSampleSlot *)( (char *)header + sizeof( SharedSampleHeader ) );
+}
+
+static inline int64_t sharedSampleClock()
+{
+    timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Single producer, wait free
+static inline void sharedSampleWrite( SharedSampleHeader *header, const SharedSampleRecord &record )
+{
+    uint64_t n = header->writeIndex.load( std::memory_order_relaxed );
+    SharedSampleSlot &slot = sharedSampleSlots( header )[n % header->capacity];
+
+    slot.sequence.store( n * 2 + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    memcpy( (void *)&slot.record, &record, sizeof( record ) );
+
+    slot.sequence.store( n * 2 + 2, std::memory_order_release );
+    header->writeIndex.store( n + 1, std::memory_order_release );
+}
+
+static inline SharedSampleStatus sharedSampleRead( SharedSampleHeader *header, uint64_t n, SharedSampleRecord &record )
+{
+    const SharedSampleSlot &slot = sharedSampleSlots( header )[n % header->capacity];
+    uint64_t expected = n * 2 + 2;
+    uint64_t before = slot.sequence.load( std::memory_order_acquire );
+
+    if ( before != expected ) {
+        return before < expected ? SharedSampleNotYet : SharedSampleLapped;
+    }
+
+    memcpy( &record, (const void *)&slot.record, sizeof( record ) );
+    std::atomic_thread_fence( std::memory_order_acquire );
+
+    // Writer of a later lap started while copying
+    if ( slot.sequence.load( std::memory_order_relaxed ) != expected ) {
+        return SharedSampleLapped;
+    }
+
+    return SharedSampleOk;
+}
+
+#endif // SHAREDSAMPLEFORMAT_H
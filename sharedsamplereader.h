@@ -0,0 +1,215 @@
+#ifndef SHAREDSAMPLEREADER_H
+#define SHAREDSAMPLEREADER_H
+
+// Header only reader of shared memory sample ring, link with -lrt on older glibc
+//
+//   SharedSampleReader reader;
+//   SharedSampleRecord records[256];
+//
+//   reader.attach( "/colorsensor" );
+//
+//   while ( reader.wait( 100000 ) ) {
+//       int count = reader.read( records, 256 );
+//       ...
+//   }
+
+#include "sharedsampleformat.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+
+class SharedSampleReader
+{
+public:
+    enum Parameter {
+        SpinCount = 1000,           // Polls before sleeping in wait
+        SleepMicrosec = 50,
+        LapMarginDivisor = 8,       // After a lap, resume this part of capacity ahead of oldest
+    };
+
+public:
+    SharedSampleReader() :
+        fd( -1 ),
+        map( 0 ),
+        mapSize( 0 ),
+        header( 0 ),
+        position( 0 ),
+        lostCount( 0 )
+    {
+    }
+
+    ~SharedSampleReader() {
+        detach();
+    }
+
+    // Start at newest sample, or at oldest one still in ring
+    bool attach( const char *name, bool fromOldest = false ) {
+        struct stat st;
+
+        detach();
+
+        fd = shm_open( name, O_RDONLY, 0 );
+
+        if ( fd < 0 ) {
+            return false;
+        }
+
+        if ( fstat( fd, &st ) != 0 || (size_t)st.st_size < sizeof( SharedSampleHeader ) ) {
+            detach();
+            return false;
+        }
+
+        mapSize = st.st_size;
+        map = mmap( 0, mapSize, PROT_READ, MAP_SHARED, fd, 0 );
+
+        if ( map == MAP_FAILED ) {
+            map = 0;
+            detach();
+            return false;
+        }
+
+        header = (SharedSampleHeader *)map;
+
+        std::atomic_thread_fence( std::memory_order_acquire );
+
+        if ( header->magic != SharedSampleMagic || header->version != SharedSampleVersion ||
+             header->slotSize != sizeof( SharedSampleSlot ) || header->capacity == 0 ||
+             sharedSampleSegmentSize( header->capacity ) > mapSize ) {
+            detach();
+            return false;
+        }
+
+        uint64_t end = header->writeIndex.load( std::memory_order_acquire );
+
+        position = fromOldest && end > header->capacity ? end - header->capacity : ( fromOldest ? 0 : end );
+        lostCount = 0;
+
+        return true;
+    }
+
+    void detach() {
+        if ( map ) {
+            munmap( map, mapSize );
+        }
+
+        if ( fd >= 0 ) {
+            close( fd );
+        }
+
+        fd = -1;
+        map = 0;
+        mapSize = 0;
+        header = 0;
+    }
+
+    bool isAttached() const {
+        return header != 0;
+    }
+
+    // Producer has removed the segment, attach again to follow a new one
+    bool isStale() const {
+        struct stat st;
+
+        return fd < 0 || fstat( fd, &st ) != 0 || st.st_nlink == 0;
+    }
+
+    // Copies available samples without waiting, lapped samples are skipped and counted as lost
+    int read( SharedSampleRecord *records, int maxCount ) {
+        int count = 0;
+
+        if ( !header ) {
+            return 0;
+        }
+
+        while ( count < maxCount ) {
+            uint64_t end = header->writeIndex.load( std::memory_order_acquire );
+
+            if ( position >= end ) {
+                break;
+            }
+
+            if ( end - position > header->capacity ) {
+                skipTo( end - header->capacity + header->capacity / LapMarginDivisor );
+                continue;
+            }
+
+            SharedSampleStatus status = sharedSampleRead( header, position, records[count] );
+
+            if ( status == SharedSampleOk ) {
+                count++;
+                position++;
+            } else if ( status == SharedSampleLapped ) {
+                uint64_t now = header->writeIndex.load( std::memory_order_acquire );
+
+                skipTo( now > header->capacity ? now - header->capacity + header->capacity / LapMarginDivisor : position + 1 );
+            } else {
+                break;
+            }
+        }
+
+        return count;
+    }
+
+    // Polls until a sample is available or timeout passes
+    bool wait( int timeoutMicrosec ) {
+        if ( !header ) {
+            return false;
+        }
+
+        int64_t deadline = sharedSampleClock() + (int64_t)timeoutMicrosec * 1000;
+
+        for ( int spin = 0; ; spin++ ) {
+            if ( header->writeIndex.load( std::memory_order_acquire ) > position ) {
+                return true;
+            }
+
+            if ( sharedSampleClock() >= deadline ) {
+                return false;
+            }
+
+            if ( spin < SpinCount ) {
+                sched_yield();
+            } else {
+                usleep( SleepMicrosec );
+            }
+        }
+    }
+
+    uint64_t getPosition() const {
+        return position;
+    }
+
+    uint64_t getLostCount() const {
+        return lostCount;
+    }
+
+    uint32_t getCapacity() const {
+        return header ? header->capacity : 0;
+    }
+
+    int64_t getProducerPid() const {
+        return header ? header->producerPid : 0;
+    }
+
+private:
+    void skipTo( uint64_t next ) {
+        if ( next > position ) {
+            lostCount += next - position;
+            position = next;
+        }
+    }
+
+private:
+    int fd;
+    void *map;
+    size_t mapSize;
+    SharedSampleHeader *header;
+
+    uint64_t position;          // Number of next sample to read
+    uint64_t lostCount;
+};
+
+#endif // SHAREDSAMPLEREADER_H
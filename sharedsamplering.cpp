@@ -0,0 +1,152 @@
+#include "sharedsamplering.h"
+
+SharedSampleRing::SharedSampleRing() :
+    fd( -1 ),
+    map( 0 ),
+    mapSize( 0 ),
+    header( 0 )
+{
+}
+
+SharedSampleRing::~SharedSampleRing()
+{
+    close();
+}
+
+bool SharedSampleRing::open(QString name, int capacity)
+{
+    // Fresh segment each time, readers of an old one see it as stale
+    close();
+
+    if ( capacity <= 0 ) {
+        return false;
+    }
+
+    this->name = name.toLocal8Bit();
+
+    fd = shm_open( this->name.constData(), O_RDWR | O_CREAT | O_EXCL, 0644 );
+
+    // Segment of another live producer is never taken over, one left by a dead producer is
+    if ( fd < 0 && errno == EEXIST && isStale( this->name ) ) {
+        shm_unlink( this->name.constData() );
+
+        fd = shm_open( this->name.constData(), O_RDWR | O_CREAT | O_EXCL, 0644 );
+    }
+
+    if ( fd < 0 ) {
+        return false;
+    }
+
+    mapSize = sharedSampleSegmentSize( capacity );
+
+    if ( ftruncate( fd, mapSize ) != 0 ) {
+        close();
+        return false;
+    }
+
+    map = mmap( 0, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+    if ( map == MAP_FAILED ) {
+        map = 0;
+        close();
+        return false;
+    }
+
+    // New segment is zero filled, so every slot sequence is 0 ( nothing written )
+    header = (SharedSampleHeader *)map;
+    header->version = SharedSampleVersion;
+    header->capacity = capacity;
+    header->slotSize = sizeof( SharedSampleSlot );
+    header->producerPid = getpid();
+    header->writeIndex.store( 0, std::memory_order_relaxed );
+
+    std::atomic_thread_fence( std::memory_order_release );
+    header->magic = SharedSampleMagic;
+
+    return true;
+}
+
+void SharedSampleRing::close()
+{
+    if ( map ) {
+        munmap( map, mapSize );
+    }
+
+    if ( fd >= 0 ) {
+        ::close( fd );
+        shm_unlink( name.constData() );
+    }
+
+    fd = -1;
+    map = 0;
+    mapSize = 0;
+    header = 0;
+}
+
+bool SharedSampleRing::isOpen() const
+{
+    return header != 0;
+}
+
+void SharedSampleRing::append(const ColorSensorAccess::ColorData &data)
+{
+    if ( !header ) {
+        return;
+    }
+
+    SharedSampleRecord record;
+
+    record.blue = data.blue;
+    record.green = data.green;
+    record.red = data.red;
+    record.infraRed = data.infraRed;
+    record.controlByte = data.controlByte;
+    record.reserved = 0;
+    record.manualTime = data.manualTime;
+    record.reserved2 = 0;
+    record.timestamp = data.timestamp;
+    record.publishNanosec = sharedSampleClock();
+
+    sharedSampleWrite( header, record );
+}
+
+bool SharedSampleRing::isStale(const QByteArray &name)
+{
+    // Producer pid is written before segment is published, a segment without it is still being created
+    int existing = shm_open( name.constData(), O_RDONLY, 0 );
+
+    if ( existing < 0 ) {
+        return false;
+    }
+
+    struct stat info;
+    int64_t pid = 0;
+
+    if ( fstat( existing, &info ) == 0 && (size_t)info.st_size >= sizeof( SharedSampleHeader ) ) {
+        void *p = mmap( 0, sizeof( SharedSampleHeader ), PROT_READ, MAP_SHARED, existing, 0 );
+
+        if ( p != MAP_FAILED ) {
+            pid = ( (const SharedSampleHeader *)p )->producerPid;
+            munmap( p, sizeof( SharedSampleHeader ) );
+        }
+    }
+
+    ::close( existing );
+
+    return pid > 0 && kill( pid, 0 ) != 0 && errno == ESRCH;
+}
+
+QString SharedSampleRing::getName() const
+{
+    return QString::fromLocal8Bit( name );
+}
+
+quint64 SharedSampleRing::getWrittenCount() const
+{
+    return header ? header->writeIndex.load( std::memory_order_relaxed ) : 0;
+}
+
+QString SharedSampleRing::defaultName()
+{
+    return "/colorsensor";
+}
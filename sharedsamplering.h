@@ -0,0 +1,51 @@
+#ifndef SHAREDSAMPLERING_H
+#define SHAREDSAMPLERING_H
+
+#include <QString>
+#include <QByteArray>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+
+#include "colorsensoraccess.h"
+#include "sharedsampleformat.h"
+
+// Producer side of shared memory sample ring, readers use SharedSampleReader
+class SharedSampleRing
+{
+public:
+    enum Parameter {
+        DefaultCapacity = 65536,
+    };
+
+public:
+    SharedSampleRing();
+    ~SharedSampleRing();
+
+    bool open( QString name, int capacity = DefaultCapacity );
+    void close();
+    bool isOpen() const;
+
+    void append( const ColorSensorAccess::ColorData &data );
+
+    QString getName() const;
+    quint64 getWrittenCount() const;
+
+    static QString defaultName();
+
+private:
+    static bool isStale( const QByteArray &name );
+
+private:
+    int fd;                     // Open only for segment created here, so close unlinks own segment only
+    void *map;
+    size_t mapSize;
+    SharedSampleHeader *header;
+    QByteArray name;
+};
+
+#endif // SHAREDSAMPLERING_H
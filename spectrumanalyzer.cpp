@@ -0,0 +1,280 @@
+#include "spectrumanalyzer.h"
+
+#include <math.h>
+#include <string.h>
+
+SpectrumAnalyzer::SpectrumAnalyzer(QObject *parent) : QObject(parent),
+    fftSize( 0 ),
+    hopSize( 64 ),
+    log2Size( 0 ),
+    windowSum( 1 ),
+    analysisTimer( this )
+{
+    analysisTimer.setSingleShot( true );
+    analysisTimer.setInterval( AnalysisIntervalMillisec );
+
+    connect( &analysisTimer, SIGNAL(timeout()), this, SLOT(analyze()) );
+
+    setFftSize( 256 );
+}
+
+int SpectrumAnalyzer::getFftSize() const
+{
+    return fftSize;
+}
+
+void SpectrumAnalyzer::setFftSize(int value)
+{
+    // Size is rounded up to power of two, tables are built once here
+    int size = 16;
+    int bits = 4;
+
+    while ( size < value ) {
+        size *= 2;
+        bits++;
+    }
+
+    fftSize = size;
+    log2Size = bits;
+
+    window.resize( size );
+    windowSum = 0;
+
+    for ( int i = 0; i < size; i++ ) {
+        // Hann window
+        window[i] = 0.5f - 0.5f * cos( 2 * M_PI * i / size );
+        windowSum += window[i];
+    }
+
+    cosTable.resize( size / 2 );
+    sinTable.resize( size / 2 );
+
+    for ( int i = 0; i < size / 2; i++ ) {
+        cosTable[i] = cos( 2 * M_PI * i / size );
+        sinTable[i] = -sin( 2 * M_PI * i / size );
+    }
+
+    bitReverse.resize( size );
+
+    for ( int i = 0; i < size; i++ ) {
+        int r = 0;
+
+        for ( int b = 0; b < bits; b++ ) {
+            r |= ( ( i >> b ) & 1 ) << ( bits - 1 - b );
+        }
+
+        bitReverse[i] = r;
+    }
+
+    workRe.resize( size );
+    workIm.resize( size );
+
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        samples[ch].setCapacity( size );
+        spectrum[ch].fill( 0, size / 2 );
+    }
+
+    if ( hopSize > size ) {
+        hopSize = size;
+    }
+
+    clear();
+}
+
+int SpectrumAnalyzer::getHopSize() const
+{
+    return hopSize;
+}
+
+void SpectrumAnalyzer::setHopSize(int value)
+{
+    hopSize = qBound( 1, value, fftSize );
+}
+
+double SpectrumAnalyzer::getSampleRate() const
+{
+    return samplePeriod > 0 ? 1e9 / samplePeriod : 0;
+}
+
+QVector<float> SpectrumAnalyzer::getSpectrum(int channel) const
+{
+    return spectrum[channel];
+}
+
+SpectrumAnalyzer::ChannelResult SpectrumAnalyzer::getResult(int channel) const
+{
+    return result[channel];
+}
+
+void SpectrumAnalyzer::clear()
+{
+    hasLast = false;
+    lastTimestamp = 0;
+    samplePeriod = 0;
+    nextGridTime = 0;
+    samplesSinceAnalysis = 0;
+    analysisTimer.stop();
+
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        samples[ch].clear();
+        memset( &result[ch], 0, sizeof( ChannelResult ) );
+    }
+}
+
+void SpectrumAnalyzer::appendData(ColorSensorAccess::ColorData data)
+{
+    // Resample timestamped samples onto evenly spaced grid
+    float value[ChannelCount] = { (float)data.blue, (float)data.green, (float)data.red, (float)data.infraRed };
+
+    if ( !hasLast ) {
+        hasLast = true;
+        lastTimestamp = data.timestamp;
+        memcpy( lastValue, value, sizeof( lastValue ) );
+
+        return;
+    }
+
+    double dt = data.timestamp - lastTimestamp;
+
+    if ( dt <= 0 ) {
+        return;
+    }
+
+    if ( samplePeriod <= 0 ) {
+        samplePeriod = dt;
+        nextGridTime = lastTimestamp;
+    } else if ( dt > samplePeriod * 10 ) {
+        // Acquisition was paused, restart
+        clear();
+        appendData( data );
+
+        return;
+    } else {
+        // Track sample period slowly so jitter does not modulate grid
+        samplePeriod += ( dt - samplePeriod ) * 0.01;
+    }
+
+    while ( nextGridTime <= data.timestamp ) {
+        float t = ( nextGridTime - lastTimestamp ) / dt;
+        float uniform[ChannelCount];
+
+        for ( int ch = 0; ch < ChannelCount; ch++ ) {
+            uniform[ch] = lastValue[ch] + ( value[ch] - lastValue[ch] ) * t;
+        }
+
+        pushUniformSample( uniform );
+
+        nextGridTime += samplePeriod;
+    }
+
+    lastTimestamp = data.timestamp;
+    memcpy( lastValue, value, sizeof( lastValue ) );
+}
+
+void SpectrumAnalyzer::pushUniformSample(const float value[])
+{
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        samples[ch].append( value[ch] );
+    }
+
+    samplesSinceAnalysis++;
+
+    // Overlapping blocks, analyze every hop but not more often than display
+    if ( samples[0].isFull() && samplesSinceAnalysis >= hopSize && !analysisTimer.isActive() ) {
+        analysisTimer.start();
+    }
+}
+
+void SpectrumAnalyzer::analyze()
+{
+    // Block may have been cleared since timer was started
+    if ( !samples[0].isFull() ) {
+        return;
+    }
+
+    samplesSinceAnalysis = 0;
+
+    double binHz = getSampleRate() / fftSize;
+
+    for ( int ch = 0; ch < ChannelCount; ch++ ) {
+        const RingBuffer<float> &ring = samples[ch];
+        float *re = workRe.data();
+        float *im = workIm.data();
+        float sum = 0, min = ring.at( 0 ), max = ring.at( 0 );
+
+        for ( int i = 0; i < fftSize; i++ ) {
+            float v = ring.at( i );
+
+            sum += v;
+            min = qMin( min, v );
+            max = qMax( max, v );
+        }
+
+        float mean = sum / fftSize;
+
+        // Remove DC and apply window, input is stored in bit reversed order
+        for ( int i = 0; i < fftSize; i++ ) {
+            re[bitReverse[i]] = ( ring.at( i ) - mean ) * window[i];
+            im[bitReverse[i]] = 0;
+        }
+
+        fft( re, im );
+
+        // Single sided amplitude spectrum
+        float *spec = spectrum[ch].data();
+        float scale = 2.0f / windowSum;
+        int peak = 1;
+
+        for ( int k = 0; k < fftSize / 2; k++ ) {
+            spec[k] = sqrtf( re[k] * re[k] + im[k] * im[k] ) * scale;
+
+            if ( k > 0 && spec[k] > spec[peak] ) {
+                peak = k;
+            }
+        }
+
+        // Parabolic interpolation around peak bin
+        double offset = 0;
+
+        if ( peak > 0 && peak < fftSize / 2 - 1 ) {
+            double a = spec[peak - 1], b = spec[peak], c = spec[peak + 1];
+            double denom = a - 2 * b + c;
+
+            if ( denom != 0 ) {
+                offset = 0.5 * ( a - c ) / denom;
+            }
+        }
+
+        result[ch].mean = mean;
+        result[ch].dominantFrequency = ( peak + offset ) * binHz;
+        result[ch].dominantAmplitude = spec[peak];
+        result[ch].modulationDepth = ( max + min ) > 0 ? ( max - min ) / ( max + min ) : 0;
+    }
+
+    emit spectrumUpdated();
+}
+
+void SpectrumAnalyzer::fft(float *re, float *im) const
+{
+    // Iterative radix-2 DIT, input is already bit reversed
+    for ( int len = 2, tableStep = fftSize / 2; len <= fftSize; len *= 2, tableStep /= 2 ) {
+        int half = len / 2;
+
+        for ( int start = 0; start < fftSize; start += len ) {
+            for ( int k = 0; k < half; k++ ) {
+                float wr = cosTable[k * tableStep];
+                float wi = sinTable[k * tableStep];
+                int a = start + k;
+                int b = a + half;
+
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
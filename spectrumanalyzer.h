@@ -0,0 +1,87 @@
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <QObject>
+#include <QVector>
+#include <QTimer>
+
+#include "colorsensoraccess.h"
+#include "ringbuffer.h"
+
+class SpectrumAnalyzer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Parameter {
+        ChannelCount = 4,
+        AnalysisIntervalMillisec = 16,  // At most one analysis per display frame
+    };
+
+    struct ChannelResult {
+        double mean;
+        double dominantFrequency;
+        double dominantAmplitude;
+        double modulationDepth;
+    };
+
+public:
+    explicit SpectrumAnalyzer(QObject *parent = 0);
+
+    int getFftSize() const;
+    void setFftSize(int value);
+    int getHopSize() const;
+    void setHopSize(int value);
+
+    double getSampleRate() const;
+    QVector<float> getSpectrum( int channel ) const;
+    ChannelResult getResult( int channel ) const;
+
+public slots:
+    void appendData( ColorSensorAccess::ColorData data );
+    void clear();
+
+signals:
+    void spectrumUpdated();
+
+private slots:
+    void analyze();
+
+private:
+    void pushUniformSample( const float value[ChannelCount] );
+    void fft( float *re, float *im ) const;
+
+private:
+    int fftSize;
+    int hopSize;
+    int log2Size;
+
+    // Precomputed tables
+    QVector<float> window;
+    QVector<float> cosTable;
+    QVector<float> sinTable;
+    QVector<int> bitReverse;
+    float windowSum;
+
+    // Resampling onto uniform grid
+    bool hasLast;
+    qint64 lastTimestamp;
+    float lastValue[ChannelCount];
+    double samplePeriod;
+    double nextGridTime;
+
+    RingBuffer<float> samples[ChannelCount];
+    int samplesSinceAnalysis;
+
+    // Hops arriving faster than display are coalesced into one analysis of latest block
+    QTimer analysisTimer;
+
+    // Work buffers
+    QVector<float> workRe;
+    QVector<float> workIm;
+
+    QVector<float> spectrum[ChannelCount];
+    ChannelResult result[ChannelCount];
+};
+
+#endif // SPECTRUMANALYZER_H
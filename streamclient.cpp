@@ -0,0 +1,292 @@
+#include "streamclient.h"
+#include "streamserver.h"
+#include "sharedsampleformat.h"
+
+StreamClient::StreamClient(QObject *parent) : ColorSensorAccess(parent),
+    decimation( 1 ),
+    socket( 0 ),
+    connectTimer( this ),
+    connecting( false ),
+    clockOffset( 0 ),
+    clockValid( false )
+{
+    connectTimer.setSingleShot( true );
+    connectTimer.setInterval( ConnectTimeoutMillisec );
+
+    connect( &connectTimer, SIGNAL(timeout()), this, SLOT(socketError()) );
+
+    statistics.frameCount = 0;
+    statistics.sampleCount = 0;
+    statistics.droppedCount = 0;
+    statistics.maxTransportNanosec = 0;
+}
+
+bool StreamClient::openSensor(QString address)
+{
+    // Only checked here, socket is made in thread of this object
+    int colon = address.lastIndexOf( ':' );
+
+    if ( address.isEmpty() ) {
+        return false;
+    }
+
+    if ( colon >= 0 ) {
+        bool ok = false;
+        int port = address.mid( colon + 1 ).toInt( &ok );
+
+        if ( colon == 0 || !ok || port <= 0 || port > 65535 ) {
+            return false;
+        }
+    }
+
+    QMutexLocker locker( &clientMutex );
+
+    this->address = address;
+
+    return true;
+}
+
+bool StreamClient::initializeSensor(ColorSensorAccess::IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime, ColorSensorAccess::Gain gain)
+{
+    // Setting belongs to the station, each sample carries it
+    Q_UNUSED( intTime );
+    Q_UNUSED( manualIntegrationMode );
+    Q_UNUSED( manualTime );
+    Q_UNUSED( gain );
+
+    QMutexLocker locker( &clientMutex );
+
+    return !address.isEmpty();
+}
+
+void StreamClient::closeSensor()
+{
+    QMutexLocker locker( &clientMutex );
+
+    address.clear();
+}
+
+void StreamClient::readColors(bool waitForIntegration)
+{
+    // Samples arrive by themselves
+    Q_UNUSED( waitForIntegration );
+}
+
+QString StreamClient::getAddress()
+{
+    QMutexLocker locker( &clientMutex );
+
+    return address;
+}
+
+int StreamClient::getDecimation()
+{
+    QMutexLocker locker( &clientMutex );
+
+    return decimation;
+}
+
+void StreamClient::setDecimation(int value)
+{
+    // Taken at next connect, subscribe changes it while connected
+    QMutexLocker locker( &clientMutex );
+
+    decimation = value;
+}
+
+StreamClient::Statistics StreamClient::getStatistics()
+{
+    QMutexLocker locker( &clientMutex );
+
+    return statistics;
+}
+
+void StreamClient::startReading(bool continuously)
+{
+    Q_UNUSED( continuously );
+
+    connectToServer();
+}
+
+void StreamClient::connectToServer()
+{
+    disconnectFromServer();
+
+    clientMutex.lock();
+    QString target = address;
+    statistics.frameCount = 0;
+    statistics.sampleCount = 0;
+    statistics.droppedCount = 0;
+    statistics.maxTransportNanosec = 0;
+    clientMutex.unlock();
+
+    if ( target.isEmpty() ) {
+        emit connectFailed( "No address" );
+
+        return;
+    }
+
+    // Remote host may take long to answer, so connect runs on in event loop
+    // Local socket may connect or fail within connectToServer, so state is set before
+    int colon = target.lastIndexOf( ':' );
+
+    connecting = true;
+    connectTimer.start();
+
+    if ( colon > 0 ) {
+        QTcpSocket *tcp = new QTcpSocket( this );
+
+        connect( tcp, SIGNAL(connected()), this, SLOT(socketConnected()) );
+        connect( tcp, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(socketError()) );
+
+        socket = tcp;
+        tcp->connectToHost( target.left( colon ), target.mid( colon + 1 ).toInt() );
+    } else {
+        QLocalSocket *local = new QLocalSocket( this );
+
+        connect( local, SIGNAL(connected()), this, SLOT(socketConnected()) );
+        connect( local, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(socketError()) );
+
+        socket = local;
+        local->connectToServer( target );
+    }
+}
+
+void StreamClient::socketConnected()
+{
+    if ( !connecting ) {
+        return;
+    }
+
+    connecting = false;
+    connectTimer.stop();
+
+    QTcpSocket *tcp = qobject_cast<QTcpSocket *>( socket );
+
+    if ( tcp ) {
+        tcp->setSocketOption( QAbstractSocket::LowDelayOption, 1 );
+    }
+
+    clockValid = false;
+    buffer.clear();
+
+    connect( socket, SIGNAL(readyRead()), this, SLOT(readFrames()) );
+    connect( socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()) );
+
+    subscribe( getDecimation() );
+
+    emit connectionChanged( true );
+}
+
+void StreamClient::socketError()
+{
+    // Failure while connecting, errors of open connection end in disconnected
+    if ( !connecting ) {
+        return;
+    }
+
+    QString message = connectTimer.isActive() ? socket->errorString() : "Connection timed out";
+
+    connecting = false;
+    connectTimer.stop();
+
+    socket->disconnect( this );
+    socket->deleteLater();
+    socket = 0;
+
+    emit connectFailed( message );
+}
+
+void StreamClient::disconnectFromServer()
+{
+    if ( !socket ) {
+        return;
+    }
+
+    connecting = false;
+    connectTimer.stop();
+
+    // Closed on request, no disconnected handling
+    socket->disconnect( this );
+    socket->close();
+    socket->deleteLater();
+    socket = 0;
+
+    emit connectionChanged( false );
+}
+
+void StreamClient::subscribe(int decimation)
+{
+    // Sent again while connected, server switches at next frame
+    setDecimation( decimation );
+
+    if ( socket ) {
+        socket->write( QString( "SUBSCRIBE %1\n" ).arg( decimation ).toLatin1() );
+    }
+}
+
+void StreamClient::socketDisconnected()
+{
+    // Server went away
+    socket->deleteLater();
+    socket = 0;
+
+    emit connectionChanged( false );
+}
+
+void StreamClient::readFrames()
+{
+    buffer.append( socket->readAll() );
+
+    int offset = 0;
+
+    while ( buffer.size() - offset >= StreamServer::HeaderSize ) {
+        const uchar *frame = (const uchar *)buffer.constData() + offset;
+        quint32 magic = qFromLittleEndian<quint32>( frame );
+        quint32 count = qFromLittleEndian<quint32>( frame + 4 );
+
+        // Out of step with server, nothing after this can be trusted
+        if ( magic != StreamServer::FrameMagic || count > StreamServer::BatchSize ) {
+            buffer.clear();
+            disconnectFromServer();
+
+            return;
+        }
+
+        int size = StreamServer::HeaderSize + count * StreamServer::RecordSize;
+
+        if ( buffer.size() - offset < size ) {
+            break;
+        }
+
+        qint64 dropped = qFromLittleEndian<quint64>( frame + 16 );
+        qint64 now = sharedSampleClock();
+        qint64 transport = 0;
+
+        for ( quint32 i = 0; i < count; i++ ) {
+            qint64 publishNanosec;
+            ColorData data = StreamServer::readRecord( frame + StreamServer::HeaderSize + i * StreamServer::RecordSize, publishNanosec );
+
+            if ( !clockValid ) {
+                clockOffset = timestampNow() - data.timestamp;
+                clockValid = true;
+            }
+
+            data.timestamp += clockOffset;
+            transport = now - publishNanosec;
+
+            publish( data );
+        }
+
+        clientMutex.lock();
+        statistics.frameCount++;
+        statistics.sampleCount += count;
+        statistics.droppedCount = dropped;
+        statistics.maxTransportNanosec = qMax( statistics.maxTransportNanosec, transport );
+        clientMutex.unlock();
+
+        offset += size;
+    }
+
+    buffer.remove( 0, offset );
+}
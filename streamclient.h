@@ -0,0 +1,82 @@
+#ifndef STREAMCLIENT_H
+#define STREAMCLIENT_H
+
+#include <QObject>
+#include <QMutex>
+#include <QTcpSocket>
+#include <QLocalSocket>
+#include <QTimer>
+
+#include "colorsensoraccess.h"
+
+// Virtual sensor receiving samples of a StreamServer, so remote data takes the path of live data
+class StreamClient : public ColorSensorAccess
+{
+    Q_OBJECT
+
+public:
+    enum Parameter {
+        ConnectTimeoutMillisec = 3000,
+    };
+
+    struct Statistics {
+        qint64 frameCount;
+        qint64 sampleCount;
+        qint64 droppedCount;            // Reported by server
+        qint64 maxTransportNanosec;     // Frame publish to receive
+    };
+
+public:
+    explicit StreamClient(QObject *parent = 0);
+
+    // "host:port" or local socket name
+    bool openSensor( QString address );
+    bool initializeSensor( IntegrationTime intTime, bool manualIntegrationMode, uint16_t manualTime, Gain gain );
+    void closeSensor();
+
+    void readColors( bool waitForIntegration );
+
+    QString getAddress();
+    int getDecimation();
+    void setDecimation( int value );
+
+    Statistics getStatistics();
+
+public slots:
+    void startReading( bool continuously = false );
+
+    void connectToServer();
+    void disconnectFromServer();
+    void subscribe( int decimation );
+
+signals:
+    void connectionChanged( bool connected );
+    void connectFailed( QString message );
+
+private slots:
+    void socketConnected();
+    void socketError();
+    void readFrames();
+    void socketDisconnected();
+
+private:
+    QMutex clientMutex;
+
+    QString address;
+    int decimation;
+
+    QIODevice *socket;
+    QByteArray buffer;
+
+    // Connect does not block, result comes as connectionChanged or connectFailed
+    QTimer connectTimer;
+    bool connecting;
+
+    // Remote timestamps are moved onto local clock, keeping their spacing
+    qint64 clockOffset;
+    bool clockValid;
+
+    Statistics statistics;
+};
+
+#endif // STREAMCLIENT_H
@@ -0,0 +1,282 @@
+#include "streamserver.h"
+#include "sharedsampleformat.h"
+#include "tracer.h"
+#include "metrics.h"
+
+StreamServer::StreamServer(QObject *parent) : QObject(parent),
+    tcpServer( 0 ),
+    localServer( 0 ),
+    subscriberCount( 0 ),
+    sequence( 0 ),
+    flushTimer( this )
+{
+    flushTimer.setSingleShot( true );
+
+    connect( &flushTimer, SIGNAL(timeout()), this, SLOT(flush()) );
+}
+
+int StreamServer::getSubscriberCount() const
+{
+    return subscriberCount.load();
+}
+
+QString StreamServer::defaultName()
+{
+    return "colorsensor-stream";
+}
+
+bool StreamServer::listenTcp(int port)
+{
+    // Servers are made in slot so they belong to thread of this object
+    if ( !tcpServer ) {
+        tcpServer = new QTcpServer( this );
+
+        connect( tcpServer, SIGNAL(newConnection()), this, SLOT(acceptTcp()) );
+    }
+
+    return tcpServer->listen( QHostAddress::LocalHost, port );
+}
+
+bool StreamServer::listenLocal(QString name)
+{
+    if ( !localServer ) {
+        localServer = new QLocalServer( this );
+
+        connect( localServer, SIGNAL(newConnection()), this, SLOT(acceptLocal()) );
+    }
+
+    // Socket file is removed only when nobody answers on it, as left by a crashed process
+    if ( localServer->listen( name ) ) {
+        return true;
+    }
+
+    if ( localServer->serverError() != QAbstractSocket::AddressInUseError ) {
+        return false;
+    }
+
+    QLocalSocket probe;
+
+    probe.connectToServer( name );
+
+    if ( probe.waitForConnected( StaleProbeMillisec ) ) {
+        probe.abort();
+
+        return false;
+    }
+
+    QLocalServer::removeServer( name );
+
+    return localServer->listen( name );
+}
+
+void StreamServer::close()
+{
+    // Accepted sockets are children of servers
+    flushTimer.stop();
+    pending.clear();
+    subscribers.clear();
+    subscriberCount.store( 0 );
+
+    delete tcpServer;
+    delete localServer;
+
+    tcpServer = 0;
+    localServer = 0;
+}
+
+void StreamServer::acceptTcp()
+{
+    while ( tcpServer->hasPendingConnections() ) {
+        QTcpSocket *socket = tcpServer->nextPendingConnection();
+
+        socket->setSocketOption( QAbstractSocket::LowDelayOption, 1 );
+        accept( socket );
+    }
+}
+
+void StreamServer::acceptLocal()
+{
+    while ( localServer->hasPendingConnections() ) {
+        accept( localServer->nextPendingConnection() );
+    }
+}
+
+void StreamServer::accept(QIODevice *socket)
+{
+    Subscriber subscriber;
+
+    subscriber.decimation = 0;
+    subscriber.droppedCount = 0;
+
+    connect( socket, SIGNAL(readyRead()), this, SLOT(readRequest()) );
+    connect( socket, SIGNAL(disconnected()), this, SLOT(removeSubscriber()) );
+    connect( socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()) );
+
+    subscribers.insert( socket, subscriber );
+    subscriberCount.store( subscribers.size() );
+}
+
+void StreamServer::removeSubscriber()
+{
+    subscribers.remove( qobject_cast<QIODevice *>( sender() ) );
+    subscriberCount.store( subscribers.size() );
+}
+
+void StreamServer::readRequest()
+{
+    QIODevice *socket = qobject_cast<QIODevice *>( sender() );
+
+    if ( !socket || !subscribers.contains( socket ) ) {
+        return;
+    }
+
+    Subscriber &subscriber = subscribers[socket];
+
+    subscriber.request.append( socket->readAll() );
+
+    // Every complete line is a request, last one wins
+    int end;
+
+    while ( ( end = subscriber.request.indexOf( '\n' ) ) >= 0 ) {
+        QList<QByteArray> line = subscriber.request.left( end ).trimmed().split( ' ' );
+        bool ok = false;
+        int decimation = line.size() == 2 && line[0] == "SUBSCRIBE" ? line[1].toInt( &ok ) : 0;
+
+        subscriber.request.remove( 0, end + 1 );
+
+        if ( !ok || decimation < 1 || decimation > MaxDecimation ) {
+            socket->close();
+            return;
+        }
+
+        subscriber.decimation = decimation;
+    }
+
+    if ( subscriber.request.size() > MaxRequestSize ) {
+        socket->close();
+    }
+}
+
+void StreamServer::appendData(ColorSensorAccess::ColorData data)
+{
+    // Samples are not kept while nobody listens
+    if ( subscribers.isEmpty() && pending.isEmpty() ) {
+        sequence++;
+        return;
+    }
+
+    pending.append( data );
+
+    if ( pending.size() >= BatchSize ) {
+        flush();
+    } else if ( !flushTimer.isActive() ) {
+        flushTimer.start( FlushIntervalMillisec );
+    }
+}
+
+void StreamServer::flush()
+{
+    TRACE_SCOPE( "streamFlush" );
+
+    flushTimer.stop();
+
+    if ( pending.isEmpty() ) {
+        return;
+    }
+
+    // Records are encoded once for each decimation in use
+    qint64 publishNanosec = sharedSampleClock();
+    QHash<int, QByteArray> records;
+    QHash<int, quint64> firsts;
+
+    for ( auto it = subscribers.begin(); it != subscribers.end(); ++it ) {
+        QIODevice *socket = it.key();
+        Subscriber &subscriber = it.value();
+
+        if ( subscriber.decimation == 0 ) {
+            continue;
+        }
+
+        if ( !records.contains( subscriber.decimation ) ) {
+            quint64 first;
+
+            records.insert( subscriber.decimation, encodeRecords( subscriber.decimation, first, publishNanosec ) );
+            firsts.insert( subscriber.decimation, first );
+        }
+
+        const QByteArray &body = records[subscriber.decimation];
+        quint32 count = body.size() / RecordSize;
+
+        if ( count == 0 ) {
+            continue;
+        }
+
+        // Socket buffer would grow without limit behind a slow reader
+        if ( socket->bytesToWrite() > MaxPendingBytes ) {
+            subscriber.droppedCount += count;
+            Metrics::streamDropped.add( count );
+
+            continue;
+        }
+
+        uchar header[HeaderSize];
+
+        qToLittleEndian<quint32>( FrameMagic, header );
+        qToLittleEndian<quint32>( count, header + 4 );
+        qToLittleEndian<quint64>( firsts[subscriber.decimation], header + 8 );
+        qToLittleEndian<quint64>( subscriber.droppedCount, header + 16 );
+
+        socket->write( (const char *)header, HeaderSize );
+        socket->write( body );
+    }
+
+    sequence += pending.size();
+    pending.clear();
+}
+
+QByteArray StreamServer::encodeRecords(int decimation, quint64 &first, qint64 publishNanosec)
+{
+    // First pending sample number which is a multiple of decimation
+    first = ( sequence + decimation - 1 ) / decimation * decimation;
+
+    QByteArray body;
+
+    for ( quint64 n = first; n < sequence + pending.size(); n += decimation ) {
+        int offset = body.size();
+
+        body.resize( offset + RecordSize );
+        writeRecord( (uchar *)body.data() + offset, pending[n - sequence], publishNanosec );
+    }
+
+    return body;
+}
+
+void StreamServer::writeRecord(uchar *dest, const ColorSensorAccess::ColorData &data, qint64 publishNanosec)
+{
+    qToLittleEndian<quint16>( data.blue, dest );
+    qToLittleEndian<quint16>( data.green, dest + 2 );
+    qToLittleEndian<quint16>( data.red, dest + 4 );
+    qToLittleEndian<quint16>( data.infraRed, dest + 6 );
+    dest[8] = data.controlByte;
+    dest[9] = 0;
+    qToLittleEndian<quint16>( data.manualTime, dest + 10 );
+    qToLittleEndian<quint32>( 0, dest + 12 );
+    qToLittleEndian<qint64>( data.timestamp, dest + 16 );
+    qToLittleEndian<qint64>( publishNanosec, dest + 24 );
+}
+
+ColorSensorAccess::ColorData StreamServer::readRecord(const uchar *src, qint64 &publishNanosec)
+{
+    ColorSensorAccess::ColorData data;
+
+    data.blue = qFromLittleEndian<quint16>( src );
+    data.green = qFromLittleEndian<quint16>( src + 2 );
+    data.red = qFromLittleEndian<quint16>( src + 4 );
+    data.infraRed = qFromLittleEndian<quint16>( src + 6 );
+    data.controlByte = src[8];
+    data.manualTime = qFromLittleEndian<quint16>( src + 10 );
+    data.timestamp = qFromLittleEndian<qint64>( src + 16 );
+    publishNanosec = qFromLittleEndian<qint64>( src + 24 );
+
+    return data;
+}
@@ -0,0 +1,90 @@
+#ifndef STREAMSERVER_H
+#define STREAMSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QHostAddress>
+#include <QTimer>
+#include <QHash>
+#include <QVector>
+#include <QAtomicInt>
+
+#include "colorsensoraccess.h"
+
+// Publishes samples to remote viewers on localhost port and/or local socket
+//
+// Subscriber sends a line "SUBSCRIBE <decimation>\n", may send it again to change decimation.
+// Server sends frames, all fields little endian:
+//
+//   uint32 magic, uint32 count, uint64 sequence of first sample, uint64 dropped samples so far
+//   count records of RecordSize bytes, laid out like SharedSampleRecord
+//
+// Sample n is sent to a subscriber if n % decimation == 0. A subscriber which does not keep up
+// has frames skipped and counted as dropped, so it never delays the others.
+class StreamServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Parameter {
+        DefaultPort = 5555,
+        BatchSize = 256,                // Most samples in a frame
+        FlushIntervalMillisec = 20,     // Longest wait of a sample for its frame
+        MaxPendingBytes = 1 << 20,      // Unsent data of a subscriber before frames are skipped
+        MaxDecimation = 100000,
+        MaxRequestSize = 256,
+        StaleProbeMillisec = 100,       // Wait for live server on existing socket file
+        FrameMagic = 0x4D525453,        // "STRM"
+        HeaderSize = 24,
+        RecordSize = 32,
+    };
+
+    struct Subscriber {
+        int decimation;         // 0 until subscribed
+        quint64 droppedCount;
+        QByteArray request;
+    };
+
+public:
+    explicit StreamServer(QObject *parent = 0);
+
+    int getSubscriberCount() const;
+
+    static QString defaultName();
+    static void writeRecord( uchar *dest, const ColorSensorAccess::ColorData &data, qint64 publishNanosec );
+    static ColorSensorAccess::ColorData readRecord( const uchar *src, qint64 &publishNanosec );
+
+public slots:
+    bool listenTcp( int port );
+    bool listenLocal( QString name );
+    void close();
+
+    void appendData( ColorSensorAccess::ColorData data );
+    void flush();
+
+private slots:
+    void acceptTcp();
+    void acceptLocal();
+    void readRequest();
+    void removeSubscriber();
+
+private:
+    void accept( QIODevice *socket );
+    QByteArray encodeRecords( int decimation, quint64 &first, qint64 publishNanosec );
+
+private:
+    QTcpServer *tcpServer;
+    QLocalServer *localServer;
+
+    QHash<QIODevice *, Subscriber> subscribers;
+    QAtomicInt subscriberCount;
+
+    QVector<ColorSensorAccess::ColorData> pending;
+    quint64 sequence;           // Number of first pending sample
+    QTimer flushTimer;
+};
+
+#endif // STREAMSERVER_H
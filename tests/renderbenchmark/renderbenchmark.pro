@@ -0,0 +1,41 @@
+#-------------------------------------------------
+#
+# Offscreen render benchmark of WaveGraphWidget
+#
+#-------------------------------------------------
+
+QT       += core gui widgets testlib
+
+TARGET = tst_renderbenchmark
+TEMPLATE = app
+
+CONFIG += testcase console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# Graph is built from application sources, trace points are compiled out
+DEFINES += COLORSENSOR_NO_TRACE
+
+INCLUDEPATH += ../..
+DEPENDPATH += ../..
+
+# Same optimization as application
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+SOURCES += tst_renderbenchmark.cpp \
+    ../../wavegraphwidget.cpp \
+    ../../wavedatastore.cpp \
+    ../../wavedataqueue.cpp \
+    ../../blockcodec.cpp \
+    ../../channelexpression.cpp \
+    ../../metrics.cpp
+
+HEADERS += ../../wavegraphwidget.h \
+    ../../wavedatastore.h \
+    ../../wavedataqueue.h \
+    ../../blockcodec.h \
+    ../../channelexpression.h \
+    ../../metrics.h \
+    ../../tracer.h
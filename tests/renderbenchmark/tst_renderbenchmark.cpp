@@ -0,0 +1,327 @@
+#include <QtTest>
+#include <QImage>
+#include <QMouseEvent>
+#include <QApplication>
+
+#include <math.h>
+#include <malloc.h>
+
+#include "wavegraphwidget.h"
+
+// Offscreen frame time of WaveGraphWidget over queue size, scale, channels, width and view options
+//
+//   Queue sizes above RENDER_BENCHMARK_MAX_ROWS ( default 100k ) are skipped,
+//   set it to 10000000 for full sweep up to 10M rows,
+//   results are machine readable with "-o result.xml,xml" or "-csv"
+class RenderBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Parameter {
+        Height = 400,
+        HeapFrameCount = 10,        // Frames of heap growth measurement
+    };
+
+    enum AutoScaleMode {
+        FixedScale = 0,
+        AutoMax,
+        AutoMinMax,
+        AutoScaleModeCount,
+    };
+
+public:
+    RenderBenchmark();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void fill_data();
+    void fill();
+
+    void render_data();
+    void render();
+
+    void heapGrowth_data();
+    void heapGrowth();
+
+private:
+    void makeValues( int rowCount, int columnCount, QVector<qint32> &values );
+    void prepare( int rowCount, int columnCount );
+    void apply();
+    void addSizeRows();
+
+    static QString autoScaleName( int mode );
+    static qint64 heapInUse();
+
+private:
+    int maxRowCount;
+
+    // One filled widget serves every view setting of a size, rows are ordered by size
+    WaveGraphWidget *wave;
+    int filledRowCount;
+    int filledColumnCount;
+};
+
+RenderBenchmark::RenderBenchmark() :
+    maxRowCount( 100000 ),
+    wave( 0 ),
+    filledRowCount( 0 ),
+    filledColumnCount( 0 )
+{
+}
+
+void RenderBenchmark::initTestCase()
+{
+    QByteArray max = qgetenv( "RENDER_BENCHMARK_MAX_ROWS" );
+
+    if ( !max.isEmpty() ) {
+        maxRowCount = max.toInt();
+    }
+}
+
+void RenderBenchmark::cleanupTestCase()
+{
+    delete wave;
+    wave = 0;
+}
+
+void RenderBenchmark::addSizeRows()
+{
+    QTest::addColumn<int>( "rows" );
+    QTest::addColumn<int>( "columns" );
+
+    for ( int rowCount = 1000; rowCount <= 10000000 && rowCount <= maxRowCount; rowCount *= 10 ) {
+        for ( int columnCount : { 1, 4 } ) {
+            QTest::newRow( QString( "rows=%1 columns=%2" ).arg( rowCount ).arg( columnCount ).toLatin1() ) << rowCount << columnCount;
+        }
+    }
+}
+
+void RenderBenchmark::fill_data()
+{
+    addSizeRows();
+}
+
+void RenderBenchmark::fill()
+{
+    // Bulk load of whole queue
+    QFETCH( int, rows );
+    QFETCH( int, columns );
+
+    QVector<qint32> values;
+    WaveGraphWidget target;
+
+    makeValues( rows, columns, values );
+
+    QBENCHMARK_ONCE {
+        target.setQueueDataFromArray( values.constData(), rows, columns );
+    }
+}
+
+void RenderBenchmark::render_data()
+{
+    QTest::addColumn<int>( "rows" );
+    QTest::addColumn<int>( "columns" );
+    QTest::addColumn<double>( "xScale" );
+    QTest::addColumn<int>( "width" );
+    QTest::addColumn<int>( "autoScale" );
+    QTest::addColumn<bool>( "overlays" );
+    QTest::addColumn<bool>( "forceRequestedRawX" );
+
+    for ( int rowCount = 1000; rowCount <= 10000000 && rowCount <= maxRowCount; rowCount *= 10 ) {
+        for ( int columnCount : { 1, 4 } ) {
+            for ( double xScale : { 0.01, 1.0, 10.0 } ) {
+                for ( int width : { 640, 1920 } ) {
+                    for ( int autoScale = 0; autoScale < AutoScaleModeCount; autoScale++ ) {
+                        for ( int overlays = 0; overlays < 2; overlays++ ) {
+                            for ( int force = 0; force < 2; force++ ) {
+                                QString name = QString( "rows=%1 columns=%2 xScale=%3 width=%4 autoScale=%5 overlays=%6 force=%7" )
+                                        .arg( rowCount ).arg( columnCount ).arg( xScale ).arg( width )
+                                        .arg( autoScaleName( autoScale ) ).arg( overlays ).arg( force );
+
+                                QTest::newRow( name.toLatin1() ) << rowCount << columnCount << xScale << width << autoScale << (bool)overlays << (bool)force;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void RenderBenchmark::render()
+{
+    // Frame time of one render into image
+    QFETCH( int, rows );
+    QFETCH( int, columns );
+    QFETCH( int, width );
+
+    prepare( rows, columns );
+    apply();
+
+    QImage image( width, Height, QImage::Format_ARGB32_Premultiplied );
+
+    // Warm up caches of queue and font engine
+    wave->render( &image );
+
+    QBENCHMARK {
+        wave->render( &image );
+    }
+}
+
+void RenderBenchmark::heapGrowth_data()
+{
+    render_data();
+}
+
+void RenderBenchmark::heapGrowth()
+{
+    // Heap in use after frames minus before, per frame, glibc has no allocation counter
+    QFETCH( int, rows );
+    QFETCH( int, columns );
+    QFETCH( int, width );
+
+    prepare( rows, columns );
+    apply();
+
+    QImage image( width, Height, QImage::Format_ARGB32_Premultiplied );
+
+    wave->render( &image );
+
+    qint64 heap = heapInUse();
+
+    for ( int i = 0; i < HeapFrameCount; i++ ) {
+        wave->render( &image );
+    }
+
+    QTest::setBenchmarkResult( (qreal)( heapInUse() - heap ) / HeapFrameCount, QTest::BytesAllocated );
+}
+
+void RenderBenchmark::makeValues(int rowCount, int columnCount, QVector<qint32> &values)
+{
+    // Sensor like counts, slow wave with fixed pseudo random noise so every run draws the same data
+    quint32 seed = 12345;
+
+    values.resize( (qint64)rowCount * columnCount );
+
+    for ( int i = 0; i < rowCount; i++ ) {
+        for ( int col = 0; col < columnCount; col++ ) {
+            seed = seed * 1664525 + 1013904223;
+
+            values[(qint64)i * columnCount + col] = 20000 + 15000 * sin( i * 0.001 * ( col + 1 ) ) + ( seed >> 24 );
+        }
+    }
+}
+
+void RenderBenchmark::prepare(int rowCount, int columnCount)
+{
+    if ( wave && filledRowCount == rowCount && filledColumnCount == columnCount ) {
+        return;
+    }
+
+    QVector<qint32> values;
+    QStringList names;
+
+    delete wave;
+
+    wave = new WaveGraphWidget;
+    wave->setAttribute( Qt::WA_DontShowOnScreen );
+    wave->show();
+
+    for ( int col = 0; col < columnCount; col++ ) {
+        names << QString( "CH%1" ).arg( col );
+    }
+
+    makeValues( rowCount, columnCount, values );
+
+    wave->setNames( names );
+    wave->setUpSize( columnCount, rowCount );
+    wave->setQueueDataFromArray( values.constData(), rowCount, columnCount );
+
+    filledRowCount = rowCount;
+    filledColumnCount = columnCount;
+}
+
+void RenderBenchmark::apply()
+{
+    QFETCH( int, rows );
+    QFETCH( double, xScale );
+    QFETCH( int, width );
+    QFETCH( int, autoScale );
+    QFETCH( bool, overlays );
+    QFETCH( bool, forceRequestedRawX );
+
+    wave->resize( width, Height );
+    wave->setXScale( xScale );
+    wave->setXGrid( 100 / xScale );
+
+    wave->setAutoUpdateYMax( autoScale != FixedScale );
+    wave->setAutoUpdateYMin( autoScale == AutoMinMax );
+    wave->setYMax( 65535 );
+    wave->setYMin( 0 );
+
+    // Requested x is at newest sample, so both modes show the same span
+    wave->setForceRequestedRawX( forceRequestedRawX );
+    wave->moveHeadToHead( false, false );
+    wave->setRequestRawX( rows - 1 );
+
+    wave->setShowHeadValue( overlays );
+    wave->setShowCursor( overlays );
+    wave->setShowRightCursor( overlays );
+    wave->setShowCursorValue( overlays );
+    wave->clearCursor();
+    wave->clearRightCursor();
+
+    if ( overlays ) {
+        QMouseEvent left( QEvent::MouseButtonPress, QPointF( width / 3, Height / 2 ), Qt::LeftButton, Qt::LeftButton, Qt::NoModifier );
+        QMouseEvent right( QEvent::MouseButtonPress, QPointF( width * 2 / 3, Height / 2 ), Qt::RightButton, Qt::RightButton, Qt::NoModifier );
+
+        QCoreApplication::sendEvent( wave, &left );
+        QCoreApplication::sendEvent( wave, &right );
+    }
+}
+
+QString RenderBenchmark::autoScaleName(int mode)
+{
+    switch ( mode ) {
+    case FixedScale:
+        return "fixed";
+    case AutoMax:
+        return "max";
+    case AutoMinMax:
+        return "minmax";
+    default:
+        return "";
+    }
+}
+
+qint64 RenderBenchmark::heapInUse()
+{
+    // Bytes allocated by malloc, glibc only
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ( 2, 33 )
+    return mallinfo2().uordblks;
+#else
+    return (unsigned int)mallinfo().uordblks;
+#endif
+#else
+    return 0;
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+    // Rendering needs no display
+    if ( qgetenv( "QT_QPA_PLATFORM" ).isEmpty() ) {
+        qputenv( "QT_QPA_PLATFORM", "offscreen" );
+    }
+
+    QApplication a( argc, argv );
+    RenderBenchmark benchmark;
+
+    return QTest::qExec( &benchmark, argc, argv );
+}
+
+#include "tst_renderbenchmark.moc"
@@ -0,0 +1,47 @@
+#-------------------------------------------------
+#
+# Record file write, recovery and read back of SampleRecorder
+#
+#-------------------------------------------------
+
+QT       += core gui testlib
+
+TARGET = tst_samplerecorder
+TEMPLATE = app
+
+CONFIG += testcase console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# Recorder is built from application sources, trace points are compiled out
+DEFINES += COLORSENSOR_NO_TRACE
+
+INCLUDEPATH += ../..
+DEPENDPATH += ../..
+
+SOURCES += tst_samplerecorder.cpp \
+    ../../samplerecorder.cpp \
+    ../../blockcodec.cpp \
+    ../../colorsensoraccess.cpp \
+    ../../autoexposure.cpp \
+    ../../hdrmerger.cpp \
+    ../../darkcalibration.cpp \
+    ../../colorconverter.cpp \
+    ../../metrics.cpp \
+    ../../sharedsamplering.cpp
+
+HEADERS += ../../samplerecorder.h \
+    ../../blockcodec.h \
+    ../../colorsensoraccess.h \
+    ../../autoexposure.h \
+    ../../hdrmerger.h \
+    ../../darkcalibration.h \
+    ../../colorconverter.h \
+    ../../metrics.h \
+    ../../sharedsampleformat.h \
+    ../../sharedsamplering.h \
+    ../../tracer.h
+
+# shm_open
+LIBS += -lrt
@@ -0,0 +1,99 @@
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "samplerecorder.h"
+
+// Record file written by SampleRecorder is recovered and read back without loss
+class SampleRecorderTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void largeWindow();
+
+private:
+    static ColorSensorAccess::ColorData makeRecord( int index );
+    static bool sameRecord( const ColorSensorAccess::ColorData &a, const ColorSensorAccess::ColorData &b );
+};
+
+void SampleRecorderTest::largeWindow()
+{
+    // Window over chunk limit is split and later chunks survive reopen
+    QTemporaryDir dir;
+    QString path = dir.path() + "/large.rec";
+    int windowCount = SampleRecorder::MaxChunkRecordCount * 2 + 5;
+    int triggerIndex = SampleRecorder::MaxChunkRecordCount + 3;
+    int afterCount = 10;
+
+    QVector<ColorSensorAccess::ColorData> window( windowCount );
+
+    for ( int i = 0; i < windowCount; i++ ) {
+        window[i] = makeRecord( i );
+    }
+
+    SampleRecorder recorder;
+
+    QVERIFY( recorder.openFile( path ) );
+
+    recorder.appendWindow( window, triggerIndex );
+
+    for ( int i = 0; i < afterCount; i++ ) {
+        recorder.appendData( makeRecord( windowCount + i ) );
+    }
+
+    recorder.closeFile();
+
+    // Reopen recovers every chunk
+    QVERIFY( recorder.openFile( path ) );
+    recorder.closeFile();
+
+    SampleRecorder::RecoveryResult recovery = recorder.getLastRecovery();
+
+    QVERIFY( recovery.valid );
+    QCOMPARE( recovery.recordCount, (qint64)windowCount + afterCount );
+    QCOMPARE( recovery.discardedBytes, (qint64)0 );
+
+    QVector<ColorSensorAccess::ColorData> data;
+
+    QVERIFY( SampleRecorder::readFile( path, data ) );
+    QCOMPARE( data.size(), windowCount + afterCount );
+
+    for ( int i = 0; i < data.size(); i++ ) {
+        if ( !sameRecord( data[i], makeRecord( i ) ) ) {
+            QFAIL( qPrintable( QString( "Record %1 differs" ).arg( i ) ) );
+        }
+    }
+
+    QVector<SampleRecorder::CaptureWindow> windows;
+
+    QVERIFY( SampleRecorder::readWindows( path, windows ) );
+    QCOMPARE( windows.size(), 1 );
+    QCOMPARE( windows[0].firstRecord, (qint64)0 );
+    QCOMPARE( windows[0].recordCount, windowCount );
+    QCOMPARE( windows[0].triggerIndex, triggerIndex );
+}
+
+ColorSensorAccess::ColorData SampleRecorderTest::makeRecord(int index)
+{
+    ColorSensorAccess::ColorData d;
+
+    d.blue = index & 0xFFFF;
+    d.green = ( index * 7 ) & 0xFFFF;
+    d.red = ( index >> 4 ) & 0xFFFF;
+    d.infraRed = 1000 + ( index % 13 );
+    d.timestamp = (qint64)index * 1000000;
+    d.controlByte = ColorSensorAccess::makeControlByte( ColorSensorAccess::T11, false, ColorSensorAccess::High );
+    d.manualTime = 0;
+
+    return d;
+}
+
+bool SampleRecorderTest::sameRecord(const ColorSensorAccess::ColorData &a, const ColorSensorAccess::ColorData &b)
+{
+    return a.blue == b.blue && a.green == b.green && a.red == b.red && a.infraRed == b.infraRed &&
+            a.timestamp == b.timestamp && a.controlByte == b.controlByte && a.manualTime == b.manualTime;
+}
+
+QTEST_GUILESS_MAIN(SampleRecorderTest)
+
+#include "tst_samplerecorder.moc"
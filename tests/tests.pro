@@ -0,0 +1,11 @@
+#-------------------------------------------------
+#
+# Tests and benchmarks of application classes, run with
+#   qmake && make && make check
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += renderbenchmark \
+    samplerecorder
@@ -0,0 +1,113 @@
+#include "tracer.h"
+#include "colorsensoraccess.h"
+
+#include <QFile>
+#include <QThread>
+#include <QByteArray>
+
+QAtomicInt Tracer::enabled( 0 );
+QMutex Tracer::mutex;
+QList<Tracer::ThreadBuffer *> Tracer::buffers;
+
+void Tracer::setEnabled(bool value)
+{
+    enabled.store( value );
+}
+
+void Tracer::clear()
+{
+    // Drops recorded events, call while tracing is disabled
+    QMutexLocker locker( &mutex );
+
+    for ( ThreadBuffer *buffer : buffers ) {
+        buffer->written.storeRelease( 0 );
+    }
+}
+
+qint64 Tracer::now()
+{
+    // Same clock as sample timestamps, so delivery spans line up with sensor spans
+    return ColorSensorAccess::timestampNow();
+}
+
+Tracer::ThreadBuffer *Tracer::threadBuffer()
+{
+    // Buffers outlive their threads so they can be dumped later
+    static thread_local ThreadBuffer *buffer = 0;
+
+    if ( buffer ) {
+        return buffer;
+    }
+
+    QMutexLocker locker( &mutex );
+    QString name = QThread::currentThread()->objectName();
+
+    buffer = new ThreadBuffer;
+    buffer->events.resize( BufferSize );
+    buffer->written.store( 0 );
+    buffer->id = buffers.size() + 1;
+    buffer->name = name.isEmpty() ? QString( "Thread %1" ).arg( buffer->id ) : name;
+
+    buffers.append( buffer );
+
+    return buffer;
+}
+
+void Tracer::complete(const char *name, qint64 begin, qint64 end)
+{
+    // Single writer ring, event is published by count
+    ThreadBuffer *buffer = threadBuffer();
+    quint64 index = buffer->written.load();
+    Event &event = buffer->events[index % BufferSize];
+
+    event.name = name;
+    event.begin = begin;
+    event.duration = end - begin;
+
+    buffer->written.storeRelease( index + 1 );
+}
+
+bool Tracer::writeJson(const QString &filePath)
+{
+    // Complete events ( ph X ) in microseconds, one track per thread
+    QFile file( filePath );
+
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) ) {
+        return false;
+    }
+
+    QMutexLocker locker( &mutex );
+    QByteArray out;
+    bool first = true;
+
+    out.reserve( 1024 * 1024 );
+    out.append( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" );
+
+    for ( ThreadBuffer *buffer : buffers ) {
+        quint64 written = buffer->written.loadAcquire();
+        quint64 start = written > BufferSize ? written - BufferSize : 0;
+
+        out.append( first ? "" : ",\n" );
+        out.append( QString( "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,\"args\":{\"name\":\"%2\"}}" )
+                    .arg( buffer->id ).arg( buffer->name ).toUtf8() );
+        first = false;
+
+        for ( quint64 i = start; i < written; i++ ) {
+            const Event &event = buffer->events[i % BufferSize];
+
+            out.append( QString( ",\n{\"name\":\"%1\",\"ph\":\"X\",\"pid\":1,\"tid\":%2,\"ts\":%3,\"dur\":%4}" )
+                        .arg( event.name ).arg( buffer->id )
+                        .arg( event.begin / 1000.0, 0, 'f', 3 )
+                        .arg( event.duration / 1000.0, 0, 'f', 3 ).toUtf8() );
+
+            if ( out.size() > 512 * 1024 ) {
+                file.write( out );
+                out.clear();
+            }
+        }
+    }
+
+    out.append( "\n]}\n" );
+
+    return file.write( out ) == out.size() && file.flush();
+}
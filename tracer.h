@@ -0,0 +1,83 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QList>
+#include <QVector>
+#include <QString>
+
+// Scoped spans recorded into per thread buffers, dumped as Chrome trace event JSON ( Perfetto, chrome://tracing )
+// Disabled cost is one relaxed load, define COLORSENSOR_NO_TRACE to compile trace points out
+class Tracer
+{
+public:
+    enum Parameter {
+        BufferSize = 65536,         // Events kept per thread, oldest are overwritten
+    };
+
+    struct Event {
+        const char *name;           // Must be a literal, only pointer is kept
+        qint64 begin;               // [ns] of ColorSensorAccess::timestampNow
+        qint64 duration;
+    };
+
+public:
+    static inline bool isEnabled() {
+        return enabled.load();
+    }
+
+    static void setEnabled( bool value );
+    static void clear();
+    static bool writeJson( const QString &filePath );
+
+    static qint64 now();
+    static void complete( const char *name, qint64 begin, qint64 end );
+
+private:
+    struct ThreadBuffer {
+        QVector<Event> events;
+        QAtomicInteger<quint64> written;    // Only owner thread writes, dump reads with acquire
+        int id;
+        QString name;
+    };
+
+    static ThreadBuffer *threadBuffer();
+
+private:
+    static QAtomicInt enabled;
+    static QMutex mutex;
+    static QList<ThreadBuffer *> buffers;
+};
+
+class TraceScope
+{
+public:
+    inline explicit TraceScope( const char *name ) :
+        name( name ),
+        begin( Tracer::isEnabled() ? Tracer::now() : -1 )
+    {
+    }
+
+    inline ~TraceScope() {
+        if ( begin >= 0 ) {
+            Tracer::complete( name, begin, Tracer::now() );
+        }
+    }
+
+private:
+    const char *name;
+    qint64 begin;
+};
+
+#ifdef COLORSENSOR_NO_TRACE
+#define TRACE_SCOPE( name )
+#define TRACE_SPAN( name, begin )
+#else
+#define TRACE_JOIN2( a, b ) a##b
+#define TRACE_JOIN( a, b ) TRACE_JOIN2( a, b )
+#define TRACE_SCOPE( name ) TraceScope TRACE_JOIN( traceScope, __LINE__ )( name )
+#define TRACE_SPAN( name, begin ) do { if ( Tracer::isEnabled() ) Tracer::complete( name, begin, Tracer::now() ); } while ( 0 )
+#endif
+
+#endif // TRACER_H
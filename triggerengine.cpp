@@ -0,0 +1,300 @@
+#include "triggerengine.h"
+
+#include <math.h>
+#include <string.h>
+
+TriggerEngine::TriggerEngine(QObject *parent) : QObject(parent),
+    condition( Threshold ),
+    direction( Rising ),
+    channel( 0 ),
+    ratioChannel( 1 ),
+    level( 1000 ),
+    preTriggerCount( 100 ),
+    postTriggerCount( 100 ),
+    autoRearm( true ),
+    converter( 0 ),
+    state( Idle ),
+    triggerIndex( 0 ),
+    hasPrevious( false ),
+    previousMetric( 0 ),
+    hasBaseline( false ),
+    triggerTimestamp( 0 ),
+    lastLatencyNanosec( 0 )
+{
+    preTrigger.setCapacity( preTriggerCount );
+}
+
+void TriggerEngine::arm()
+{
+    // Start with empty pre trigger ring
+    preTrigger.setCapacity( preTriggerCount );
+
+    rearm();
+}
+
+void TriggerEngine::rearm()
+{
+    // Wait for condition, baseline is taken from next sample
+    // Pre trigger ring is kept, so next window is full even right after capture
+    window = QVector<ColorSensorAccess::ColorData>();
+
+    hasPrevious = false;
+    hasBaseline = false;
+
+    state = Armed;
+}
+
+void TriggerEngine::disarm()
+{
+    state = Idle;
+}
+
+void TriggerEngine::appendData(ColorSensorAccess::ColorData data)
+{
+    if ( state == Idle ) {
+        return;
+    }
+
+    if ( state == Capturing ) {
+        // Fill post trigger samples, they are pre trigger samples of next window too
+        window.append( data );
+        preTrigger.append( data );
+
+        if ( window.size() >= triggerIndex + 1 + postTriggerCount ) {
+            lastLatencyNanosec = ColorSensorAccess::timestampNow() - triggerTimestamp;
+
+            emit captured( window, triggerIndex, lastLatencyNanosec );
+
+            if ( autoRearm ) {
+                rearm();
+            } else {
+                state = Idle;
+            }
+        }
+
+        return;
+    }
+
+    // Armed, evaluate condition
+    double now = metric( data );
+    bool fire = false;
+
+    if ( hasPrevious ) {
+        switch ( condition ) {
+        case Threshold:
+        case Ratio:
+            fire = crossed( previousMetric, now );
+            break;
+        case Slope:
+            fire = ( direction != Falling && now >= level ) || ( direction != Rising && now <= -level );
+            break;
+        case DeltaE:
+            fire = now >= level;
+            break;
+        }
+    }
+
+    if ( fire ) {
+        // Snapshot pre trigger ring and start capturing, window is sized only when it is used
+        window = QVector<ColorSensorAccess::ColorData>();
+        window.reserve( preTrigger.size() + 1 + postTriggerCount );
+
+        for ( int i = 0; i < preTrigger.size(); i++ ) {
+            window.append( preTrigger.at( i ) );
+        }
+
+        triggerIndex = window.size();
+        triggerTimestamp = data.timestamp;
+
+        window.append( data );
+        preTrigger.append( data );
+
+        state = Capturing;
+
+        emit triggered( data.timestamp );
+
+        if ( postTriggerCount == 0 ) {
+            lastLatencyNanosec = ColorSensorAccess::timestampNow() - triggerTimestamp;
+
+            emit captured( window, triggerIndex, lastLatencyNanosec );
+
+            if ( autoRearm ) {
+                rearm();
+            } else {
+                state = Idle;
+            }
+        }
+
+        return;
+    }
+
+    preTrigger.append( data );
+
+    previous = data;
+    previousMetric = now;
+    hasPrevious = true;
+}
+
+double TriggerEngine::channelValue(const ColorSensorAccess::ColorData &data, int channel)
+{
+    switch ( channel ) {
+    case 0:
+        return data.blue;
+    case 1:
+        return data.green;
+    case 2:
+        return data.red;
+    default:
+        return data.infraRed;
+    }
+}
+
+double TriggerEngine::metric(const ColorSensorAccess::ColorData &data)
+{
+    // Scalar which is compared with level
+    switch ( condition ) {
+    case Slope:
+        return hasPrevious ? channelValue( data, channel ) - channelValue( previous, channel ) : 0;
+    case Ratio: {
+        double denom = channelValue( data, ratioChannel );
+
+        return denom > 0 ? channelValue( data, channel ) / denom : 0;
+    }
+    case DeltaE: {
+        if ( !converter ) {
+            return 0;
+        }
+
+        float lab[3];
+
+        converter->toLab( data, lab );
+
+        if ( !hasBaseline ) {
+            memcpy( baseline, lab, sizeof( baseline ) );
+            hasBaseline = true;
+        }
+
+        // CIE76
+        return sqrt( ( lab[0] - baseline[0] ) * ( lab[0] - baseline[0] ) +
+                     ( lab[1] - baseline[1] ) * ( lab[1] - baseline[1] ) +
+                     ( lab[2] - baseline[2] ) * ( lab[2] - baseline[2] ) );
+    }
+    case Threshold:
+    default:
+        return channelValue( data, channel );
+    }
+}
+
+bool TriggerEngine::crossed(double before, double now) const
+{
+    bool rising  = before < level && now >= level;
+    bool falling = before > level && now <= level;
+
+    switch ( direction ) {
+    case Rising:
+        return rising;
+    case Falling:
+        return falling;
+    default:
+        return rising || falling;
+    }
+}
+
+TriggerEngine::Condition TriggerEngine::getCondition() const
+{
+    return condition;
+}
+
+void TriggerEngine::setCondition(const Condition &value)
+{
+    condition = value;
+    hasPrevious = false;
+    hasBaseline = false;
+}
+
+TriggerEngine::Direction TriggerEngine::getDirection() const
+{
+    return direction;
+}
+
+void TriggerEngine::setDirection(const Direction &value)
+{
+    direction = value;
+}
+
+int TriggerEngine::getChannel() const
+{
+    return channel;
+}
+
+void TriggerEngine::setChannel(int value)
+{
+    channel = value;
+    hasPrevious = false;
+}
+
+int TriggerEngine::getRatioChannel() const
+{
+    return ratioChannel;
+}
+
+void TriggerEngine::setRatioChannel(int value)
+{
+    ratioChannel = value;
+    hasPrevious = false;
+}
+
+double TriggerEngine::getLevel() const
+{
+    return level;
+}
+
+void TriggerEngine::setLevel(double value)
+{
+    level = value;
+}
+
+int TriggerEngine::getPreTriggerCount() const
+{
+    return preTriggerCount;
+}
+
+void TriggerEngine::setPreTriggerCount(int value)
+{
+    preTriggerCount = qBound( 0, value, (int)MaxTriggerCount );
+}
+
+int TriggerEngine::getPostTriggerCount() const
+{
+    return postTriggerCount;
+}
+
+void TriggerEngine::setPostTriggerCount(int value)
+{
+    postTriggerCount = qBound( 0, value, (int)MaxTriggerCount );
+}
+
+bool TriggerEngine::getAutoRearm() const
+{
+    return autoRearm;
+}
+
+void TriggerEngine::setAutoRearm(bool value)
+{
+    autoRearm = value;
+}
+
+void TriggerEngine::setConverter(const ColorConverter *value)
+{
+    converter = value;
+}
+
+TriggerEngine::State TriggerEngine::getState() const
+{
+    return state;
+}
+
+qint64 TriggerEngine::getLastLatencyNanosec() const
+{
+    return lastLatencyNanosec;
+}
@@ -0,0 +1,107 @@
+#ifndef TRIGGERENGINE_H
+#define TRIGGERENGINE_H
+
+#include <QObject>
+#include <QVector>
+
+#include "colorsensoraccess.h"
+#include "colorconverter.h"
+#include "ringbuffer.h"
+
+class TriggerEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Parameter {
+        MaxTriggerCount = 500000,   // Pre or post trigger samples, whole window stays below record chunk limit
+    };
+
+    enum Condition {
+        Threshold = 0,
+        Slope,
+        DeltaE,
+        Ratio,
+    };
+
+    enum Direction {
+        Rising = 0,
+        Falling,
+        Either,
+    };
+
+    enum State {
+        Idle = 0,
+        Armed,
+        Capturing,
+    };
+
+public:
+    explicit TriggerEngine(QObject *parent = 0);
+
+    Condition getCondition() const;
+    void setCondition(const Condition &value);
+    Direction getDirection() const;
+    void setDirection(const Direction &value);
+    int getChannel() const;
+    void setChannel(int value);
+    int getRatioChannel() const;
+    void setRatioChannel(int value);
+    double getLevel() const;
+    void setLevel(double value);
+    int getPreTriggerCount() const;
+    void setPreTriggerCount(int value);
+    int getPostTriggerCount() const;
+    void setPostTriggerCount(int value);
+    bool getAutoRearm() const;
+    void setAutoRearm(bool value);
+    void setConverter( const ColorConverter *value );
+
+    State getState() const;
+    qint64 getLastLatencyNanosec() const;
+
+public slots:
+    void arm();
+    void disarm();
+    void appendData( ColorSensorAccess::ColorData data );
+
+signals:
+    void triggered( qint64 timestamp );
+    void captured( QVector<ColorSensorAccess::ColorData> window, int triggerIndex, qint64 latencyNanosec );
+
+private:
+    void rearm();
+    static double channelValue( const ColorSensorAccess::ColorData &data, int channel );
+    double metric( const ColorSensorAccess::ColorData &data );
+    bool crossed( double before, double now ) const;
+
+private:
+    Condition condition;
+    Direction direction;
+    int channel;
+    int ratioChannel;
+    double level;
+    int preTriggerCount;
+    int postTriggerCount;
+    bool autoRearm;
+
+    const ColorConverter *converter;
+
+    State state;
+
+    RingBuffer<ColorSensorAccess::ColorData> preTrigger;
+    QVector<ColorSensorAccess::ColorData> window;
+    int triggerIndex;
+
+    bool hasPrevious;
+    ColorSensorAccess::ColorData previous;
+    double previousMetric;
+
+    bool hasBaseline;
+    float baseline[3];
+
+    qint64 triggerTimestamp;
+    qint64 lastLatencyNanosec;
+};
+
+#endif // TRIGGERENGINE_H
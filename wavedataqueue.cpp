@@ -0,0 +1,614 @@
+#include "wavedataqueue.h"
+
+#include <string.h>
+#include <sys/file.h>
+
+WaveDataQueue::WaveDataQueue() :
+    useCount( 0 ),
+    lastSlot( 0 ),
+    pageMap( 0 ),
+    pageMapSize( 0 ),
+    pageEnd( 0 ),
+    pagedBytes( 0 ),
+    firstSeq( 0 ),
+    rowCount( 0 ),
+    blockCapacity( 0 ),
+    channelCount( -1 ),
+    encodedBytes( 0 )
+{
+    tail.number = -1;
+    tail.prefixReady = false;
+    tail.lastUse = 0;
+
+    for ( int i = 0; i < CacheBlocks; i++ ) {
+        cache[i].number = -1;
+        cache[i].prefixReady = false;
+        cache[i].lastUse = 0;
+    }
+
+    grow( 2 );
+}
+
+WaveDataQueue::~WaveDataQueue()
+{
+    closePageFile();
+}
+
+void WaveDataQueue::append(const QVector<double> &data)
+{
+    qint64 seq = firstSeq + rowCount;
+    int offset = seq & ( BlockSize - 1 );
+
+    if ( channelCount < 0 ) {
+        // First row after clear decides channels and origin of sums
+        channelCount = qMax( 0, data.size() - 1 );
+        origin = data.mid( 1 );
+    }
+
+    if ( offset == 0 ) {
+        startBlock( seq >> BlockShift, data );
+    }
+
+    tail.rows.append( data );
+    appendPrefix( tail, offset );
+
+    rowCount++;
+
+    if ( offset == BlockSize - 1 ) {
+        sealBlock();
+    }
+}
+
+void WaveDataQueue::startBlock(qint64 number, const QVector<double> &data)
+{
+    // Sums continue from previous block
+    QVector<double> base( channelCount * 3, 0 );
+
+    if ( tail.number == number - 1 && tail.rows.size() == BlockSize ) {
+        const QVector<double> &before = tail.rows.last();
+        int last = ( BlockSize - 1 ) * channelCount;
+        double dx = data.value( 0 ) - before.value( 0 );
+
+        for ( int ch = 0; ch < channelCount; ch++ ) {
+            double v = data.value( ch + 1 ) - origin[ch];
+            double vBefore = before.value( ch + 1 ) - origin[ch];
+
+            base[ch] = tail.base[ch] + tail.sum[last + ch];
+            base[channelCount + ch] = tail.base[channelCount + ch] + tail.squareSum[last + ch];
+            base[channelCount * 2 + ch] = tail.base[channelCount * 2 + ch] + tail.area[last + ch] + dx * ( v + vBefore ) / 2;
+        }
+    }
+
+    // Sealed block stays decoded in cache, it is usually drawn next
+    if ( tail.number >= 0 ) {
+        DecodedBlock &slot = cache[oldestSlot()];
+
+        qSwap( slot, tail );
+        slot.lastUse = ++useCount;
+    }
+
+    int liveBlocks = number - ( firstSeq >> BlockShift ) + 1;
+
+    if ( liveBlocks > blockCapacity ) {
+        grow( liveBlocks );
+    }
+
+    tail.number = number;
+    tail.rows.clear();
+    tail.rows.reserve( BlockSize );
+    tail.base = base;
+    tail.sum.resize( BlockSize * channelCount );
+    tail.squareSum.resize( BlockSize * channelCount );
+    tail.area.resize( BlockSize * channelCount );
+    tail.prefixReady = true;
+}
+
+void WaveDataQueue::sealBlock()
+{
+    // Column by column, x and every channel
+    Block &block = blocks[tail.number & ( blockCapacity - 1 )];
+    int count = tail.rows.size();
+    QVarLengthArray<double, BlockSize> column( count );
+    QByteArray encoded;
+
+    BlockCodec::putVarint( encoded, count );
+
+    for ( int col = 0; col <= channelCount; col++ ) {
+        for ( int i = 0; i < count; i++ ) {
+            column[i] = tail.rows[i].value( col );
+        }
+
+        BlockCodec::encodeDoubleColumn( column.constData(), count, encoded );
+    }
+
+    encoded.squeeze();
+
+    encodedBytes += encoded.size() - block.data.size();
+    block.data = encoded;
+    block.base = tail.base;
+
+    if ( pageFile.isOpen() ) {
+        pageOut( block );
+    }
+}
+
+void WaveDataQueue::removeFirst()
+{
+    if ( rowCount == 0 ) {
+        return;
+    }
+
+    qint64 number = firstSeq >> BlockShift;
+
+    firstSeq++;
+    rowCount--;
+
+    // Release block once its last row is gone
+    if ( ( firstSeq & ( BlockSize - 1 ) ) == 0 ) {
+        Block &block = blocks[number & ( blockCapacity - 1 )];
+
+        // Space in page file is reused after clear
+        encodedBytes -= block.data.size();
+        pagedBytes -= block.pageSize;
+        block.data = QByteArray();
+        block.base = QVector<double>();
+        block.pageSize = 0;
+
+        for ( int i = 0; i < CacheBlocks; i++ ) {
+            if ( cache[i].number == number ) {
+                cache[i].number = -1;
+            }
+        }
+    }
+}
+
+void WaveDataQueue::clear()
+{
+    for ( int i = 0; i < blocks.size(); i++ ) {
+        blocks[i].data = QByteArray();
+        blocks[i].base = QVector<double>();
+        blocks[i].pageSize = 0;
+    }
+
+    for ( int i = 0; i < CacheBlocks; i++ ) {
+        cache[i].number = -1;
+    }
+
+    tail.number = -1;
+    tail.rows.clear();
+
+    // Sequence keeps counting so stale iterators never point valid rows, next row starts a block
+    firstSeq = ( ( firstSeq + rowCount + BlockSize - 1 ) >> BlockShift ) << BlockShift;
+    rowCount = 0;
+    channelCount = -1;
+    encodedBytes = 0;
+    pageEnd = 0;
+    pagedBytes = 0;
+}
+
+void WaveDataQueue::reserve(int size)
+{
+    grow( ( size + BlockSize - 1 ) / BlockSize + 1 );
+}
+
+int WaveDataQueue::size() const
+{
+    return rowCount;
+}
+
+int WaveDataQueue::count() const
+{
+    return rowCount;
+}
+
+WaveDataQueue::iterator WaveDataQueue::begin()
+{
+    return iterator( this, firstSeq );
+}
+
+WaveDataQueue::iterator WaveDataQueue::end()
+{
+    return iterator( this, firstSeq + rowCount );
+}
+
+WaveDataQueue::iterator WaveDataQueue::at(int index)
+{
+    return iterator( this, firstSeq + index );
+}
+
+int WaveDataQueue::indexOf(const iterator &it) const
+{
+    return it.getSeq() - firstSeq;
+}
+
+QVector<double> &WaveDataQueue::row(qint64 seq)
+{
+    if ( seq < firstSeq || seq >= firstSeq + rowCount ) {
+        invalidRow = QVector<double>( qMax( 1, channelCount + 1 ), 0 );
+
+        return invalidRow;
+    }
+
+    return decodedBlock( seq >> BlockShift ).rows[seq & ( BlockSize - 1 )];
+}
+
+WaveDataQueue::DecodedBlock &WaveDataQueue::decodedBlock(qint64 number) const
+{
+    if ( tail.number == number ) {
+        return tail;
+    }
+
+    // Iterating rows hits same block again and again
+    if ( cache[lastSlot].number == number ) {
+        cache[lastSlot].lastUse = ++useCount;
+
+        return cache[lastSlot];
+    }
+
+    for ( int i = 0; i < CacheBlocks; i++ ) {
+        if ( cache[i].number == number ) {
+            cache[i].lastUse = ++useCount;
+            lastSlot = i;
+
+            return cache[i];
+        }
+    }
+
+    // Miss faults block in from memory or page file
+    lastSlot = oldestSlot();
+
+    DecodedBlock &slot = cache[lastSlot];
+
+    decodeBlock( blocks[number & ( blockCapacity - 1 )], slot );
+
+    slot.number = number;
+    slot.lastUse = ++useCount;
+
+    return slot;
+}
+
+int WaveDataQueue::oldestSlot() const
+{
+    int oldest = 0;
+
+    for ( int i = 1; i < CacheBlocks; i++ ) {
+        if ( cache[i].number < 0 || ( cache[oldest].number >= 0 && cache[i].lastUse < cache[oldest].lastUse ) ) {
+            oldest = i;
+        }
+    }
+
+    return oldest;
+}
+
+void WaveDataQueue::decodeBlock(const Block &block, DecodedBlock &decoded) const
+{
+    // Rows are rewritten in place, copies held by callers detach, unreadable block reads as zeros
+    const uchar *in = (const uchar *)block.data.constData();
+    const uchar *end = in + block.data.size();
+    int columns = channelCount + 1;
+
+    decoded.base = block.base;
+
+    if ( block.pageSize > 0 ) {
+        int baseBytes = channelCount * 3 * sizeof( double );
+
+        in = end = 0;
+        decoded.base.fill( 0, channelCount * 3 );
+
+        if ( pageMap && block.pageSize >= baseBytes ) {
+            memcpy( decoded.base.data(), pageMap + block.pageOffset, baseBytes );
+
+            in = pageMap + block.pageOffset + baseBytes;
+            end = pageMap + block.pageOffset + block.pageSize;
+        }
+    }
+    quint64 length = 0;
+    bool ok = BlockCodec::getVarint( in, end, length ) && length <= BlockSize;
+    int count = ok ? length : BlockSize;
+
+    QVarLengthArray<double, BlockSize * 8> values( count * columns );
+
+    for ( int col = 0; col < columns; col++ ) {
+        ok = ok && BlockCodec::decodeDoubleColumn( in, end, values.data() + col * count, count );
+    }
+
+    decoded.rows.resize( count );
+
+    for ( int i = 0; i < count; i++ ) {
+        decoded.rows[i].resize( columns );
+
+        double *row = decoded.rows[i].data();
+
+        for ( int col = 0; col < columns; col++ ) {
+            row[col] = ok ? values[col * count + i] : 0;
+        }
+    }
+
+    decoded.prefixReady = false;
+}
+
+void WaveDataQueue::appendPrefix(DecodedBlock &block, int offset) const
+{
+    const QVector<double> &data = block.rows[offset];
+    int cur = offset * channelCount;
+    int prev = cur - channelCount;
+
+    if ( offset == 0 ) {
+        for ( int ch = 0; ch < channelCount; ch++ ) {
+            double v = data.value( ch + 1 ) - origin[ch];
+
+            block.sum[cur + ch] = v;
+            block.squareSum[cur + ch] = v * v;
+            block.area[cur + ch] = 0;
+        }
+
+        return;
+    }
+
+    const QVector<double> &before = block.rows[offset - 1];
+    double dx = data.value( 0 ) - before.value( 0 );
+
+    for ( int ch = 0; ch < channelCount; ch++ ) {
+        double v = data.value( ch + 1 ) - origin[ch];
+        double vBefore = before.value( ch + 1 ) - origin[ch];
+
+        block.sum[cur + ch] = block.sum[prev + ch] + v;
+        block.squareSum[cur + ch] = block.squareSum[prev + ch] + v * v;
+        block.area[cur + ch] = block.area[prev + ch] + dx * ( v + vBefore ) / 2;
+    }
+}
+
+void WaveDataQueue::ensurePrefix(DecodedBlock &block) const
+{
+    // Sums inside decoded block are built on first statistics request
+    if ( block.prefixReady ) {
+        return;
+    }
+
+    int count = block.rows.size();
+
+    block.sum.resize( count * channelCount );
+    block.squareSum.resize( count * channelCount );
+    block.area.resize( count * channelCount );
+
+    for ( int i = 0; i < count; i++ ) {
+        appendPrefix( block, i );
+    }
+
+    block.prefixReady = true;
+}
+
+bool WaveDataQueue::getSpanStatistics(const iterator &first, const iterator &last, SpanStatistics &stat) const
+{
+    // Statistics of rows between two iterators (inclusive), at most two blocks are decoded
+    qint64 a = qMin( first.getSeq(), last.getSeq() );
+    qint64 b = qMax( first.getSeq(), last.getSeq() );
+
+    if ( a < firstSeq || b >= firstSeq + rowCount || channelCount < 0 ) {
+        return false;
+    }
+
+    int n = b - a + 1;
+    QVarLengthArray<double, 16> sumBefore( channelCount ), squareSumBefore( channelCount ), areaTo( channelCount );
+
+    // Sums before a, copied out as decoding b may reuse a's slot
+    {
+        DecodedBlock &block = decodedBlock( a >> BlockShift );
+        int offset = a & ( BlockSize - 1 );
+        int cur = offset * channelCount;
+        const QVector<double> &data = block.rows[offset];
+
+        ensurePrefix( block );
+
+        stat.startX = data.value( 0 );
+
+        for ( int ch = 0; ch < channelCount; ch++ ) {
+            double v = data.value( ch + 1 ) - origin[ch];
+
+            sumBefore[ch] = block.base[ch] + block.sum[cur + ch] - v;
+            squareSumBefore[ch] = block.base[channelCount + ch] + block.squareSum[cur + ch] - v * v;
+            areaTo[ch] = block.base[channelCount * 2 + ch] + block.area[cur + ch];
+        }
+    }
+
+    DecodedBlock &block = decodedBlock( b >> BlockShift );
+    int offset = b & ( BlockSize - 1 );
+    int cur = offset * channelCount;
+
+    ensurePrefix( block );
+
+    stat.count = n;
+    stat.endX = block.rows[offset].value( 0 );
+    stat.mean.resize( channelCount );
+    stat.variance.resize( channelCount );
+    stat.integral.resize( channelCount );
+
+    for ( int ch = 0; ch < channelCount; ch++ ) {
+        double sum = block.base[ch] + block.sum[cur + ch] - sumBefore[ch];
+        double squareSum = block.base[channelCount + ch] + block.squareSum[cur + ch] - squareSumBefore[ch];
+        double area = block.base[channelCount * 2 + ch] + block.area[cur + ch] - areaTo[ch];
+        double variance = n > 1 ? ( squareSum - sum * sum / n ) / ( n - 1 ) : 0;
+
+        stat.mean[ch] = sum / n + origin[ch];
+        stat.variance[ch] = variance > 0 ? variance : 0;
+        stat.integral[ch] = area + origin[ch] * ( stat.endX - stat.startX );
+    }
+
+    return true;
+}
+
+qint64 WaveDataQueue::getEncodedBytes() const
+{
+    return encodedBytes;
+}
+
+qint64 WaveDataQueue::getPagedBytes() const
+{
+    return pagedBytes;
+}
+
+bool WaveDataQueue::setPageFile(const QString &filePath)
+{
+    // Empty path brings paged blocks back to memory
+    if ( pageFile.isOpen() ) {
+        if ( filePath == pageFile.fileName() ) {
+            return true;
+        }
+
+        for ( qint64 number = firstSeq >> BlockShift; rowCount > 0 && number <= ( firstSeq + rowCount - 1 ) >> BlockShift; number++ ) {
+            pageIn( blocks[number & ( blockCapacity - 1 )] );
+        }
+
+        closePageFile();
+    }
+
+    if ( filePath.isEmpty() ) {
+        return true;
+    }
+
+    pageFile.setFileName( filePath );
+
+    if ( !pageFile.open( QIODevice::ReadWrite ) ) {
+        return false;
+    }
+
+    // File paged by other process is left untouched, lock is held until close
+    if ( flock( pageFile.handle(), LOCK_EX | LOCK_NB ) != 0 || !pageFile.resize( 0 ) ) {
+        pageFile.close();
+
+        return false;
+    }
+
+    // Full blocks already in memory go to file too
+    for ( qint64 number = firstSeq >> BlockShift; rowCount > 0 && number <= ( firstSeq + rowCount - 1 ) >> BlockShift; number++ ) {
+        Block &block = blocks[number & ( blockCapacity - 1 )];
+
+        if ( !block.data.isEmpty() && !pageOut( block ) ) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+QString WaveDataQueue::getPageFile() const
+{
+    return pageFile.isOpen() ? pageFile.fileName() : QString();
+}
+
+bool WaveDataQueue::isPaged() const
+{
+    return pageFile.isOpen();
+}
+
+bool WaveDataQueue::pageOut(Block &block)
+{
+    // Append to page file, block keeps in memory if file can not grow
+    int baseBytes = block.base.size() * sizeof( double );
+    int size = baseBytes + block.data.size();
+
+    if ( !reservePage( pageEnd + size ) ) {
+        return false;
+    }
+
+    memcpy( pageMap + pageEnd, block.base.constData(), baseBytes );
+    memcpy( pageMap + pageEnd + baseBytes, block.data.constData(), block.data.size() );
+
+    encodedBytes -= block.data.size();
+    pagedBytes += size;
+
+    block.pageOffset = pageEnd;
+    block.pageSize = size;
+    block.data = QByteArray();
+    block.base = QVector<double>();
+
+    pageEnd += size;
+
+    return true;
+}
+
+void WaveDataQueue::pageIn(Block &block)
+{
+    int baseBytes = channelCount * 3 * sizeof( double );
+
+    if ( block.pageSize == 0 || !pageMap ) {
+        return;
+    }
+
+    block.base.resize( channelCount * 3 );
+    memcpy( block.base.data(), pageMap + block.pageOffset, baseBytes );
+    block.data = QByteArray( (const char *)pageMap + block.pageOffset + baseBytes, block.pageSize - baseBytes );
+
+    encodedBytes += block.data.size();
+    pagedBytes -= block.pageSize;
+
+    block.pageSize = 0;
+}
+
+bool WaveDataQueue::reservePage(qint64 size)
+{
+    // File is grown in large steps and mapped whole, so remapping is rare
+    if ( size <= pageMapSize ) {
+        return true;
+    }
+
+    qint64 newSize = qMax( size, pageMapSize * 2 );
+
+    newSize = ( newSize + PageGrowSize - 1 ) / PageGrowSize * PageGrowSize;
+
+    if ( pageMap ) {
+        pageFile.unmap( pageMap );
+    }
+
+    if ( !pageFile.resize( newSize ) ) {
+        pageMap = pageMapSize > 0 ? pageFile.map( 0, pageMapSize ) : 0;
+
+        return false;
+    }
+
+    pageMap = pageFile.map( 0, newSize );
+    pageMapSize = pageMap ? newSize : 0;
+
+    return pageMap != 0;
+}
+
+void WaveDataQueue::closePageFile()
+{
+    if ( pageMap ) {
+        pageFile.unmap( pageMap );
+    }
+
+    // Removed while still locked, so file of other process is never removed
+    if ( pageFile.isOpen() ) {
+        QFile::remove( pageFile.fileName() );
+        pageFile.close();
+    }
+
+    pageMap = 0;
+    pageMapSize = 0;
+    pageEnd = 0;
+    pagedBytes = 0;
+}
+
+void WaveDataQueue::grow(int minBlockCapacity)
+{
+    // Capacity is power of two, blocks are placed again by number
+    int newCapacity = 2;
+
+    while ( newCapacity < minBlockCapacity ) {
+        newCapacity *= 2;
+    }
+
+    if ( newCapacity <= blockCapacity ) {
+        return;
+    }
+
+    QVector<Block> newBlocks( newCapacity );
+
+    for ( qint64 number = firstSeq >> BlockShift; rowCount > 0 && number <= ( firstSeq + rowCount - 1 ) >> BlockShift; number++ ) {
+        newBlocks[number & ( newCapacity - 1 )] = blocks[number & ( blockCapacity - 1 )];
+    }
+
+    blocks = newBlocks;
+    blockCapacity = newCapacity;
+}
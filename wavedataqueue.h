@@ -0,0 +1,154 @@
+#ifndef WAVEDATAQUEUE_H
+#define WAVEDATAQUEUE_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QVarLengthArray>
+#include <QFile>
+
+#include "blockcodec.h"
+
+// Random access FIFO of graph rows ( x, y0, y1, ... )
+// Iterators hold absolute sequence number, so they stay valid while rows are appended or removed
+// Full blocks of rows are kept compressed, a row reference stays valid until CacheBlocks other blocks are decoded
+// With page file set, full blocks are moved to a memory mapped file and only their offsets stay in RAM
+class WaveDataQueue
+{
+public:
+    enum Parameter {
+        BlockShift = 7,
+        BlockSize = 1 << BlockShift,
+        CacheBlocks = 16,
+        PageGrowSize = 16 * 1024 * 1024,
+    };
+
+    class iterator
+    {
+    public:
+        iterator() : queue( 0 ), seq( 0 ) {}
+        iterator( WaveDataQueue *queue, qint64 seq ) : queue( queue ), seq( seq ) {}
+
+        QVector<double> &operator*() const { return queue->row( seq ); }
+        QVector<double> *operator->() const { return &queue->row( seq ); }
+
+        iterator &operator++() { seq++; return *this; }
+        iterator operator++(int) { iterator ret = *this; seq++; return ret; }
+        iterator &operator--() { seq--; return *this; }
+        iterator operator--(int) { iterator ret = *this; seq--; return ret; }
+        iterator &operator+=( int n ) { seq += n; return *this; }
+        iterator &operator-=( int n ) { seq -= n; return *this; }
+        iterator operator+( int n ) const { return iterator( queue, seq + n ); }
+        iterator operator-( int n ) const { return iterator( queue, seq - n ); }
+        int operator-( const iterator &other ) const { return seq - other.seq; }
+
+        bool operator==( const iterator &other ) const { return seq == other.seq && queue == other.queue; }
+        bool operator!=( const iterator &other ) const { return !( *this == other ); }
+
+        qint64 getSeq() const { return seq; }
+
+    private:
+        WaveDataQueue *queue;
+        qint64 seq;
+    };
+
+    struct SpanStatistics {
+        int count;
+        double startX;
+        double endX;
+        QVector<double> mean;
+        QVector<double> variance;
+        QVector<double> integral;
+    };
+
+public:
+    WaveDataQueue();
+    ~WaveDataQueue();
+
+    void append( const QVector<double> &data );
+    void removeFirst();
+    void clear();
+    void reserve( int size );
+
+    int size() const;
+    int count() const;
+
+    iterator begin();
+    iterator end();
+    iterator at( int index );
+    int indexOf( const iterator &it ) const;
+
+    QVector<double> &row( qint64 seq );
+
+    bool getSpanStatistics( const iterator &first, const iterator &last, SpanStatistics &stat ) const;
+
+    qint64 getEncodedBytes() const;
+    qint64 getPagedBytes() const;
+
+    bool setPageFile( const QString &filePath );
+    QString getPageFile() const;
+    bool isPaged() const;
+
+private:
+    // Rows of one block, prefix values are inclusive and relative to block start
+    struct DecodedBlock {
+        qint64 number;
+        QVector<QVector<double> > rows;
+        QVector<double> base;       // Sum, square sum and area before block, per channel
+        QVector<double> sum;
+        QVector<double> squareSum;
+        QVector<double> area;
+        bool prefixReady;
+        quint64 lastUse;
+    };
+
+    // Paged block is base followed by coded data at pageOffset of page file
+    struct Block {
+        Block() : pageOffset( 0 ), pageSize( 0 ) {}
+
+        QByteArray data;
+        QVector<double> base;
+        qint64 pageOffset;
+        int pageSize;
+    };
+
+private:
+    void grow( int minBlockCapacity );
+    void startBlock( qint64 number, const QVector<double> &data );
+    void sealBlock();
+    DecodedBlock &decodedBlock( qint64 number ) const;
+    int oldestSlot() const;
+    void decodeBlock( const Block &block, DecodedBlock &decoded ) const;
+    bool pageOut( Block &block );
+    void pageIn( Block &block );
+    bool reservePage( qint64 size );
+    void closePageFile();
+    void appendPrefix( DecodedBlock &block, int offset ) const;
+    void ensurePrefix( DecodedBlock &block ) const;
+
+private:
+    // Ring of sealed blocks indexed by block number & mask
+    QVector<Block> blocks;
+
+    // Open block, and recently decoded blocks of which least recently used is replaced
+    mutable DecodedBlock tail;
+    mutable DecodedBlock cache[CacheBlocks];
+    mutable quint64 useCount;
+    mutable int lastSlot;
+
+    QFile pageFile;
+    uchar *pageMap;
+    qint64 pageMapSize;
+    qint64 pageEnd;
+    qint64 pagedBytes;
+
+    QVector<double> origin;
+    QVector<double> invalidRow;
+
+    qint64 firstSeq;
+    int rowCount;
+    int blockCapacity;
+    int channelCount;
+    qint64 encodedBytes;
+};
+
+#endif // WAVEDATAQUEUE_H
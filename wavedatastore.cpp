@@ -0,0 +1,114 @@
+#include "wavedatastore.h"
+
+WaveDataStore::WaveDataStore(QObject *parent) : QObject(parent),
+    capacity( 10000 )
+{
+}
+
+WaveDataQueue *WaveDataStore::getQueue()
+{
+    return &queue;
+}
+
+QMutex *WaveDataStore::getMutex()
+{
+    return &mutex;
+}
+
+int WaveDataStore::getCapacity()
+{
+    QMutexLocker locker( &mutex );
+
+    return capacity;
+}
+
+void WaveDataStore::setCapacity(int value)
+{
+    QMutexLocker locker( &mutex );
+
+    capacity = value;
+    queue.reserve( capacity + 1 );
+}
+
+void WaveDataStore::append(const QVector<double> &data)
+{
+    mutex.lock();
+    queue.append( data );
+    int removed = trim();
+    mutex.unlock();
+
+    emit rowsChanged( 1, removed );
+}
+
+void WaveDataStore::appendArray(const qint32 *values, int rowCount, int columnCount)
+{
+    // Bulk load of row major values, x is row index and views are notified once
+    if ( rowCount <= 0 || columnCount <= 0 ) {
+        return;
+    }
+
+    QVector<double> row( columnCount + 1 );
+
+    mutex.lock();
+
+    for ( int i = 0; i < rowCount; i++ ) {
+        double *r = row.data();
+
+        r[0] = i;
+
+        for ( int col = 0; col < columnCount; col++ ) {
+            r[col + 1] = values[(qint64)i * columnCount + col];
+        }
+
+        queue.append( row );
+    }
+
+    int removed = trim();
+    mutex.unlock();
+
+    emit rowsChanged( rowCount, removed );
+}
+
+void WaveDataStore::clear()
+{
+    mutex.lock();
+    queue.clear();
+    mutex.unlock();
+
+    emit cleared();
+}
+
+bool WaveDataStore::setPageFile(const QString &filePath)
+{
+    // Page old data to file instead of dropping it, empty path returns to capacity limit
+    mutex.lock();
+
+    int removed = 0;
+
+    if ( filePath.isEmpty() && queue.isPaged() ) {
+        while ( queue.size() > capacity ) {
+            queue.removeFirst();
+            removed++;
+        }
+    }
+
+    bool ret = queue.setPageFile( filePath );
+    mutex.unlock();
+
+    emit rowsChanged( 0, removed );
+
+    return ret;
+}
+
+int WaveDataStore::trim()
+{
+    // Paged queue keeps whole history
+    int removed = 0;
+
+    while ( queue.size() > capacity && !queue.isPaged() ) {
+        queue.removeFirst();
+        removed++;
+    }
+
+    return removed;
+}
@@ -0,0 +1,50 @@
+#ifndef WAVEDATASTORE_H
+#define WAVEDATASTORE_H
+
+#include <QObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSharedPointer>
+
+#include "wavedataqueue.h"
+
+// Graph rows shared by any number of WaveGraphWidget views, each view keeps only its own iterators
+// Rows are changed in thread of this object, other threads append through queued slot calls
+// Readers outside that thread hold getMutex() while using getQueue(), since reads decode into shared cache
+class WaveDataStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WaveDataStore(QObject *parent = 0);
+
+    WaveDataQueue *getQueue();
+    QMutex *getMutex();
+
+    int getCapacity();
+    void setCapacity( int value );
+
+    void appendArray( const qint32 *values, int rowCount, int columnCount );
+
+    bool setPageFile( const QString &filePath );
+
+signals:
+    // Oldest rows are removed after new ones are appended, views fix their iterators here
+    void rowsChanged( int appendedCount, int removedCount );
+    void cleared();
+
+public slots:
+    void append( const QVector<double> &data );
+    void clear();
+
+private:
+    int trim();
+
+private:
+    QMutex mutex;
+
+    WaveDataQueue queue;
+    int capacity;           // Rows kept when not paged
+};
+
+#endif // WAVEDATASTORE_H
@@ -1,7 +1,12 @@
 #include "wavegraphwidget.h"
+#include "tracer.h"
+#include "metrics.h"
 
 WaveGraphWidget::WaveGraphWidget(QWidget *parent) : QWidget(parent)
 {
+    // Own rows until another view's store is set
+    setDataStore( QSharedPointer<WaveDataStore>( new WaveDataStore ) );
+
     // Set default colors
     setBgColor( Qt::white );
     setGridColor( Qt::gray );
@@ -63,6 +68,8 @@ WaveGraphWidget::WaveGraphWidget(QWidget *parent) : QWidget(parent)
     requestRawX = 0;
 
     yGridCount = 0;
+
+    showRawChannels = true;
 }
 
 QColor WaveGraphWidget::getBgColor() const
@@ -108,11 +115,16 @@ void WaveGraphWidget::setStrColor(const QColor &value)
 void WaveGraphWidget::setUpSize( int columnCount, int queueSize )
 {
     // Setup
+    // Queue size is capacity of store, so it applies to all views sharing it
     this->columnCount = columnCount;
-    this->queueSize = queueSize;
 
-    for ( int i = 0; i < columnCount; i++ ) {
+    store->setCapacity( queueSize );
+
+    for ( int i = colors.size(); i < columnCount; i++ ) {
         colors << Qt::blue;
+    }
+
+    for ( int i = names.size(); i < columnCount; i++ ) {
         names << "noname";
     }
 }
@@ -124,43 +136,51 @@ void WaveGraphWidget::enqueueData( const QVector<double> &data )
 
 void WaveGraphWidget::enqueueData( const QVector<double> &data, bool updateHead )
 {
-    // Add data to queue
+    TRACE_SCOPE( "enqueueData" );
+
+    // Every view of store moves in storeRowsChanged, this one as updateHead says
+    bool defaultUpdate = defaultHeadUpdate;
+
+    defaultHeadUpdate = updateHead;
+    store->append( data );
+    defaultHeadUpdate = defaultUpdate;
+}
+
+void WaveGraphWidget::storeRowsChanged(int appendedCount, int removedCount)
+{
     bool headmove = false;
 
-    dataQueue.append( data );
+    // Iterators on removed rows move to oldest row
+    if ( removedCount > 0 ) {
+        qint64 first = dataQueue->begin().getSeq();
 
-    // update iterator
-    if ( updateHead ) {
-        setHead( dataQueue.end() - 1, dataQueue.size() - 1 );
+        if ( cursor.getSeq() < first )  cursor = dataQueue->begin();
+        if ( rightCursor.getSeq() < first )  rightCursor = dataQueue->begin();
 
-        headmove = true;
-    } else if ( dataQueue.size() == 1 ) {
-        // head is always valid iterator if dataQueue size is larger than 0
-        setHead( dataQueue.begin(), 0 );
+        if ( head.getSeq() < first ) {
+            setHead( dataQueue->begin(), 0 );
+        } else {
+            setHead( head, headIndex - removedCount );
+        }
 
         headmove = true;
     }
 
-    // dequeue
-    if ( dataQueue.size() > queueSize ) {
-        // reset iterator
-        if ( cursor == dataQueue.begin() )  cursor++;
-        if ( rightCursor == dataQueue.begin() )  rightCursor++;
-
-        // dequeue
-        dataQueue.removeFirst();
+    // update iterator
+    if ( appendedCount > 0 ) {
+        if ( defaultHeadUpdate ) {
+            setHead( dataQueue->end() - 1, dataQueue->size() - 1 );
 
-        // move head
-        setHead( head, headIndex - 1 );
+            headmove = true;
+        } else if ( dataQueue->size() <= appendedCount ) {
+            // head is always valid iterator if dataQueue size is larger than 0
+            setHead( dataQueue->begin(), 0 );
 
-        if ( headIndex < 0 ) {
-            setHead( dataQueue.begin(), 0 );
+            headmove = true;
         }
-
-        headmove = true;
     }
 
-    emit rangeChanged( 0, dataQueue.size() - 1 );
+    emit rangeChanged( 0, dataQueue->size() - 1 );
 
     if ( headmove ) {
         emitHeadChanged( true );
@@ -169,6 +189,64 @@ void WaveGraphWidget::enqueueData( const QVector<double> &data, bool updateHead
     update();
 }
 
+void WaveGraphWidget::storeCleared()
+{
+    resetIterator();
+
+    update();
+}
+
+QSharedPointer<WaveDataStore> WaveGraphWidget::getDataStore() const
+{
+    return store;
+}
+
+void WaveGraphWidget::setDataStore(QSharedPointer<WaveDataStore> value)
+{
+    // View shows rows of another view, own iterators start over at newest row
+    if ( store ) {
+        disconnect( store.data(), 0, this, 0 );
+    }
+
+    store = value;
+    dataQueue = store->getQueue();
+
+    connect( store.data(), SIGNAL(rowsChanged(int,int)), this, SLOT(storeRowsChanged(int,int)) );
+    connect( store.data(), SIGNAL(cleared()), this, SLOT(storeCleared()) );
+
+    resetIterator();
+
+    headIndex = 0;
+    validCursor = false;
+    validRightCursor = false;
+
+    moveHeadToHead( true, true );
+
+    emit rangeChanged( 0, dataQueue->size() - 1 );
+
+    update();
+}
+
+bool WaveGraphWidget::setPageFile(const QString &filePath)
+{
+    // Paging belongs to store, so it applies to all views sharing it
+    bool ret = store->setPageFile( filePath );
+
+    emitHeadChanged( true );
+
+    return ret;
+}
+
+bool WaveGraphWidget::isPaged() const
+{
+    return dataQueue->isPaged();
+}
+
+qint64 WaveGraphWidget::getPagedBytes() const
+{
+    return dataQueue->getPagedBytes();
+}
+
 double WaveGraphWidget::getXScale() const
 {
     return xScale;
@@ -189,11 +267,11 @@ void WaveGraphWidget::setXScale(int value)
 void WaveGraphWidget::moveHeadToHead(bool emitSignal, bool indexOnly)
 {
     // ヘッドイテレーターを最新のデータに移動する
-    if ( dataQueue.size() == 0 ) {
+    if ( dataQueue->size() == 0 ) {
         return;
     }
 
-    setHead( dataQueue.end() - 1, dataQueue.size() - 1 );
+    setHead( dataQueue->end() - 1, dataQueue->size() - 1 );
 
     if ( emitSignal ) {
         emit headChanged( headIndex );
@@ -311,10 +389,10 @@ WaveGraphWidget::DataQueue::iterator WaveGraphWidget::pixPosToIterator(int x)
 {
     // Get iterator from widget pix pos X
     double ix;
-    auto ret = dataQueue.end();
+    auto ret = dataQueue->end();
 
     // check available
-    if ( dataQueue.size() == 0 ) {
+    if ( dataQueue->size() == 0 ) {
         return ret;
     }
 
@@ -337,7 +415,7 @@ WaveGraphWidget::DataQueue::iterator WaveGraphWidget::pixPosToIterator(int x)
             break;
         }
 
-        if ( it == dataQueue.begin() ) {
+        if ( it == dataQueue->begin() ) {
             // Exit
             ret = it;
             break;
@@ -352,9 +430,9 @@ WaveGraphWidget::DataQueue::iterator WaveGraphWidget::pixPosToIterator(int x)
 
 void WaveGraphWidget::resetIterator()
 {
-    head = dataQueue.end();
-    cursor = dataQueue.end();
-    rightCursor = dataQueue.end();
+    head = dataQueue->end();
+    cursor = dataQueue->end();
+    rightCursor = dataQueue->end();
 
     validCursor = false;
     validRightCursor = false;
@@ -365,7 +443,7 @@ void WaveGraphWidget::updateCursor(int x)
     // Update cursor iterator
     cursor = pixPosToIterator( x );
 
-    if ( cursor != dataQueue.end() ) {
+    if ( cursor != dataQueue->end() ) {
         // 追い越せない
         if ( rightCursorForceBig && validRightCursor ) {
             if ( (*rightCursor)[0] < (*cursor)[0] ) {
@@ -376,6 +454,10 @@ void WaveGraphWidget::updateCursor(int x)
         validCursor = true;
 
         emit moveCursor( QPair<int, QVector<double> >( getCurrentPixXFromRawX( (*cursor)[0] ), *cursor ) );
+
+        if ( validRightCursor ) {
+            emit cursorSpanChanged();
+        }
     } else {
         validCursor = false;
     }
@@ -386,7 +468,7 @@ void WaveGraphWidget::updateRightCursor(int x)
     // Update right cursor iterator
     rightCursor = pixPosToIterator( x );
 
-    if ( rightCursor != dataQueue.end() ) {
+    if ( rightCursor != dataQueue->end() ) {
         // 追い越せない
         if ( rightCursorForceBig && validCursor ) {
             if ( (*rightCursor)[0] < (*cursor)[0] ) {
@@ -397,6 +479,10 @@ void WaveGraphWidget::updateRightCursor(int x)
         validRightCursor = true;
 
         emit moveRightCursor( QPair<int, QVector<double> >( getCurrentPixXFromRawX( (*rightCursor)[0] ), *rightCursor ) );
+
+        if ( validCursor ) {
+            emit cursorSpanChanged();
+        }
     } else {
         validRightCursor = false;
     }
@@ -405,7 +491,7 @@ void WaveGraphWidget::updateRightCursor(int x)
 int WaveGraphWidget::getCurrentPixXFromRawX(double x)
 {
     // Calculate display pix x from raw x
-    if ( dataQueue.size() == 0 ) return 0;
+    if ( dataQueue->size() == 0 ) return 0;
 
     double headX = (*head)[0];
 
@@ -416,7 +502,7 @@ void WaveGraphWidget::emitHeadChanged(bool indexOnly)
 {
     // indexOnly option is needed to prevent signal/slot loop
 
-    if ( dataQueue.size() > 0 ) {
+    if ( dataQueue->size() > 0 ) {
         emit headChanged( headIndex );
 
         if ( !indexOnly ) {
@@ -433,7 +519,7 @@ void WaveGraphWidget::setHead(DataQueue::iterator head, int headIndex, bool over
     this->head = head;
     this->headIndex = headIndex;
 
-    if ( overwriteRequest && dataQueue.size() > 0 && head != dataQueue.end() && head->size() > 0 ) {
+    if ( overwriteRequest && dataQueue->size() > 0 && head != dataQueue->end() && head->size() > 0 ) {
         requestRawX = (*head)[0];
     }
 }
@@ -521,18 +607,18 @@ void WaveGraphWidget::clear()
 
 double WaveGraphWidget::getStartRawX()
 {
-    if ( !dataQueue.size() ) return -1;
-    if ( !dataQueue.begin()->size() ) return -1;
+    if ( !dataQueue->size() ) return -1;
+    if ( !dataQueue->begin()->size() ) return -1;
 
-    return (*dataQueue.begin())[0];
+    return (*dataQueue->begin())[0];
 }
 
 double WaveGraphWidget::getEndRawX()
 {
-    if ( !dataQueue.size() ) return -1;
-    if ( !( dataQueue.end() - 1 )->size() ) return -1;
+    if ( !dataQueue->size() ) return -1;
+    if ( !( dataQueue->end() - 1 )->size() ) return -1;
 
-    return ( *( dataQueue.end() - 1 ) )[0];
+    return ( *( dataQueue->end() - 1 ) )[0];
 }
 
 bool WaveGraphWidget::getValidRightCursor() const
@@ -574,6 +660,32 @@ void WaveGraphWidget::setQueueDataFromList(QList<QVector<double> > &data, double
     moveHeadToHead( true, true );
 }
 
+void WaveGraphWidget::setQueueDataFromArray(const qint32 *values, int rowCount, int columnCount)
+{
+    // Bulk load of row major values, x is row index and view is updated once
+    clearQueue();
+
+    if ( rowCount <= 0 || columnCount <= 0 ) {
+        return;
+    }
+
+    // Capacity grows only while loading, so every row is kept until next live append trims to live capacity
+    int capacity = store->getCapacity();
+
+    setUpSize( columnCount, qMax( capacity, rowCount ) );
+
+    bool defaultUpdate = defaultHeadUpdate;
+
+    defaultHeadUpdate = false;
+    store->appendArray( values, rowCount, columnCount );
+    defaultHeadUpdate = defaultUpdate;
+
+    store->setCapacity( capacity );
+
+    moveHeadToHead( true, true );
+    update();
+}
+
 QPair<int, QVector<double> > WaveGraphWidget::getShiftedCursorValue(int shift, bool forceShift)
 {
     // 現在のカーソル位置から、指定数ずらした位置の値を取得
@@ -592,7 +704,7 @@ QPair<int, QVector<double> > WaveGraphWidget::getShiftedCursorValue(int shift, b
         for ( int i = 0; i < shift; i++ ) {
             ++c;
 
-            if ( c == dataQueue.end() ) {
+            if ( c == dataQueue->end() ) {
                 over = true;
                 --c;
                 break;
@@ -600,7 +712,7 @@ QPair<int, QVector<double> > WaveGraphWidget::getShiftedCursorValue(int shift, b
         }
     } else {
         for ( int i = 0; i < qAbs( shift ); i++ ) {
-            if ( c == dataQueue.begin() ) {
+            if ( c == dataQueue->begin() ) {
                 over = true;
                 break;
             }
@@ -634,12 +746,8 @@ void WaveGraphWidget::setDefaultFontSize(int value)
 
 void WaveGraphWidget::clearQueue()
 {
-    // Clear queue data
-    resetIterator();
-
-    dataQueue.clear();
-
-    update();
+    // Clear queue data, views sharing store are reset by its signal
+    store->clear();
 }
 int WaveGraphWidget::getLegendFontSize() const
 {
@@ -684,13 +792,23 @@ QPair<int, QVector<double> > WaveGraphWidget::getRightCursorValue()
 QPair<int, QVector<double> > WaveGraphWidget::getHeadValue()
 {
     // ヘッドイテレータの値取得
-    if ( dataQueue.count() > 0 ) {
+    if ( dataQueue->count() > 0 ) {
         return QPair<int, QVector<double> >( getCurrentPixXFromRawX( (*head)[0] ), *head );
     } else {
         return QPair<int, QVector<double> >( -1, QVector< double >() );
     }
 }
 
+bool WaveGraphWidget::getCursorSpanStatistics(SpanStatistics &stat)
+{
+    // Statistics between cursor and right cursor, O(1) by prefix sums
+    if ( !validCursor || !validRightCursor ) {
+        return false;
+    }
+
+    return dataQueue->getSpanStatistics( cursor, rightCursor, stat );
+}
+
 QString WaveGraphWidget::getXName() const
 {
     return xName;
@@ -730,8 +848,8 @@ int WaveGraphWidget::getHeadIndex() const
 void WaveGraphWidget::setHeadIndex(int value)
 {
     // Set head index and iterator
-    if ( dataQueue.size() == 0 ) {
-        setHead( dataQueue.end(), 0 );
+    if ( dataQueue->size() == 0 ) {
+        setHead( dataQueue->end(), 0 );
 
         return;
     }
@@ -742,8 +860,8 @@ void WaveGraphWidget::setHeadIndex(int value)
 
     if ( value < 0 ) {
         value = 0;
-    } else if ( value >= dataQueue.size() ) {
-        value = dataQueue.size() - 1;
+    } else if ( value >= dataQueue->size() ) {
+        value = dataQueue->size() - 1;
     }
 
     int diff = value - headIndex;
@@ -759,7 +877,7 @@ void WaveGraphWidget::setHeadIndex(int value)
 void WaveGraphWidget::setHeadFromRawX(double x, const MoveMode mode, bool emitChanged, bool owReq)
 {
     // Move head to real x nearest iterator
-    if ( dataQueue.size() == 0 ) return;
+    if ( dataQueue->size() == 0 ) return;
 
     double headX = (*head)[0];
 
@@ -784,7 +902,7 @@ void WaveGraphWidget::setHeadFromRawX(double x, const MoveMode mode, bool emitCh
     int diff = 0;
 
     if ( headX < x ) {
-        for ( newHead = head; newHead != dataQueue.end(); newHead++, diff++ ) {
+        for ( newHead = head; newHead != dataQueue->end(); newHead++, diff++ ) {
             double newHeadX = (*newHead)[0];
 
             // Nearet values are found
@@ -819,8 +937,8 @@ void WaveGraphWidget::setHeadFromRawX(double x, const MoveMode mode, bool emitCh
         }
 
         // reach the end of loop
-        if ( newHead == dataQueue.end() ) {
-            setHead( dataQueue.end() - 1, dataQueue.count() - 1, owReq );
+        if ( newHead == dataQueue->end() ) {
+            setHead( dataQueue->end() - 1, dataQueue->count() - 1, owReq );
 
             updated = true;
         }
@@ -856,7 +974,7 @@ void WaveGraphWidget::setHeadFromRawX(double x, const MoveMode mode, bool emitCh
             }
 
             // end check
-            if ( newHead == dataQueue.begin() ) {
+            if ( newHead == dataQueue->begin() ) {
                 break;
             }
 
@@ -865,8 +983,8 @@ void WaveGraphWidget::setHeadFromRawX(double x, const MoveMode mode, bool emitCh
         }
 
         // reach the end of loop
-        if ( newHead == dataQueue.begin() && updated == false ) {
-            setHead( dataQueue.begin(), 0, owReq );
+        if ( newHead == dataQueue->begin() && updated == false ) {
+            setHead( dataQueue->begin(), 0, owReq );
 
             updated = true;
         }
@@ -889,7 +1007,7 @@ void WaveGraphWidget::setHeadFromRawXSmallForce(double x)
 
 int WaveGraphWidget::getQueueSize()
 {
-    return dataQueue.size();
+    return dataQueue->size();
 }
 
 int WaveGraphWidget::getCursorWidth() const
@@ -905,13 +1023,13 @@ void WaveGraphWidget::setCursorWidth(int value)
 void WaveGraphWidget::clearCursor()
 {
     validCursor = false;
-    cursor = dataQueue.end();
+    cursor = dataQueue->end();
 }
 
 void WaveGraphWidget::clearRightCursor()
 {
     validRightCursor = false;
-    rightCursor = dataQueue.end();
+    rightCursor = dataQueue->end();
 }
 
 QColor WaveGraphWidget::getRightCursorColor() const
@@ -956,6 +1074,12 @@ void WaveGraphWidget::setShowCursor(bool value)
 
 void WaveGraphWidget::paintEvent(QPaintEvent *)
 {
+    TRACE_SCOPE( "paintEvent" );
+    MetricTimer frameTimer( Metrics::graphFrameTime );
+
+    // Readers in other threads would decode into the same block cache
+    QMutexLocker locker( store->getMutex() );
+
     // draw
     QPainter p( this );
     QPen pen;
@@ -1000,7 +1124,7 @@ void WaveGraphWidget::paintEvent(QPaintEvent *)
     }
 
     // Check available
-    if ( dataQueue.size() < 2 ) {
+    if ( dataQueue->size() < 2 ) {
         return;
     }
 
@@ -1044,7 +1168,7 @@ void WaveGraphWidget::paintEvent(QPaintEvent *)
             }
         }
 
-        if ( it == dataQueue.begin() ) {
+        if ( it == dataQueue->begin() ) {
             // Exit
             break;
         } else {
@@ -1053,11 +1177,19 @@ void WaveGraphWidget::paintEvent(QPaintEvent *)
         }
     }
 
+    // Derived channels of drawn rows
+    if ( !derivedChannels.isEmpty() ) {
+        appendDerivedColumns( drawQueue, minRawY, maxRawY );
+    }
+
+    int firstColumn = showRawChannels || derivedChannels.isEmpty() ? 0 : columnCount;
+    int drawColumnCount = columnCount + derivedChannels.size();
+
     // deceide local min max
-    localMinY = minRawY[1];
-    localMaxY = maxRawY[1];
+    localMinY = minRawY[1 + firstColumn];
+    localMaxY = maxRawY[1 + firstColumn];
 
-    for ( int i = 1; i < minRawY.size(); i++ ) {
+    for ( int i = 1 + firstColumn; i < minRawY.size(); i++ ) {
         if ( localMinY > minRawY[i] ) {
             localMinY = minRawY[i];
         }
@@ -1201,7 +1333,7 @@ void WaveGraphWidget::paintEvent(QPaintEvent *)
     // Use AA
     // p.setRenderHint( QPainter::Antialiasing );
 
-    for ( int col = 0; col < columnCount; col++ ) {
+    for ( int col = 0; col < drawColumnCount; col++ ) {
         polygonList << QPolygon();
     }
 
@@ -1209,8 +1341,14 @@ void WaveGraphWidget::paintEvent(QPaintEvent *)
         auto now = drawQueue[i];
 
         // all column
-        for ( int col = 0; col < columnCount; col++ ) {
+        for ( int col = firstColumn; col < drawColumnCount; col++ ) {
             double nowY = now.second[1 + col];
+
+            // Derived value such as a ratio of zero counts
+            if ( !qIsFinite( nowY ) ) {
+                continue;
+            }
+
             double topY;
             double bottomY;
 
@@ -1235,8 +1373,8 @@ void WaveGraphWidget::paintEvent(QPaintEvent *)
         }
     }
 
-    for ( int col = 0; col < columnCount; col++ ) {
-        pen.setColor( colors[col] );
+    for ( int col = firstColumn; col < drawColumnCount; col++ ) {
+        pen.setColor( columnColor( col ) );
         pen.setWidth( 1 );
         p.setPen( pen );
         p.drawPolyline( polygonList[col] );
@@ -1277,26 +1415,27 @@ void WaveGraphWidget::paintEvent(QPaintEvent *)
     font.setPixelSize( legendFontSize );
     p.setFont( font );
 
-    for ( int col = 0; col < columnCount; col++ ) {
+    for ( int col = firstColumn; col < drawColumnCount; col++ ) {
         // Create str
-        QString str = names[col];
+        QString str = columnName( col );
+        int line = col - firstColumn;
 
         if ( showHeadValue ) {
-            str = str + " : " + QString::number( (*head)[col + 1], 'f' );
+            str = str + " : " + QString::number( drawQueue.first().second[col + 1], 'f' );
         }
 
         QRect fr = p.fontMetrics().boundingRect( str );
 
-        p.fillRect( legendOffsetX, legendOffsetY + col * fr.height(), fr.width() + legendLineLength + 5, fr.height(), QColor( 255, 255, 255, 200 ) );
+        p.fillRect( legendOffsetX, legendOffsetY + line * fr.height(), fr.width() + legendLineLength + 5, fr.height(), QColor( 255, 255, 255, 200 ) );
 
-        pen.setColor( colors[col] );
+        pen.setColor( columnColor( col ) );
         pen.setWidth( legendLineWidth );
         p.setPen( pen );
-        p.drawLine( legendOffsetX, legendOffsetY + col * fr.height() + fr.height() / 2, legendOffsetX + legendLineLength, legendOffsetY + col * fr.height() + fr.height() / 2 );
+        p.drawLine( legendOffsetX, legendOffsetY + line * fr.height() + fr.height() / 2, legendOffsetX + legendLineLength, legendOffsetY + line * fr.height() + fr.height() / 2 );
 
         pen.setColor( Qt::black );
         p.setPen( pen );
-        p.drawText( QRectF( legendOffsetX + legendLineLength + 5, legendOffsetY + col * fr.height(), fr.width() + 5, fr.height() + 5 ), str );
+        p.drawText( QRectF( legendOffsetX + legendLineLength + 5, legendOffsetY + line * fr.height(), fr.width() + 5, fr.height() + 5 ), str );
     }
 
     // Draw cursor
@@ -1387,3 +1526,104 @@ void WaveGraphWidget::mousePressEvent(QMouseEvent *event)
         update();
     }
 }
+
+QList<ChannelExpression> WaveGraphWidget::getDerivedChannels() const
+{
+    return derivedChannels;
+}
+
+void WaveGraphWidget::setDerivedChannels(const QList<ChannelExpression> &value)
+{
+    derivedChannels = value;
+}
+
+bool WaveGraphWidget::getShowRawChannels() const
+{
+    return showRawChannels;
+}
+
+void WaveGraphWidget::setShowRawChannels(bool value)
+{
+    showRawChannels = value;
+}
+
+void WaveGraphWidget::appendDerivedColumns(QQueue<QPair<int, QVector<double> > > &drawQueue, QList<double> &minRawY, QList<double> &maxRawY)
+{
+    // Drawn rows are gathered column wise, so each expression runs over contiguous blocks
+    int rowCount = drawQueue.size();
+    QVector<double> inputs( columnCount * rowCount );
+    QVector<const double *> inputPointers( columnCount );
+    QVector<double> output( rowCount );
+
+    // Derived values go right after columns of this graph, whatever width rows have
+    for ( int i = 0; i < rowCount; i++ ) {
+        drawQueue[i].second.resize( columnCount + 1 );
+    }
+
+    while ( minRawY.size() > columnCount + 1 ) {
+        minRawY.removeLast();
+        maxRawY.removeLast();
+    }
+
+    while ( minRawY.size() < columnCount + 1 ) {
+        minRawY << 0;
+        maxRawY << 0;
+    }
+
+    for ( int col = 0; col < columnCount; col++ ) {
+        double *column = inputs.data() + col * rowCount;
+
+        for ( int i = 0; i < rowCount; i++ ) {
+            column[i] = drawQueue[i].second[col + 1];
+        }
+
+        inputPointers[col] = column;
+    }
+
+    for ( const ChannelExpression &expression : derivedChannels ) {
+        double minY = qInf();
+        double maxY = -qInf();
+
+        // Expression over channels this graph does not have is left undrawn
+        if ( expression.getInputCount() <= columnCount ) {
+            expression.evaluate( inputPointers.constData(), rowCount, output.data() );
+        } else {
+            output.fill( qQNaN() );
+        }
+
+        for ( int i = 0; i < rowCount; i++ ) {
+            double y = output[i];
+
+            drawQueue[i].second.append( y );
+
+            if ( qIsFinite( y ) ) {
+                minY = qMin( minY, y );
+                maxY = qMax( maxY, y );
+            }
+        }
+
+        minRawY << ( qIsFinite( minY ) ? minY : 0 );
+        maxRawY << ( qIsFinite( maxY ) ? maxY : 0 );
+    }
+}
+
+QColor WaveGraphWidget::columnColor(int col) const
+{
+    // Derived columns take colors after raw ones, then a fixed palette
+    static const QList<QColor> palette = QList<QColor>() << Qt::magenta << Qt::darkCyan << Qt::darkYellow << Qt::black << Qt::darkMagenta;
+
+    if ( col < colors.size() ) {
+        return colors[col];
+    }
+
+    return palette[( col - columnCount ) % palette.size()];
+}
+
+QString WaveGraphWidget::columnName(int col) const
+{
+    if ( col < columnCount ) {
+        return names[col];
+    }
+
+    return derivedChannels[col - columnCount].getName();
+}
@@ -9,8 +9,13 @@
 #include <QPair>
 #include <QPolygonF>
 #include <QMouseEvent>
-#include <QLinkedList>
 #include <QDebug>
+#include <QSharedPointer>
+#include <QtNumeric>
+
+#include "wavedataqueue.h"
+#include "wavedatastore.h"
+#include "channelexpression.h"
 
 class WaveGraphWidget : public QWidget
 {
@@ -18,6 +23,7 @@ class WaveGraphWidget : public QWidget
 
 public:
     typedef QPair<QVector<double>, QColor> ColorFilter;
+    typedef WaveDataQueue::SpanStatistics SpanStatistics;
     typedef enum  {
         Nearest,
         SmallNearest,
@@ -25,7 +31,7 @@ public:
     } MoveMode;
 
 private:
-    typedef QLinkedList<QVector<double> > DataQueue;
+    typedef WaveDataQueue DataQueue;
 
 public:
     explicit WaveGraphWidget(QWidget *parent = 0);
@@ -86,12 +92,21 @@ public:
     QPair<int, QVector<double> > getCursorValue();
     QPair<int, QVector<double> > getRightCursorValue();
     QPair<int, QVector<double> > getHeadValue();
+    bool getCursorSpanStatistics( SpanStatistics &stat );
+
+    QSharedPointer<WaveDataStore> getDataStore() const;
+    void setDataStore( QSharedPointer<WaveDataStore> value );
+
+    bool setPageFile( const QString &filePath );
+    bool isPaged() const;
+    qint64 getPagedBytes() const;
     int getLegendFontSize() const;
     void setLegendFontSize(int value);
     int getDefaultFontSize() const;
     void setDefaultFontSize(int value);
     bool getDefaultHeadUpdate() const;
     void setQueueDataFromList(QList<QVector<double> > &data , double xUnit);
+    void setQueueDataFromArray( const qint32 *values, int rowCount, int columnCount );
     QPair<int, QVector<double> > getShiftedCursorValue(int shift , bool forceShift);
     bool getValidCursor() const;
     bool getValidRightCursor() const;
@@ -117,6 +132,11 @@ public:
     int getYGridCount() const;
     void setYGridCount(int value);
 
+    QList<ChannelExpression> getDerivedChannels() const;
+    void setDerivedChannels(const QList<ChannelExpression> &value);
+    bool getShowRawChannels() const;
+    void setShowRawChannels(bool value);
+
 private:
     DataQueue::iterator pixPosToIterator( int x );
     void resetIterator();
@@ -126,6 +146,9 @@ private:
     void emitHeadChanged( bool indexOnly = false );
     void setHead( DataQueue::iterator head, int headIndex, bool overwriteRequest = true );
     void setHead( int headIndex );
+    void appendDerivedColumns( QQueue<QPair<int, QVector<double> > > &drawQueue, QList<double> &minRawY, QList<double> &maxRawY );
+    QColor columnColor( int col ) const;
+    QString columnName( int col ) const;
 
 private:
     QColor bgColor;
@@ -150,7 +173,9 @@ private:
     QList<QColor> colors;
     QList<QString> names;
     QString xName;
-    DataQueue dataQueue;
+    // Rows are shared with other views of the store, iterators below are this view's own
+    QSharedPointer<WaveDataStore> store;
+    DataQueue *dataQueue;
 
     DataQueue::iterator head;
     DataQueue::iterator cursor;
@@ -190,16 +215,20 @@ private:
 
     double requestRawX;
 
-    int queueSize;
     int columnCount;
 
     int yGridCount;
 
     QList<ColorFilter> colorFilterList;
 
+    // Extra columns computed from drawn rows only, after raw columns
+    QList<ChannelExpression> derivedChannels;
+    bool showRawChannels;
+
 signals:
     void moveCursor( QPair<int, QVector<double> > );
     void moveRightCursor( QPair<int, QVector<double> > );
+    void cursorSpanChanged();
     void headChanged( int index );
     void headChanged( double rawX );
     void queueSizeChanged( int size );
@@ -218,6 +247,10 @@ public slots:
     void setXScale(int value);
     void moveHeadToHead(bool emitSignal , bool indexOnly);
 
+private slots:
+    void storeRowsChanged( int appendedCount, int removedCount );
+    void storeCleared();
+
     // QWidget interface
 protected:
     virtual void paintEvent(QPaintEvent *);
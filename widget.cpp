@@ -1,23 +1,89 @@
 #include "widget.h"
 #include "ui_widget.h"
+#include "tracer.h"
+#include "metrics.h"
 
 Widget::Widget(QWidget *parent) :
     QWidget(parent),
-    ui(new Ui::Widget)
+    ui(new Ui::Widget),
+    previewPixmapIndex( 0 ),
+    previewColor( 0 ),
+    previewValid( false ),
+    hdrCycleRate( 0 ),
+    latencyCount( 0 ),
+    latencySum( 0 ),
+    latencyMax( 0 )
 {
+    lastMatch.index = -1;
+    lastMatch.deltaE = 0;
+
     ui->setupUi(this);
 
+    // Thread names are shown as trace tracks
+    sensorThread.setObjectName( "Sensor" );
+    recorderThread.setObjectName( "Recorder" );
+    importThread.setObjectName( "Import" );
+    replayThread.setObjectName( "Replay" );
+    streamThread.setObjectName( "Stream" );
+    remoteThread.setObjectName( "Remote" );
+
     // Construct and move to worker thread a sensor accessor class
     colorSensor = new ColorSensorAccess;
     colorSensor->moveToThread( &sensorThread );
     sensorThread.start();
 
+    // Construct and move to worker thread a recorder, fsync must not block GUI
+    recorder = new SampleRecorder;
+    recorder->moveToThread( &recorderThread );
+    recorderThread.start();
+
+    // CSV import runs its own thread pool, coordinator stays off GUI thread
+    importer = new CsvImporter;
+    importer->moveToThread( &importThread );
+    importThread.start();
+    importing = false;
+
+    // Replay source has its own thread, live sensor stays usable
+    replaySensor = new ReplaySensor;
+    replaySensor->moveToThread( &replayThread );
+    replayThread.start();
+
+    // Stream server and client keep their sockets in own threads
+    streamServer = new StreamServer;
+    streamServer->moveToThread( &streamThread );
+    streamThread.start();
+
+    streamClient = new StreamClient;
+    streamClient->moveToThread( &remoteThread );
+    remoteThread.start();
+
     // Connect signals
     qRegisterMetaType<ColorSensorAccess::ColorData>();
+    qRegisterMetaType<QVector<ColorSensorAccess::ColorData> >();
+    qRegisterMetaType<ColorSensorAccess::HdrData>();
 
     connect( this, SIGNAL(doReading(bool)), colorSensor, SLOT(startReading(bool)) );
     connect( this, SIGNAL(stopReading()), colorSensor, SLOT(stopReading()), Qt::DirectConnection );
-    connect( colorSensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), this, SLOT(setData(ColorSensorAccess::ColorData)) );
+    connect( this, SIGNAL(stopReading()), replaySensor, SLOT(stopReading()), Qt::DirectConnection );
+    connect( colorSensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), recorder, SLOT(appendData(ColorSensorAccess::ColorData)) );
+    connect( recorder, SIGNAL(writeFailed(QString)), this, SLOT(recorderWriteFailed(QString)) );
+    connect( replaySensor, SIGNAL(replayFinished()), this, SLOT(replayFinished()) );
+    connect( colorSensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), streamServer, SLOT(appendData(ColorSensorAccess::ColorData)) );
+    connect( replaySensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), streamServer, SLOT(appendData(ColorSensorAccess::ColorData)) );
+    connect( streamClient, SIGNAL(connectionChanged(bool)), this, SLOT(remoteConnectionChanged(bool)) );
+    connect( streamClient, SIGNAL(connectFailed(QString)), this, SLOT(remoteConnectFailed(QString)) );
+
+    connectSensor( colorSensor );
+    connectSensor( replaySensor );
+    connectSensor( streamClient );
+
+    ui->replaySpeedComboBox->addItem( "Original", 1.0 );
+    ui->replaySpeedComboBox->addItem( "2x", 2.0 );
+    ui->replaySpeedComboBox->addItem( "10x", 10.0 );
+    ui->replaySpeedComboBox->addItem( "100x", 100.0 );
+    ui->replaySpeedComboBox->addItem( "Max", 0.0 );
+
+    ui->hdrExposureEdit->setText( colorSensor->getHdrExposures() );
 
     // Setup button groups
     intTimeGroup.addButton( ui->intTime0Button, ColorSensorAccess::T00 );
@@ -36,6 +102,7 @@ Widget::Widget(QWidget *parent) :
     ui->graphWidget->wave->setLegendFontSize( 12 );
     ui->graphWidget->wave->setDefaultFontSize( 12 );
     ui->graphWidget->wave->setShowCursor( true );
+    ui->graphWidget->wave->setShowRightCursor( true );
     ui->graphWidget->wave->setXName( "" );
     ui->graphWidget->wave->setForceRequestedRawX( true );
     ui->graphWidget->wave->setUpSize( 4, 10000 );
@@ -47,9 +114,147 @@ Widget::Widget(QWidget *parent) :
     ui->graphWidget->wave->setNames( QStringList() << "B" << "G" << "R" << "IR" );
     ui->graphWidget->wave->setColors( QList<QColor>() << Qt::blue << Qt::darkGreen << Qt::red << Qt::darkRed );
 
+    // Detail pane reads rows of RAW graph, only its head, zoom and cursors are its own
+    ui->detailGraphWidget->setLabel( tr( "Detail" ) );
+    ui->detailGraphWidget->wave->setDataStore( ui->graphWidget->wave->getDataStore() );
+    ui->detailGraphWidget->wave->setMinimumSize( 0, 0 );
+    ui->detailGraphWidget->wave->setXScale( 100 );
+    ui->detailGraphWidget->wave->setXGrid( 1 );
+    ui->detailGraphWidget->wave->setLegendFontSize( 12 );
+    ui->detailGraphWidget->wave->setDefaultFontSize( 12 );
+    ui->detailGraphWidget->wave->setShowCursor( true );
+    ui->detailGraphWidget->wave->setXName( "" );
+    ui->detailGraphWidget->wave->setUpSize( 4, ui->graphWidget->wave->getDataStore()->getCapacity() );
+    ui->detailGraphWidget->wave->setYGridCount( 2 );
+    ui->detailGraphWidget->wave->setAutoUpdateYMax( true );
+    ui->detailGraphWidget->wave->setYMin( 0 );
+    ui->detailGraphWidget->wave->setNames( ui->graphWidget->wave->getNames() );
+    ui->detailGraphWidget->wave->setColors( ui->graphWidget->wave->getColors() );
+    ui->detailGraphWidget->setVisible( false );
+
+    // Initialize log view, rows have fixed height so layout cost does not depend on log length
+    ui->logView->setModel( &logModel );
+    ui->logView->verticalHeader()->setSectionResizeMode( QHeaderView::Fixed );
+    ui->logView->verticalHeader()->setDefaultSectionSize( ui->logView->fontMetrics().height() + 4 );
+    ui->logView->horizontalHeader()->setSectionResizeMode( QHeaderView::Stretch );
+
+    connect( &logModel, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(scrollLogToBottom()) );
+
+    // Throttle color preview to display frame rate
+    previewTimer.setSingleShot( true );
+    previewTimer.setInterval( 16 );
+
+    connect( &previewTimer, SIGNAL(timeout()), this, SLOT(updateColorLabel()) );
+
+    // Rolling statistics, panel is refreshed by timer
+    ui->statsTable->setRowCount( RollingStatistics::ChannelCount );
+    ui->statsTable->setColumnCount( 6 );
+    ui->statsTable->setVerticalHeaderLabels( QStringList() << "B" << "G" << "R" << "IR" );
+    ui->statsTable->setHorizontalHeaderLabels( QStringList() << "Mean" << "SD" << "Min" << "Max" << "CV[%]" << "N" );
+    ui->statsTable->horizontalHeader()->setSectionResizeMode( QHeaderView::Stretch );
+
+    for ( int row = 0; row < RollingStatistics::ChannelCount; row++ ) {
+        for ( int col = 0; col < 6; col++ ) {
+            ui->statsTable->setItem( row, col, new QTableWidgetItem() );
+        }
+    }
+
+    statisticsTimer.setInterval( 200 );
+    statisticsTimer.start();
+
+    connect( &statisticsTimer, SIGNAL(timeout()), this, SLOT(updateStatisticsPanel()) );
+
+    connect( ui->graphWidget->wave, SIGNAL(cursorSpanChanged()), this, SLOT(updateSpanLabel()) );
+
+    // Spectrum analysis of each channel
+    ui->spectrumWidget->setLabel( tr( "Amplitude spectrum" ) );
+    ui->spectrumWidget->wave->setMinimumSize( 0, 0 );
+    ui->spectrumWidget->wave->setLegendFontSize( 12 );
+    ui->spectrumWidget->wave->setDefaultFontSize( 12 );
+    ui->spectrumWidget->wave->setXName( "Hz" );
+    ui->spectrumWidget->wave->setYGridCount( 2 );
+    ui->spectrumWidget->wave->setAutoUpdateYMax( true );
+    ui->spectrumWidget->wave->setYMin( 0 );
+    ui->spectrumWidget->wave->setUpSize( 4, 1 );
+    ui->spectrumWidget->wave->setNames( QStringList() << "B" << "G" << "R" << "IR" );
+    ui->spectrumWidget->wave->setColors( QList<QColor>() << Qt::blue << Qt::darkGreen << Qt::red << Qt::darkRed );
+
+    // First item would otherwise select its size through auto connected slot
+    {
+        QSignalBlocker blocker( ui->fftSizeComboBox );
+
+        for ( int size = 64; size <= 4096; size *= 2 ) {
+            ui->fftSizeComboBox->addItem( QString::number( size ), size );
+        }
+
+        ui->fftSizeComboBox->setCurrentIndex( ui->fftSizeComboBox->findData( spectrumAnalyzer.getFftSize() ) );
+    }
+
+    connect( &spectrumAnalyzer, SIGNAL(spectrumUpdated()), this, SLOT(updateSpectrumView()) );
+
+    // Trigger and capture window view
+    ui->captureWidget->setLabel( tr( "Capture window" ) );
+    ui->captureWidget->wave->setMinimumSize( 0, 0 );
+    ui->captureWidget->wave->setLegendFontSize( 12 );
+    ui->captureWidget->wave->setDefaultFontSize( 12 );
+    ui->captureWidget->wave->setXName( "" );
+    ui->captureWidget->wave->setYGridCount( 2 );
+    ui->captureWidget->wave->setAutoUpdateYMax( true );
+    ui->captureWidget->wave->setYMin( 0 );
+    ui->captureWidget->wave->setUpSize( 4, 1 );
+    ui->captureWidget->wave->setNames( QStringList() << "B" << "G" << "R" << "IR" );
+    ui->captureWidget->wave->setColors( QList<QColor>() << Qt::blue << Qt::darkGreen << Qt::red << Qt::darkRed );
+    ui->captureWidget->wave->addColorFilter( -0.5, 0.5, QColor( 255, 0, 0, 60 ) );
+
+    ui->triggerConditionComboBox->addItems( QStringList() << "Threshold" << "Slope" << "dE from baseline" << "Ratio" );
+    ui->triggerChannelComboBox->addItems( QStringList() << "B" << "G" << "R" << "IR" );
+    ui->triggerRatioComboBox->addItems( QStringList() << "B" << "G" << "R" << "IR" );
+    ui->triggerRatioComboBox->setCurrentIndex( 1 );
+    ui->triggerDirectionComboBox->addItems( QStringList() << "Rising" << "Falling" << "Either" );
+
+    trigger.setConverter( &colorConverter );
+
+    connect( &trigger, SIGNAL(captured(QVector<ColorSensorAccess::ColorData>,int,qint64)), this, SLOT(showCapture(QVector<ColorSensorAccess::ColorData>,int,qint64)) );
+
+    // Long term rollups, kept across sessions
+    ui->trendWidget->setLabel( tr( "Trend" ) );
+    ui->trendWidget->wave->setMinimumSize( 0, 0 );
+    ui->trendWidget->wave->setLegendFontSize( 12 );
+    ui->trendWidget->wave->setDefaultFontSize( 12 );
+    ui->trendWidget->wave->setYGridCount( 2 );
+    ui->trendWidget->wave->setAutoUpdateYMax( true );
+    ui->trendWidget->wave->setYMin( 0 );
+    ui->trendWidget->wave->setUpSize( 4, 1 );
+    ui->trendWidget->wave->setNames( QStringList() << "B" << "G" << "R" << "IR" );
+    ui->trendWidget->wave->setColors( QList<QColor>() << Qt::blue << Qt::darkGreen << Qt::red << Qt::darkRed );
+
+    for ( int level = 0; level < RollupStore::LevelCount; level++ ) {
+        ui->trendLevelComboBox->addItem( RollupStore::levelName( level ) );
+    }
+
+    ui->trendLevelComboBox->setCurrentIndex( RollupStore::Minute );
+    ui->trendValueComboBox->addItems( QStringList() << "Mean" << "Min" << "Max" );
+
+    QString dataPath = QStandardPaths::writableLocation( QStandardPaths::AppDataLocation );
+
+    QDir().mkpath( dataPath );
+    rollup.load( dataPath + "/rollup.dat" );
+    rollup.setFilePath( dataPath + "/rollup.dat" );
+
+    connect( colorSensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), &rollup, SLOT(appendData(ColorSensorAccess::ColorData)) );
+    connect( &rollup, SIGNAL(rolledUp(int)), this, SLOT(trendRolledUp(int)) );
+    connect( ui->trendLevelComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(updateTrendView()) );
+    connect( ui->trendValueComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(updateTrendView()) );
+    connect( ui->tabWidget, SIGNAL(currentChanged(int)), this, SLOT(updateTrendView()) );
+
     // Connect spin box's signsls to graph widget
     connect( ui->scaleSpinBox, SIGNAL(valueChanged(int)), this, SLOT(setGraphXScale(int)) );
     connect( ui->gridSpinBox, SIGNAL(valueChanged(int)), this, SLOT(setGraphXSGrid(int)) );
+
+    connect( importer, SIGNAL(progress(qint64,qint64)), this, SLOT(importProgress(qint64,qint64)) );
+    connect( importer, SIGNAL(finished(bool)), this, SLOT(importFinished(bool)) );
+
+    ui->importProgressBar->setVisible( false );
 }
 
 Widget::~Widget()
@@ -60,26 +265,71 @@ Widget::~Widget()
     sensorThread.quit();
     sensorThread.wait( 3000 );
 
+    // Flush and stop a recorder thread
+    QMetaObject::invokeMethod( recorder, "closeFile", Qt::BlockingQueuedConnection );
+    recorderThread.quit();
+    recorderThread.wait( 3000 );
+
+    // Stop running import
+    importer->cancel();
+    importThread.quit();
+    importThread.wait();
+
+    // Stop replay
+    replaySensor->stopReading();
+    replayThread.quit();
+    replayThread.wait( 3000 );
+
+    // Drop subscribers and remote connection
+    QMetaObject::invokeMethod( streamServer, "close", Qt::BlockingQueuedConnection );
+    streamThread.quit();
+    streamThread.wait( 3000 );
+
+    QMetaObject::invokeMethod( streamClient, "disconnectFromServer", Qt::BlockingQueuedConnection );
+    remoteThread.quit();
+    remoteThread.wait( 3000 );
+
+    rollup.saveFile();
+
+    delete streamClient;
+    delete streamServer;
+    delete replaySensor;
+    delete importer;
+    delete recorder;
     delete ui;
 }
 
 void Widget::setData(ColorSensorAccess::ColorData data)
 {
+    TRACE_SPAN( "delivery", data.timestamp );
+    TRACE_SCOPE( "setData" );
+
+    // Source to GUI latency, samples are stamped when emitted
+    qint64 latency = ColorSensorAccess::timestampNow() - data.timestamp;
+
+    latencyCount++;
+    latencySum += latency;
+    latencyMax = qMax( latencyMax, latency );
+
+    Metrics::samplesDelivered.add();
+    Metrics::deliveryLatency.observe( latency );
+
     // Fill label
     setColorLabel(data);
 
-    // Add comma separated value into edit
-    QString str = QString( "%1,%2,%3,%4" ).arg( data.blue ).arg( data.green ).arg( data.red ).arg( data.infraRed );
-
-    ui->logEdit->appendPlainText( str );
-    ui->logEdit->ensureCursorVisible();
+    // Add sample into log, rows are inserted in batches
+    logModel.appendData( data );
 
-    // Push data to graph
-    setDataToGraph( data );
+    // Push data to graph, merged sample of HDR sweep is plotted instead of its exposures
+    if ( sender() != colorSensor || !ui->hdrGroupBox->isChecked() ) {
+        setDataToGraph( data );
+    }
 
     // Show last integration time if in manual integration mode
     if ( colorSensor->getManualIntegrationMode() ) {
         ui->intTimeLabel->setText( QString( "Last integration time : %1[ms]" ).arg( colorSensor->getLastElapsedNanosec() / 1000.0 / 1000 ) );
+    } else if ( ui->autoExposureCheckBox->isChecked() ) {
+        ui->intTimeLabel->setText( QString( "Auto range : %1" ).arg( ColorSensorAccess::settingName( data ) ) );
     } else {
         ui->intTimeLabel->setText( "Integration time measuring is not supported" );
     }
@@ -87,9 +337,24 @@ void Widget::setData(ColorSensorAccess::ColorData data)
 
 void Widget::setDataToGraph(ColorSensorAccess::ColorData data)
 {
+    TRACE_SCOPE( "setDataToGraph" );
+
     int id = ui->graphWidget->wave->getQueueSize();
 
     ui->graphWidget->wave->enqueueData( QVector<double>( { (double)id, (double)data.blue, (double)data.green, (double)data.red, (double)data.infraRed } ) );
+
+    Metrics::graphQueueSize.set( ui->graphWidget->wave->getQueueSize() );
+}
+
+void Widget::connectSensor(ColorSensorAccess *sensor)
+{
+    // Consumers shared by live, replayed and remote samples, recorder and rollups take live data only
+    connect( sensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), this, SLOT(setData(ColorSensorAccess::ColorData)) );
+    connect( sensor, SIGNAL(hdrDataRead(ColorSensorAccess::HdrData)), this, SLOT(setHdrData(ColorSensorAccess::HdrData)) );
+    connect( sensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), this, SLOT(captureCalibrationSample(ColorSensorAccess::ColorData)) );
+    connect( sensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), &statistics, SLOT(appendData(ColorSensorAccess::ColorData)) );
+    connect( sensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), &spectrumAnalyzer, SLOT(appendData(ColorSensorAccess::ColorData)) );
+    connect( sensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), &trigger, SLOT(appendData(ColorSensorAccess::ColorData)) );
 }
 
 void Widget::statusMessage(QString str)
@@ -125,41 +390,58 @@ void Widget::enableSensorButtons(bool enable)
 
 void Widget::setColorLabel(ColorSensorAccess::ColorData data)
 {
-    QPixmap map( ui->colorPreviewLabel->size() );
-    QPainter painter( &map );
-    QColor color = data.getColor();
+    TRACE_SCOPE( "setColorLabel" );
 
-    // Set V maximum
-    //color = QColor::fromHsv( color.hsvHue(), color.hsvSaturation(), 255 );
+    // Match every sample against reference library
+    if ( colorLibrary.size() > 0 ) {
+        float lab[3];
 
-    // Calculate display equivalent color
-    double max = 0;
-    double b, g, r, ir;
+        colorConverter.toLab( data, lab );
+        lastMatch = colorLibrary.findNearest( lab );
+    }
 
-    b  = data.blue  * 1.82;
-    g  = data.green * 1.0;
-    r  = data.red   * 1.29;
-    ir = data.infraRed;
+    // Keep only latest sample, label is painted by timer
+    previewData = data;
 
-    if ( b > max ) {
-        max = b;
+    if ( !previewTimer.isActive() ) {
+        previewTimer.start();
     }
-    if ( g > max ) {
-        max = g;
-    }
-    if ( r > max ) {
-        max = r;
+}
+
+void Widget::updateColorLabel()
+{
+    TRACE_SCOPE( "updateColorLabel" );
+
+    const ColorSensorAccess::ColorData &data = previewData;
+
+    // Best match from library
+    if ( lastMatch.index >= 0 ) {
+        ui->matchLabel->setText( QString( "%1\ndE00 : %2" )
+                                 .arg( colorLibrary.getEntries()[lastMatch.index].name )
+                                 .arg( lastMatch.deltaE, 0, 'f', 2 ) );
     }
-    if ( ir > max ) {
-        max = ir;
+
+    // Calculate display equivalent color
+    QColor color = colorConverter.toDisplayColor( data );
+
+    // Skip repaint if nothing visible has changed
+    QSize size = ui->colorPreviewLabel->size();
+    bool sameValue = previewValid &&
+            previewShownData.blue == data.blue && previewShownData.green == data.green &&
+            previewShownData.red == data.red && previewShownData.infraRed == data.infraRed;
+
+    if ( sameValue && previewColor == color.rgb() && previewPixmap[previewPixmapIndex ^ 1].size() == size ) {
+        return;
     }
 
-    // Normalize
-    b = b / max;
-    g = g / max;
-    r = r / max;
+    // Two backing pixmaps are used alternately, the one not held by label can be painted without detach
+    QPixmap &map = previewPixmap[previewPixmapIndex];
+
+    if ( map.size() != size ) {
+        map = QPixmap( size );
+    }
 
-    color = QColor::fromRgbF( r, g, b );
+    QPainter painter( &map );
 
     // Fill by latest color
     painter.fillRect( map.rect(), color );
@@ -168,8 +450,14 @@ void Widget::setColorLabel(ColorSensorAccess::ColorData data)
     QString str = QString( "B:%1 G:%2 R:%3 IR:%4 " ).arg( data.blue ).arg( data.green ).arg( data.red ).arg( data.infraRed );
 
     painter.drawText( map.rect(), Qt::AlignCenter, str );
+    painter.end();
 
     ui->colorPreviewLabel->setPixmap( map );
+
+    previewPixmapIndex ^= 1;
+    previewColor = color.rgb();
+    previewShownData = data;
+    previewValid = true;
 }
 
 void Widget::on_openButton_clicked()
@@ -193,12 +481,14 @@ void Widget::on_initializeButton_clicked()
         return;
     }
 
+    colorConverter.setExposure( (ColorSensorAccess::Gain)gainGroup.checkedId(), (ColorSensorAccess::IntegrationTime)intTimeGroup.checkedId(), ui->intTimeManButton->isChecked(), ui->intTimeSpinBox->value() );
+
     statusMessage( "Initialization is completed" );
 }
 
 void Widget::on_pushButton_7_clicked()
 {
-    ui->logEdit->clear();
+    logModel.clear();
 }
 
 void Widget::on_pushButton_8_clicked()
@@ -213,10 +503,36 @@ void Widget::on_pushButton_8_clicked()
     }
 
     QFile file( ret );
-    file.open( QIODevice::WriteOnly | QIODevice::Text );
+
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+        QMessageBox::critical( this, "Error", "Failed to save log to " + ret + ", " + file.errorString() );
+        return;
+    }
+
+    // Rows still waiting for batch insert are saved too
+    logModel.flush();
 
     QTextStream stream( &file );
-    stream << ui->logEdit->toPlainText();
+    logModel.writeCsv( stream );
+
+    // Derived channels go to own file, so log stays integers and can be loaded into graph
+    if ( derivedChannels.isEmpty() ) {
+        return;
+    }
+
+    QFileInfo info( ret );
+    QString derivedPath = info.path() + "/" + info.completeBaseName() + "_derived.csv";
+    QFile derivedFile( derivedPath );
+
+    if ( !derivedFile.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+        QMessageBox::critical( this, "Error", "Failed to save derived channels to " + derivedPath );
+        return;
+    }
+
+    QTextStream derivedStream( &derivedFile );
+    logModel.writeDerivedCsv( derivedStream, derivedChannels );
+
+    statusMessage( "Derived channels are saved to " + derivedPath );
 }
 
 void Widget::on_readSensorButton_clicked()
@@ -259,3 +575,843 @@ void Widget::on_saveGraphButton_clicked()
 
     ui->graphWidget->wave->grab().save( ret, "PNG" );
 }
+
+void Widget::on_recordButton_toggled(bool checked)
+{
+    if ( !checked ) {
+        // Stop recording and report group commit cost
+        QMetaObject::invokeMethod( recorder, "closeFile", Qt::BlockingQueuedConnection );
+
+        SampleRecorder::Statistics stat = recorder->getStatistics();
+        double sec = stat.elapsedNanosec / 1e9;
+
+        statusMessage( QString( "Recorded %1 samples in %2 chunks, %3 syncs, avg sync %4[ms], max sync %5[ms], %6[samples/s], %7[bytes/sample]" )
+                       .arg( stat.recordCount )
+                       .arg( stat.chunkCount )
+                       .arg( stat.syncCount )
+                       .arg( stat.syncCount ? stat.syncNanosec / 1e6 / stat.syncCount : 0 )
+                       .arg( stat.maxSyncNanosec / 1e6 )
+                       .arg( sec > 0 ? stat.recordCount / sec : 0 )
+                       .arg( stat.recordCount ? (double)stat.bytesWritten / stat.recordCount : 0, 0, 'f', 2 ) );
+
+        ui->syncCountSpinBox->setEnabled( true );
+        ui->syncIntervalSpinBox->setEnabled( true );
+
+        return;
+    }
+
+    // Select record file, existing record is recovered and appended
+    QString ret = QFileDialog::getSaveFileName( this, "Record file", "record.csr", "*.csr", 0, QFileDialog::DontConfirmOverwrite );
+
+    if ( ret == "" ) {
+        ui->recordButton->blockSignals( true );
+        ui->recordButton->setChecked( false );
+        ui->recordButton->blockSignals( false );
+        return;
+    }
+
+    bool ok = false;
+
+    recorder->setSyncRecordCount( ui->syncCountSpinBox->value() );
+    recorder->setSyncInterval( ui->syncIntervalSpinBox->value() );
+
+    QMetaObject::invokeMethod( recorder, "openFile", Qt::BlockingQueuedConnection, Q_RETURN_ARG( bool, ok ), Q_ARG( QString, ret ) );
+
+    if ( !ok ) {
+        QMessageBox::critical( this, "Error", "Failed to open record file, " + recorder->getErrorString() );
+        ui->recordButton->blockSignals( true );
+        ui->recordButton->setChecked( false );
+        ui->recordButton->blockSignals( false );
+        return;
+    }
+
+    ui->syncCountSpinBox->setEnabled( false );
+    ui->syncIntervalSpinBox->setEnabled( false );
+
+    SampleRecorder::RecoveryResult recovery = recorder->getLastRecovery();
+
+    if ( recovery.valid ) {
+        statusMessage( QString( "Recording, recovered %1 samples in %2 chunks, discarded %3 bytes" )
+                       .arg( recovery.recordCount ).arg( recovery.chunkCount ).arg( recovery.discardedBytes ) );
+    } else {
+        statusMessage( "Recording" );
+    }
+}
+
+void Widget::recorderWriteFailed(QString message)
+{
+    // Recorder closed file at last committed chunk
+    SampleRecorder::Statistics stat = recorder->getStatistics();
+
+    ui->recordButton->blockSignals( true );
+    ui->recordButton->setChecked( false );
+    ui->recordButton->blockSignals( false );
+
+    ui->syncCountSpinBox->setEnabled( true );
+    ui->syncIntervalSpinBox->setEnabled( true );
+
+    statusMessage( QString( "Recording stopped, %1 samples saved" ).arg( stat.recordCount ) );
+    QMessageBox::critical( this, "Error", "Failed to write record file, " + message );
+}
+
+void Widget::scrollLogToBottom()
+{
+    // Follow latest row only while view is at bottom
+    QScrollBar *bar = ui->logView->verticalScrollBar();
+
+    if ( bar->value() >= bar->maximum() - 1 ) {
+        ui->logView->scrollToBottom();
+    }
+}
+
+void Widget::on_loadCalibrationButton_clicked()
+{
+    // Load color conversion matrix
+    QString ret = QFileDialog::getOpenFileName( this, "Load calibration", "", "*.ini" );
+
+    if ( ret == "" ) {
+        return;
+    }
+
+    if ( !colorConverter.loadCalibration( ret ) ) {
+        QMessageBox::critical( this, "Error", "Failed to load calibration file" );
+        return;
+    }
+
+    statusMessage( "Calibration is loaded" );
+}
+
+void Widget::updateStatisticsPanel()
+{
+    // Show window statistics
+    QVector<RollingStatistics::ChannelStatistics> stats = statistics.getAllStatistics();
+    double min = 0, max = 0;
+
+    for ( int ch = 0; ch < stats.size(); ch++ ) {
+        const RollingStatistics::ChannelStatistics &stat = stats[ch];
+
+        ui->statsTable->item( ch, 0 )->setText( QString::number( stat.mean, 'f', 2 ) );
+        ui->statsTable->item( ch, 1 )->setText( QString::number( stat.stdDev, 'f', 2 ) );
+        ui->statsTable->item( ch, 2 )->setText( QString::number( stat.min ) );
+        ui->statsTable->item( ch, 3 )->setText( QString::number( stat.max ) );
+        ui->statsTable->item( ch, 4 )->setText( QString::number( stat.cv * 100, 'f', 3 ) );
+        ui->statsTable->item( ch, 5 )->setText( QString::number( stat.count ) );
+
+        if ( ch == 0 || stat.min < min ) {
+            min = stat.min;
+        }
+
+        if ( ch == 0 || stat.max > max ) {
+            max = stat.max;
+        }
+    }
+
+    // Y range of graph follows window extremes
+    if ( ui->statsScaleCheckBox->isChecked() && stats.size() > 0 && stats[0].count > 0 && max > min ) {
+        ui->graphWidget->wave->setYMin( min );
+        ui->graphWidget->wave->setYMax( max );
+        ui->graphWidget->wave->update();
+    }
+}
+
+void Widget::on_statsCountSpinBox_valueChanged(int arg1)
+{
+    statistics.setWindowCount( arg1 );
+}
+
+void Widget::on_statsTimeSpinBox_valueChanged(int arg1)
+{
+    statistics.setWindowTime( arg1 );
+}
+
+void Widget::on_clearStatsButton_clicked()
+{
+    statistics.clear();
+}
+
+void Widget::on_statsScaleCheckBox_toggled(bool checked)
+{
+    // Switch between graph local autoscale and window statistics
+    ui->graphWidget->wave->setAutoUpdateYMax( !checked );
+
+    if ( !checked ) {
+        ui->graphWidget->wave->setYMin( 0 );
+    }
+
+    ui->graphWidget->wave->update();
+}
+
+void Widget::updateSpanLabel()
+{
+    // Show statistics between cursors
+    WaveGraphWidget::SpanStatistics stat;
+
+    if ( !ui->graphWidget->wave->getCursorSpanStatistics( stat ) ) {
+        return;
+    }
+
+    QStringList names = ui->graphWidget->wave->getNames();
+    QString str = QString( "N:%1" ).arg( stat.count );
+
+    for ( int ch = 0; ch < stat.mean.size() && ch < names.size(); ch++ ) {
+        str += QString( "  %1 mean:%2 SD:%3 area:%4" )
+                .arg( names[ch] )
+                .arg( stat.mean[ch], 0, 'f', 1 )
+                .arg( qSqrt( stat.variance[ch] ), 0, 'f', 2 )
+                .arg( stat.integral[ch], 0, 'g', 6 );
+    }
+
+    ui->spanLabel->setText( str );
+}
+
+void Widget::updateSpectrumView()
+{
+    // Show latest spectrum and flicker figures
+    double sampleRate = spectrumAnalyzer.getSampleRate();
+    int bins = spectrumAnalyzer.getFftSize() / 2;
+
+    if ( sampleRate <= 0 ) {
+        return;
+    }
+
+    QList<QVector<double> > rows;
+    QVector<float> spectrum[SpectrumAnalyzer::ChannelCount];
+
+    for ( int ch = 0; ch < SpectrumAnalyzer::ChannelCount; ch++ ) {
+        spectrum[ch] = spectrumAnalyzer.getSpectrum( ch );
+    }
+
+    for ( int k = 0; k < bins; k++ ) {
+        rows.append( QVector<double>( { (double)k, spectrum[0][k], spectrum[1][k], spectrum[2][k], spectrum[3][k] } ) );
+    }
+
+    double binHz = sampleRate / spectrumAnalyzer.getFftSize();
+
+    ui->spectrumWidget->wave->setXScale( (double)ui->spectrumWidget->wave->width() / ( bins * binHz ) );
+    ui->spectrumWidget->wave->setXGrid( qMax( 1.0, bins * binHz / 10 ) );
+    ui->spectrumWidget->wave->setQueueDataFromList( rows, binHz );
+
+    QStringList names = QStringList() << "B" << "G" << "R" << "IR";
+    QString str = QString( "Fs:%1[Hz]" ).arg( sampleRate, 0, 'f', 1 );
+
+    for ( int ch = 0; ch < SpectrumAnalyzer::ChannelCount; ch++ ) {
+        SpectrumAnalyzer::ChannelResult result = spectrumAnalyzer.getResult( ch );
+
+        str += QString( "  %1 %2[Hz] depth:%3[%]" )
+                .arg( names[ch] )
+                .arg( result.dominantFrequency, 0, 'f', 2 )
+                .arg( result.modulationDepth * 100, 0, 'f', 1 );
+    }
+
+    ui->spectrumLabel->setText( str );
+}
+
+void Widget::on_fftSizeComboBox_currentIndexChanged(int index)
+{
+    spectrumAnalyzer.setFftSize( ui->fftSizeComboBox->itemData( index ).toInt() );
+    spectrumAnalyzer.setHopSize( ui->hopSpinBox->value() );
+}
+
+void Widget::on_hopSpinBox_valueChanged(int arg1)
+{
+    spectrumAnalyzer.setHopSize( arg1 );
+}
+
+void Widget::showCapture(QVector<ColorSensorAccess::ColorData> window, int triggerIndex, qint64 latencyNanosec)
+{
+    // Show captured window, x is sample offset from trigger
+    QList<QVector<double> > rows;
+
+    for ( int i = 0; i < window.size(); i++ ) {
+        const ColorSensorAccess::ColorData &data = window[i];
+
+        rows.append( QVector<double>( { (double)( i - triggerIndex ), (double)data.blue, (double)data.green, (double)data.red, (double)data.infraRed } ) );
+    }
+
+    ui->captureWidget->wave->setXScale( qMax( 1.0, (double)ui->captureWidget->wave->width() / qMax( 1, window.size() ) ) );
+    ui->captureWidget->wave->setXGrid( qMax( 1, window.size() / 10 ) );
+    ui->captureWidget->wave->setQueueDataFromList( rows, 1 );
+
+    // Latency of trigger to capture, and of last sample to display
+    ui->triggerLabel->setText( QString( "Captured %1 samples, trigger to capture %2[ms], sample to display %3[ms]" )
+                               .arg( window.size() )
+                               .arg( latencyNanosec / 1e6, 0, 'f', 3 )
+                               .arg( ( ColorSensorAccess::timestampNow() - window.last().timestamp ) / 1e6, 0, 'f', 3 ) );
+}
+
+void Widget::on_armButton_toggled(bool checked)
+{
+    if ( !checked ) {
+        trigger.disarm();
+        ui->triggerLabel->setText( "Trigger is not armed" );
+
+        return;
+    }
+
+    // Apply settings and wait for trigger
+    trigger.setCondition( (TriggerEngine::Condition)ui->triggerConditionComboBox->currentIndex() );
+    trigger.setChannel( ui->triggerChannelComboBox->currentIndex() );
+    trigger.setRatioChannel( ui->triggerRatioComboBox->currentIndex() );
+    trigger.setDirection( (TriggerEngine::Direction)ui->triggerDirectionComboBox->currentIndex() );
+    trigger.setLevel( ui->triggerLevelSpinBox->value() );
+    trigger.setPreTriggerCount( ui->preTriggerSpinBox->value() );
+    trigger.setPostTriggerCount( ui->postTriggerSpinBox->value() );
+    trigger.arm();
+
+    ui->triggerLabel->setText( "Armed" );
+}
+
+void Widget::on_triggerRecordCheckBox_toggled(bool checked)
+{
+    // Recorder takes either full stream or capture windows only
+    if ( checked ) {
+        disconnect( colorSensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), recorder, SLOT(appendData(ColorSensorAccess::ColorData)) );
+        connect( &trigger, SIGNAL(captured(QVector<ColorSensorAccess::ColorData>,int,qint64)), recorder, SLOT(appendWindow(QVector<ColorSensorAccess::ColorData>,int)) );
+    } else {
+        disconnect( &trigger, SIGNAL(captured(QVector<ColorSensorAccess::ColorData>,int,qint64)), recorder, SLOT(appendWindow(QVector<ColorSensorAccess::ColorData>,int)) );
+        connect( colorSensor, SIGNAL(dataRead(ColorSensorAccess::ColorData)), recorder, SLOT(appendData(ColorSensorAccess::ColorData)) );
+    }
+}
+
+void Widget::on_autoExposureCheckBox_toggled(bool checked)
+{
+    // Sensor thread chooses gain and integration time while auto ranging
+    ui->integrationTimeGroupBox->setEnabled( !checked );
+    ui->lowButton->setEnabled( !checked );
+    ui->highButton->setEnabled( !checked );
+
+    colorSensor->setAutoExposureEnabled( checked );
+}
+
+void Widget::setHdrData(ColorSensorAccess::HdrData data)
+{
+    // Merged sample is plotted in counts of reference setting
+    int id = ui->graphWidget->wave->getQueueSize();
+
+    ui->graphWidget->wave->enqueueData( QVector<double>( { (double)id, data.blue, data.green, data.red, data.infraRed } ) );
+
+    if ( data.cycleNanosec > 0 ) {
+        double rate = 1e9 / data.cycleNanosec;
+
+        hdrCycleRate = hdrCycleRate > 0 ? hdrCycleRate + ( rate - hdrCycleRate ) * 0.1 : rate;
+    }
+
+    ui->hdrRateLabel->setText( QString( "%1 cycles/s" ).arg( hdrCycleRate, 0, 'f', 2 ) );
+    ui->intTimeLabel->setText( QString( "HDR B:%1 G:%2 R:%3 IR:%4" )
+                               .arg( data.blue, 0, 'f', 1 ).arg( data.green, 0, 'f', 1 )
+                               .arg( data.red, 0, 'f', 1 ).arg( data.infraRed, 0, 'f', 1 ) );
+}
+
+void Widget::on_hdrGroupBox_toggled(bool checked)
+{
+    // Sensor thread switches to sweep at next read
+    if ( checked && !colorSensor->setHdrExposures( ui->hdrExposureEdit->text() ) ) {
+        QMessageBox::critical( this, "Error", "Invalid exposure list" );
+
+        ui->hdrGroupBox->blockSignals( true );
+        ui->hdrGroupBox->setChecked( false );
+        ui->hdrGroupBox->blockSignals( false );
+
+        return;
+    }
+
+    hdrCycleRate = 0;
+
+    // Sweep interleaves settings, consumers comparing raw counts of successive samples pause meanwhile
+    const char *dataSignal = SIGNAL(dataRead(ColorSensorAccess::ColorData));
+    const char *appendSlot = SLOT(appendData(ColorSensorAccess::ColorData));
+    QList<QObject *> consumers = QList<QObject *>() << &statistics << &spectrumAnalyzer << &trigger << &rollup;
+
+    for ( QObject *consumer : consumers ) {
+        if ( checked ) {
+            disconnect( colorSensor, dataSignal, consumer, appendSlot );
+        } else {
+            connect( colorSensor, dataSignal, consumer, appendSlot, Qt::UniqueConnection );
+        }
+    }
+
+    if ( !checked ) {
+        statistics.clear();
+        spectrumAnalyzer.clear();
+    }
+
+    ui->tabWidget->setTabEnabled( ui->tabWidget->indexOf( ui->tab_3 ), !checked );
+    ui->tabWidget->setTabEnabled( ui->tabWidget->indexOf( ui->tab_4 ), !checked );
+    ui->tabWidget->setTabEnabled( ui->tabWidget->indexOf( ui->tab_5 ), !checked );
+
+    colorSensor->setHdrEnabled( checked );
+}
+
+void Widget::on_hdrExposureEdit_editingFinished()
+{
+    if ( !colorSensor->setHdrExposures( ui->hdrExposureEdit->text() ) ) {
+        statusMessage( "Invalid exposure list" );
+    }
+}
+
+void Widget::captureCalibrationSample(ColorSensorAccess::ColorData data)
+{
+    darkCalibration.addSample( data );
+}
+
+void Widget::setCalibrationCapture(DarkCalibration::CaptureMode mode, bool start)
+{
+    // Raw data is captured, samples are grouped by their own setting
+    if ( start ) {
+        ui->captureDarkButton->setEnabled( mode == DarkCalibration::CaptureDark );
+        ui->captureIrButton->setEnabled( mode == DarkCalibration::CaptureIrReference );
+
+        colorSensor->setDarkCorrectionEnabled( false );
+        darkCalibration.beginCapture( mode );
+
+        // Exposures of HDR sweep arrive as samples of their own setting, one pass fills each of them
+        if ( ui->hdrGroupBox->isChecked() ) {
+            statusMessage( "Capturing calibration samples of every HDR exposure" );
+        } else {
+            statusMessage( "Capturing calibration samples" );
+        }
+
+        return;
+    }
+
+    int samples = darkCalibration.getCapturedCount();
+    int settings = darkCalibration.endCapture();
+
+    colorSensor->setDarkCalibration( darkCalibration );
+    colorSensor->setDarkCorrectionEnabled( ui->darkCorrectionCheckBox->isChecked() );
+
+    ui->captureDarkButton->setEnabled( true );
+    ui->captureIrButton->setEnabled( true );
+
+    statusMessage( QString( "%1 samples captured, %2 settings updated" ).arg( samples ).arg( settings ) );
+}
+
+void Widget::on_captureDarkButton_toggled(bool checked)
+{
+    setCalibrationCapture( DarkCalibration::CaptureDark, checked );
+}
+
+void Widget::on_captureIrButton_toggled(bool checked)
+{
+    setCalibrationCapture( DarkCalibration::CaptureIrReference, checked );
+}
+
+void Widget::on_darkCorrectionCheckBox_toggled(bool checked)
+{
+    if ( darkCalibration.getCaptureMode() != DarkCalibration::NoCapture ) {
+        return;
+    }
+
+    colorSensor->setDarkCorrectionEnabled( checked );
+}
+
+void Widget::on_loadDarkButton_clicked()
+{
+    // Load dark offset and IR leakage table
+    QString ret = QFileDialog::getOpenFileName( this, "Load dark calibration", "", "*.ini" );
+
+    if ( ret == "" ) {
+        return;
+    }
+
+    if ( !darkCalibration.loadTable( ret ) ) {
+        QMessageBox::critical( this, "Error", "Failed to load dark calibration file" );
+        return;
+    }
+
+    colorSensor->setDarkCalibration( darkCalibration );
+
+    statusMessage( QString( "Dark calibration is loaded for %1 settings" ).arg( darkCalibration.getValidCount() ) );
+}
+
+void Widget::on_saveDarkButton_clicked()
+{
+    QString ret = QFileDialog::getSaveFileName( this, "Save dark calibration", "", "*.ini" );
+
+    if ( ret == "" ) {
+        return;
+    }
+
+    if ( !darkCalibration.saveTable( ret ) ) {
+        QMessageBox::critical( this, "Error", "Failed to save dark calibration file" );
+        return;
+    }
+
+    statusMessage( "Dark calibration is saved" );
+}
+
+void Widget::on_loadLibraryButton_clicked()
+{
+    // Load reference colors (name, L*, a*, b*)
+    QString ret = QFileDialog::getOpenFileName( this, "Load color library", "", "*.csv" );
+
+    if ( ret == "" ) {
+        return;
+    }
+
+    if ( !colorLibrary.loadFile( ret ) ) {
+        QMessageBox::critical( this, "Error", "Failed to load color library" );
+        return;
+    }
+
+    lastMatch.index = -1;
+    ui->matchLabel->setText( QString( "%1 references" ).arg( colorLibrary.size() ) );
+
+    statusMessage( "Color library is loaded" );
+}
+
+void Widget::trendRolledUp(int level)
+{
+    if ( level == ui->trendLevelComboBox->currentIndex() ) {
+        updateTrendView();
+    }
+}
+
+void Widget::updateTrendView()
+{
+    // Draw newest buckets of selected resolution, x is time from newest bucket
+    if ( ui->tabWidget->currentWidget() != ui->tab_6 ) {
+        return;
+    }
+
+    const int maxPoints = 4000;
+    int level = ui->trendLevelComboBox->currentIndex();
+    int value = ui->trendValueComboBox->currentIndex();
+    int count = rollup.getBucketCount( level );
+
+    if ( level < 0 || count == 0 ) {
+        ui->trendWidget->wave->clearQueue();
+        ui->trendLabel->setText( "No data" );
+        return;
+    }
+
+    int first = qMax( 0, count - maxPoints );
+    qint64 duration = RollupStore::levelDuration( level );
+    qint64 newest = rollup.getBucket( level, count - 1 ).start;
+    QList<QVector<double> > rows;
+
+    for ( int i = first; i < count; i++ ) {
+        const RollupStore::Bucket &bucket = rollup.getBucket( level, i );
+        QVector<double> row( RollupStore::ChannelCount + 1 );
+
+        row[0] = (double)( bucket.start - newest ) / duration;
+
+        for ( int ch = 0; ch < RollupStore::ChannelCount; ch++ ) {
+            row[ch + 1] = value == 1 ? bucket.min[ch] : ( value == 2 ? bucket.max[ch] : bucket.mean( ch ) );
+        }
+
+        rows.append( row );
+    }
+
+    double span = qMax( 1.0, -rows.first()[0] );
+
+    ui->trendWidget->wave->setXName( RollupStore::levelName( level ) );
+    ui->trendWidget->wave->setXScale( (double)ui->trendWidget->wave->width() / span );
+    ui->trendWidget->wave->setXGrid( qMax( 1.0, span / 10 ) );
+    ui->trendWidget->wave->setQueueDataFromList( rows, 1 );
+
+    QDateTime from = QDateTime::fromMSecsSinceEpoch( rollup.getBucket( level, first ).start / 1000000 );
+    QDateTime to = QDateTime::fromMSecsSinceEpoch( ( newest + duration ) / 1000000 );
+
+    ui->trendLabel->setText( QString( "%1 buckets, %2 - %3" )
+                             .arg( count - first )
+                             .arg( from.toString( "yyyy-MM-dd hh:mm:ss" ) )
+                             .arg( to.toString( "yyyy-MM-dd hh:mm:ss" ) ) );
+}
+
+void Widget::on_clearTrendButton_clicked()
+{
+    rollup.clear();
+}
+
+void Widget::on_pageHistoryCheckBox_toggled(bool checked)
+{
+    // Graph history beyond queue size goes to scratch file in cache directory, one per process
+    QString path;
+
+    if ( checked ) {
+        QString dirPath = QStandardPaths::writableLocation( QStandardPaths::CacheLocation );
+
+        QDir().mkpath( dirPath );
+        path = QString( "%1/graph_history_%2.page" ).arg( dirPath ).arg( QCoreApplication::applicationPid() );
+    }
+
+    if ( !ui->graphWidget->wave->setPageFile( path ) ) {
+        QMessageBox::critical( this, "Error", "Failed to open history page file " + path + ", it may be used by another instance" );
+
+        ui->pageHistoryCheckBox->setChecked( false );
+
+        return;
+    }
+
+    statusMessage( checked ? "Graph history is paged to " + path : "Graph history is limited to queue size" );
+}
+
+void Widget::on_loadGraphButton_clicked()
+{
+    // Same button cancels running import
+    if ( importing ) {
+        importer->cancel();
+
+        return;
+    }
+
+    QString ret = QFileDialog::getOpenFileName( this, "Load log file", "", "*.csv" );
+
+    if ( ret == "" ) {
+        return;
+    }
+
+    importing = true;
+
+    ui->loadGraphButton->setText( "Cancel" );
+    ui->importProgressBar->setValue( 0 );
+    ui->importProgressBar->setVisible( true );
+
+    QMetaObject::invokeMethod( importer, "importFile", Qt::QueuedConnection, Q_ARG( QString, ret ) );
+}
+
+void Widget::importProgress(qint64 doneBytes, qint64 totalBytes)
+{
+    ui->importProgressBar->setValue( totalBytes > 0 ? doneBytes * 1000 / totalBytes : 0 );
+}
+
+void Widget::importFinished(bool valid)
+{
+    CsvImporter::Result result = importer->getResult();
+
+    importing = false;
+
+    ui->loadGraphButton->setText( "Load" );
+    ui->importProgressBar->setVisible( false );
+
+    if ( !valid ) {
+        if ( result.canceled ) {
+            statusMessage( "Import canceled" );
+        } else {
+            QMessageBox::critical( this, "Error", result.message );
+        }
+
+        return;
+    }
+
+    // One bulk load, graph is drawn once
+    QVector<qint32> values = importer->takeValues();
+    double sec = result.elapsedNanosec / 1e9;
+
+    ui->graphWidget->wave->setQueueDataFromArray( values.constData(), result.rowCount, result.columnCount );
+    ui->detailGraphWidget->wave->setUpSize( result.columnCount, ui->graphWidget->wave->getDataStore()->getCapacity() );
+
+    statusMessage( QString( "Loaded %1 rows of %2 columns, %3[MB] in %4[ms], %5[MB/s]" )
+                   .arg( result.rowCount )
+                   .arg( result.columnCount )
+                   .arg( result.bytes / 1e6, 0, 'f', 1 )
+                   .arg( sec * 1000, 0, 'f', 1 )
+                   .arg( sec > 0 ? result.bytes / 1e6 / sec : 0, 0, 'f', 1 ) );
+}
+
+void Widget::on_replayButton_toggled(bool checked)
+{
+    if ( !checked ) {
+        replaySensor->stopReading();
+
+        return;
+    }
+
+    QString ret = QFileDialog::getOpenFileName( this, "Replay record file", "", "*.csr" );
+
+    if ( ret == "" || !replaySensor->openSensor( ret ) ) {
+        if ( ret != "" ) {
+            QMessageBox::critical( this, "Error", "Failed to read record file" );
+        }
+
+        ui->replayButton->blockSignals( true );
+        ui->replayButton->setChecked( false );
+        ui->replayButton->blockSignals( false );
+        return;
+    }
+
+    latencyCount = 0;
+    latencySum = 0;
+    latencyMax = 0;
+
+    replaySensor->setSpeed( ui->replaySpeedComboBox->currentData().toDouble() );
+    ui->replaySpeedComboBox->setEnabled( false );
+
+    statusMessage( QString( "Replaying %1 samples" ).arg( replaySensor->getStatistics().recordCount ) );
+
+    QMetaObject::invokeMethod( replaySensor, "startReading", Qt::QueuedConnection, Q_ARG( bool, true ) );
+}
+
+void Widget::replayFinished()
+{
+    // Finished signal is queued behind all samples, so latencies are complete here
+    ReplaySensor::Statistics stat = replaySensor->getStatistics();
+    double sec = stat.elapsedNanosec / 1e9;
+
+    ui->replayButton->blockSignals( true );
+    ui->replayButton->setChecked( false );
+    ui->replayButton->blockSignals( false );
+    ui->replaySpeedComboBox->setEnabled( true );
+
+    statusMessage( QString( "Replayed %1 samples in %2[ms], %3[samples/s], latency avg %4[ms] max %5[ms], max lag %6[ms]" )
+                   .arg( stat.sampleCount )
+                   .arg( sec * 1000, 0, 'f', 1 )
+                   .arg( sec > 0 ? stat.sampleCount / sec : 0, 0, 'f', 0 )
+                   .arg( latencyCount ? latencySum / 1e6 / latencyCount : 0, 0, 'f', 3 )
+                   .arg( latencyMax / 1e6, 0, 'f', 3 )
+                   .arg( stat.maxLagNanosec / 1e6, 0, 'f', 3 ) );
+}
+
+void Widget::on_sharedRingCheckBox_toggled(bool checked)
+{
+    // Live samples only, readers attach with SharedSampleReader
+    if ( !checked ) {
+        colorSensor->closeSharedRing();
+        statusMessage( "Shared memory closed" );
+
+        return;
+    }
+
+    if ( !colorSensor->openSharedRing( SharedSampleRing::defaultName(), SharedSampleRing::DefaultCapacity ) ) {
+        QMessageBox::critical( this, "Error", "Failed to open shared memory " + SharedSampleRing::defaultName() + ", another instance may be publishing to it" );
+
+        ui->sharedRingCheckBox->blockSignals( true );
+        ui->sharedRingCheckBox->setChecked( false );
+        ui->sharedRingCheckBox->blockSignals( false );
+        return;
+    }
+
+    statusMessage( QString( "Publishing to shared memory %1, %2 samples" ).arg( SharedSampleRing::defaultName() ).arg( SharedSampleRing::DefaultCapacity ) );
+}
+
+void Widget::on_streamServerCheckBox_toggled(bool checked)
+{
+    // Live and replayed samples are served, remote ones are not passed on
+    if ( !checked ) {
+        QMetaObject::invokeMethod( streamServer, "close", Qt::BlockingQueuedConnection );
+        ui->streamPortSpinBox->setEnabled( true );
+        statusMessage( "Stream server closed" );
+
+        return;
+    }
+
+    bool tcpOk = false;
+    bool localOk = false;
+
+    QMetaObject::invokeMethod( streamServer, "listenTcp", Qt::BlockingQueuedConnection, Q_RETURN_ARG( bool, tcpOk ), Q_ARG( int, ui->streamPortSpinBox->value() ) );
+    QMetaObject::invokeMethod( streamServer, "listenLocal", Qt::BlockingQueuedConnection, Q_RETURN_ARG( bool, localOk ), Q_ARG( QString, StreamServer::defaultName() ) );
+
+    if ( !tcpOk || !localOk ) {
+        QMetaObject::invokeMethod( streamServer, "close", Qt::BlockingQueuedConnection );
+        QMessageBox::critical( this, "Error", QString( "Failed to listen on port %1 or %2, another instance may be serving" ).arg( ui->streamPortSpinBox->value() ).arg( StreamServer::defaultName() ) );
+
+        ui->streamServerCheckBox->blockSignals( true );
+        ui->streamServerCheckBox->setChecked( false );
+        ui->streamServerCheckBox->blockSignals( false );
+        return;
+    }
+
+    ui->streamPortSpinBox->setEnabled( false );
+    statusMessage( QString( "Serving stream on 127.0.0.1:%1 and %2" ).arg( ui->streamPortSpinBox->value() ).arg( StreamServer::defaultName() ) );
+}
+
+void Widget::on_remoteButton_toggled(bool checked)
+{
+    if ( !checked ) {
+        QMetaObject::invokeMethod( streamClient, "disconnectFromServer", Qt::BlockingQueuedConnection );
+
+        return;
+    }
+
+    if ( !streamClient->openSensor( ui->remoteAddressEdit->text().trimmed() ) ) {
+        remoteConnectFailed( "Invalid address" );
+
+        return;
+    }
+
+    latencyCount = 0;
+    latencySum = 0;
+    latencyMax = 0;
+
+    // Result comes back as remoteConnectionChanged or remoteConnectFailed
+    ui->remoteAddressEdit->setEnabled( false );
+    statusMessage( "Connecting to " + streamClient->getAddress() );
+
+    streamClient->setDecimation( ui->remoteDecimationSpinBox->value() );
+    QMetaObject::invokeMethod( streamClient, "connectToServer", Qt::QueuedConnection );
+}
+
+void Widget::remoteConnectFailed(QString message)
+{
+    ui->remoteAddressEdit->setEnabled( true );
+
+    ui->remoteButton->blockSignals( true );
+    ui->remoteButton->setChecked( false );
+    ui->remoteButton->blockSignals( false );
+
+    QMessageBox::critical( this, "Error", "Failed to connect to " + ui->remoteAddressEdit->text() + ", " + message );
+}
+
+void Widget::on_remoteDecimationSpinBox_valueChanged(int arg1)
+{
+    QMetaObject::invokeMethod( streamClient, "subscribe", Qt::QueuedConnection, Q_ARG( int, arg1 ) );
+}
+
+void Widget::remoteConnectionChanged(bool connected)
+{
+    ui->remoteAddressEdit->setEnabled( !connected );
+
+    if ( connected ) {
+        statusMessage( "Connected to " + streamClient->getAddress() );
+
+        return;
+    }
+
+    // Closed by user or by server
+    StreamClient::Statistics stat = streamClient->getStatistics();
+
+    ui->remoteButton->blockSignals( true );
+    ui->remoteButton->setChecked( false );
+    ui->remoteButton->blockSignals( false );
+
+    statusMessage( QString( "Disconnected, received %1 samples in %2 frames, %3 dropped by server, latency avg %4[ms] max %5[ms], max transport %6[ms]" )
+                   .arg( stat.sampleCount )
+                   .arg( stat.frameCount )
+                   .arg( stat.droppedCount )
+                   .arg( latencyCount ? latencySum / 1e6 / latencyCount : 0, 0, 'f', 3 )
+                   .arg( latencyMax / 1e6, 0, 'f', 3 )
+                   .arg( stat.maxTransportNanosec / 1e6, 0, 'f', 3 ) );
+}
+
+void Widget::on_detailCheckBox_toggled(bool checked)
+{
+    ui->detailGraphWidget->setVisible( checked );
+    ui->detailGraphWidget->wave->moveHeadToHead( true, true );
+}
+
+void Widget::on_derivedEdit_editingFinished()
+{
+    // Definitions apply to detail pane, raw channels there give way to derived ones
+    QString error;
+    QList<ChannelExpression> list = ChannelExpression::compileList( ui->derivedEdit->text(), ui->graphWidget->wave->getNames().mid( 0, 4 ), &error );
+
+    if ( !error.isEmpty() ) {
+        statusMessage( "Derived channel error, " + error );
+
+        return;
+    }
+
+    derivedChannels = list;
+
+    ui->detailGraphWidget->wave->setDerivedChannels( list );
+    ui->detailGraphWidget->wave->setShowRawChannels( list.isEmpty() );
+    ui->detailGraphWidget->wave->setAutoUpdateYMin( !list.isEmpty() );
+    ui->detailGraphWidget->wave->update();
+
+    if ( !list.isEmpty() ) {
+        ui->detailCheckBox->setChecked( true );
+    }
+
+    statusMessage( QString( "%1 derived channels" ).arg( list.size() ) );
+}
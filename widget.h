@@ -8,10 +8,34 @@
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QFile>
+#include <QFileInfo>
 #include <QTextStream>
+#include <QHeaderView>
+#include <QScrollBar>
+#include <QTimer>
+#include <QPixmap>
+#include <QtMath>
+#include <QDir>
+#include <QStandardPaths>
+#include <QSignalBlocker>
 
 #include "colorsensoraccess.h"
 #include "graph.h"
+#include "samplerecorder.h"
+#include "sampletablemodel.h"
+#include "colorconverter.h"
+#include "rollingstatistics.h"
+#include "spectrumanalyzer.h"
+#include "triggerengine.h"
+#include "darkcalibration.h"
+#include "colorlibrary.h"
+#include "rollupstore.h"
+#include "csvimporter.h"
+#include "replaysensor.h"
+#include "sharedsamplering.h"
+#include "streamserver.h"
+#include "streamclient.h"
+#include "channelexpression.h"
 
 namespace Ui {
 class Widget;
@@ -33,6 +57,58 @@ private:
     QThread sensorThread;
     ColorSensorAccess *colorSensor;
 
+    QThread recorderThread;
+    SampleRecorder *recorder;
+
+    QThread importThread;
+    CsvImporter *importer;
+    bool importing;
+
+    // Recorded session played as a sensor, latency is measured at setData
+    QThread replayThread;
+    ReplaySensor *replaySensor;
+    qint64 latencyCount;
+    qint64 latencySum;
+    qint64 latencyMax;
+
+    // Samples served to remote viewers, and a remote station viewed here
+    QThread streamThread;
+    StreamServer *streamServer;
+    QThread remoteThread;
+    StreamClient *streamClient;
+
+    SampleTableModel logModel;
+
+    ColorConverter colorConverter;
+
+    RollingStatistics statistics;
+    QTimer statisticsTimer;
+
+    SpectrumAnalyzer spectrumAnalyzer;
+
+    TriggerEngine trigger;
+
+    double hdrCycleRate;
+
+    DarkCalibration darkCalibration;
+
+    ColorLibrary colorLibrary;
+    ColorLibrary::Match lastMatch;
+
+    RollupStore rollup;
+
+    // Channels computed from B, G, R and IR, shown in detail pane and saved with log
+    QList<ChannelExpression> derivedChannels;
+
+    // Color preview is repainted at most once per frame from the latest sample
+    QTimer previewTimer;
+    ColorSensorAccess::ColorData previewData;
+    QPixmap previewPixmap[2];
+    int previewPixmapIndex;
+    QRgb previewColor;
+    ColorSensorAccess::ColorData previewShownData;
+    bool previewValid;
+
 public slots:
     void setData( ColorSensorAccess::ColorData data );
     void setDataToGraph( ColorSensorAccess::ColorData data );
@@ -68,8 +144,100 @@ private slots:
 
     void on_saveGraphButton_clicked();
 
+    void on_recordButton_toggled(bool checked);
+
+    void recorderWriteFailed( QString message );
+
+    void scrollLogToBottom();
+
+    void updateColorLabel();
+
+    void on_loadCalibrationButton_clicked();
+
+    void updateStatisticsPanel();
+
+    void on_statsCountSpinBox_valueChanged(int arg1);
+
+    void on_statsTimeSpinBox_valueChanged(int arg1);
+
+    void on_clearStatsButton_clicked();
+
+    void on_statsScaleCheckBox_toggled(bool checked);
+
+    void updateSpanLabel();
+
+    void updateSpectrumView();
+
+    void on_fftSizeComboBox_currentIndexChanged(int index);
+
+    void on_hopSpinBox_valueChanged(int arg1);
+
+    void showCapture( QVector<ColorSensorAccess::ColorData> window, int triggerIndex, qint64 latencyNanosec );
+
+    void on_armButton_toggled(bool checked);
+
+    void on_triggerRecordCheckBox_toggled(bool checked);
+
+    void on_autoExposureCheckBox_toggled(bool checked);
+
+    void setHdrData( ColorSensorAccess::HdrData data );
+
+    void on_hdrGroupBox_toggled(bool checked);
+
+    void on_hdrExposureEdit_editingFinished();
+
+    void captureCalibrationSample( ColorSensorAccess::ColorData data );
+
+    void on_captureDarkButton_toggled(bool checked);
+
+    void on_captureIrButton_toggled(bool checked);
+
+    void on_darkCorrectionCheckBox_toggled(bool checked);
+
+    void on_loadDarkButton_clicked();
+
+    void on_saveDarkButton_clicked();
+
+    void on_loadLibraryButton_clicked();
+
+    void updateTrendView();
+
+    void trendRolledUp( int level );
+
+    void on_clearTrendButton_clicked();
+
+    void on_pageHistoryCheckBox_toggled( bool checked );
+
+    void on_loadGraphButton_clicked();
+
+    void importProgress( qint64 doneBytes, qint64 totalBytes );
+
+    void importFinished( bool valid );
+
+    void on_replayButton_toggled(bool checked);
+
+    void replayFinished();
+
+    void on_sharedRingCheckBox_toggled(bool checked);
+
+    void on_streamServerCheckBox_toggled(bool checked);
+
+    void on_remoteButton_toggled(bool checked);
+
+    void on_remoteDecimationSpinBox_valueChanged(int arg1);
+
+    void remoteConnectionChanged( bool connected );
+
+    void remoteConnectFailed( QString message );
+
+    void on_detailCheckBox_toggled(bool checked);
+
+    void on_derivedEdit_editingFinished();
+
 private:
+    void connectSensor( ColorSensorAccess *sensor );
     void setColorLabel( ColorSensorAccess::ColorData data );
+    void setCalibrationCapture( DarkCalibration::CaptureMode mode, bool start );
 };
 
 #endif // WIDGET_H